@@ -3,6 +3,8 @@
 #include <string>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
+#include <set>
 #include <memory>
 #include <chrono>
 #include <thread>
@@ -16,8 +18,46 @@
 #include <atomic>
 #include <functional>
 #include <cmath>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <stdexcept>
+#include <optional>
+#include <string_view>
+#include <filesystem>
 
-// Cryptographic hash function (simplified SHA-256-like)
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BLOCKCHAIN_SHA_NI 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+// On-disk block store: append-only segment files with a memory-mapped index
+#if defined(__unix__) || defined(__APPLE__)
+#define BLOCKCHAIN_BLOCK_STORE 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 32-byte binary SHA-256 digest; converted to hex only for display
+using Hash256 = std::array<uint8_t, 32>;
+
+// Digests are uniformly distributed, so their last bytes already make a good table hash.
+// The first bytes are not: block hashes start with the proof-of-work zero bytes.
+struct DigestHash {
+    size_t operator()(const Hash256& digest) const {
+        size_t value;
+        std::memcpy(&value, digest.data() + digest.size() - sizeof(value), sizeof(value));
+        return value;
+    }
+};
+
+// SHA-256 (FIPS 180-4). Blocks are compressed with the SHA-NI instructions when the CPU
+// has them (checked once at runtime), otherwise with the portable implementation.
 class CryptoHash {
 private:
     static const uint32_t K[64];
@@ -35,39 +75,434 @@ private:
         return (a & b) ^ (a & c) ^ (b & c);
     }
     
+    static uint32_t loadBigEndian(const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    }
+    
+    static void compressPortable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+        uint32_t w[64];
+        for (; blocks > 0; blocks--, data += 64) {
+            for (int i = 0; i < 16; i++) {
+                w[i] = loadBigEndian(data + 4 * i);
+            }
+            for (int i = 16; i < 64; i++) {
+                uint32_t s0 = rightRotate(w[i - 15], 7) ^ rightRotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rightRotate(w[i - 2], 17) ^ rightRotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; i++) {
+                uint32_t s1 = rightRotate(e, 6) ^ rightRotate(e, 11) ^ rightRotate(e, 25);
+                uint32_t t1 = h + s1 + choose(e, f, g) + K[i] + w[i];
+                uint32_t s0 = rightRotate(a, 2) ^ rightRotate(a, 13) ^ rightRotate(a, 22);
+                uint32_t t2 = s0 + majority(a, b, c);
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+    }
+    
+#ifdef BLOCKCHAIN_SHA_NI
+    static bool hasShaExtensions() {
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1)) return false;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+        return (ebx & (1u << 29)) != 0; // SHA
+    }
+    
+    // State is kept as ABEF/CDGH, the layout sha256rnds2 works on
+    __attribute__((target("sha,sse4.1")))
+    static void compressShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+        
+        for (; blocks > 0; blocks--, data += 64) {
+            __m128i savedAbef = state0;
+            __m128i savedCdgh = state1;
+            
+            __m128i w[4];
+            for (int i = 0; i < 4; i++) {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+            }
+            
+            // Four rounds per step; w[i & 3] holds message words 4i..4i+3
+            for (int i = 0; i < 16; i++) {
+                if (i >= 4) {
+                    __m128i next = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                    next = _mm_add_epi32(next, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                    w[i & 3] = _mm_sha256msg2_epu32(next, w[(i + 3) & 3]);
+                }
+                __m128i message = _mm_add_epi32(w[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[4 * i])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+            }
+            
+            state0 = _mm_add_epi32(state0, savedAbef);
+            state1 = _mm_add_epi32(state1, savedCdgh);
+        }
+        
+        tmp = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(tmp, state1, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(state1, tmp, 8));
+    }
+#endif
+    
 public:
-    static std::string hash(const std::string& input) {
-        // Simplified hash function for demonstration
-        // In production, use a proper cryptographic library
-        std::hash<std::string> hasher;
-        size_t hashValue = hasher(input);
+    // Compresses `blocks` 64-byte blocks into `state`
+    static void compress(uint32_t state[8], const uint8_t* data, size_t blocks) {
+#ifdef BLOCKCHAIN_SHA_NI
+        static const bool shaNi = hasShaExtensions();
+        if (shaNi) {
+            compressShaNi(state, data, blocks);
+            return;
+        }
+#endif
+        compressPortable(state, data, blocks);
+    }
+    
+    // Incremental hashing; copying a Sha256 after absorbing a common prefix gives a midstate
+    class Sha256 {
+    private:
+        uint32_t state[8];
+        uint8_t buffer[64];
+        size_t buffered = 0;
+        uint64_t totalLength = 0;
         
-        // Convert to hex string with leading zeros
-        std::stringstream ss;
-        ss << std::hex << std::setfill('0') << std::setw(16) << hashValue;
-        return ss.str();
+    public:
+        Sha256() {
+            initialState(state);
+        }
+        
+        Sha256& update(const void* input, size_t length) {
+            const uint8_t* data = static_cast<const uint8_t*>(input);
+            totalLength += length;
+            
+            if (buffered > 0) {
+                size_t take = std::min(length, sizeof(buffer) - buffered);
+                std::memcpy(buffer + buffered, data, take);
+                buffered += take;
+                data += take;
+                length -= take;
+                if (buffered < sizeof(buffer)) return *this;
+                compress(state, buffer, 1);
+                buffered = 0;
+            }
+            
+            size_t blocks = length / 64;
+            if (blocks > 0) {
+                compress(state, data, blocks);
+                data += blocks * 64;
+                length -= blocks * 64;
+            }
+            
+            std::memcpy(buffer, data, length);
+            buffered = length;
+            return *this;
+        }
+        
+        Hash256 finish() {
+            uint64_t bitLength = totalLength * 8;
+            buffer[buffered++] = 0x80;
+            if (buffered > 56) {
+                std::memset(buffer + buffered, 0, sizeof(buffer) - buffered);
+                compress(state, buffer, 1);
+                buffered = 0;
+            }
+            std::memset(buffer + buffered, 0, 56 - buffered);
+            for (int i = 0; i < 8; i++) {
+                buffer[56 + i] = static_cast<uint8_t>(bitLength >> (56 - 8 * i));
+            }
+            compress(state, buffer, 1);
+            
+            Hash256 digest;
+            for (int i = 0; i < 8; i++) {
+                digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+                digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+                digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+                digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+            }
+            return digest;
+        }
+    };
+    
+    static Hash256 sha256(const void* data, size_t length) {
+        return Sha256().update(data, length).finish();
     }
     
-    static std::string doubleHash(const std::string& input) {
-        return hash(hash(input));
+    static Hash256 hash(const std::string& input) {
+        return sha256(input.data(), input.size());
     }
     
-    static bool verifyHash(const std::string& data, const std::string& expectedHash) {
+    static Hash256 doubleHash(const std::string& input) {
+        Hash256 first = hash(input);
+        return sha256(first.data(), first.size());
+    }
+    
+    static bool verifyHash(const std::string& data, const Hash256& expectedHash) {
         return hash(data) == expectedHash;
     }
     
-    static std::string merkleRoot(const std::vector<std::string>& hashes) {
+    // Interior node: hash of the two 32-byte children
+    static Hash256 hashPair(const Hash256& left, const Hash256& right) {
+        uint8_t pair[64];
+        std::memcpy(pair, left.data(), 32);
+        std::memcpy(pair + 32, right.data(), 32);
+        return sha256(pair, sizeof(pair));
+    }
+    
+    // Odd levels pair the last node with itself; levels are reduced in place
+    static Hash256 merkleRoot(std::vector<Hash256> hashes) {
         if (hashes.empty()) return hash("");
-        if (hashes.size() == 1) return hashes[0];
         
-        std::vector<std::string> newLevel;
-        for (size_t i = 0; i < hashes.size(); i += 2) {
-            std::string left = hashes[i];
-            std::string right = (i + 1 < hashes.size()) ? hashes[i + 1] : left;
-            newLevel.push_back(hash(left + right));
+        while (hashes.size() > 1) {
+            size_t count = hashes.size();
+            for (size_t i = 0; i < count; i += 2) {
+                hashes[i / 2] = hashPair(hashes[i], (i + 1 < count) ? hashes[i + 1] : hashes[i]);
+            }
+            hashes.resize((count + 1) / 2);
+        }
+        return hashes[0];
+    }
+    
+    static std::string toHex(const Hash256& digest) {
+        std::string hex(64, '0');
+        toHex(digest, &hex[0]);
+        return hex;
+    }
+    
+    // Writes the 64 lowercase hex digits of `digest` to `out`
+    static void toHex(const Hash256& digest, char* out) {
+        static const char digits[] = "0123456789abcdef";
+        for (size_t i = 0; i < digest.size(); i++) {
+            out[2 * i] = digits[digest[i] >> 4];
+            out[2 * i + 1] = digits[digest[i] & 0x0F];
+        }
+    }
+    
+    // Inverse of toHex: accepts exactly 64 lowercase hex digits. Table driven, with one
+    // validity check at the end instead of a branch per digit.
+    static bool fromHex(const std::string& hex, Hash256& digest) {
+        static const std::array<uint8_t, 256> nibbles = [] {
+            std::array<uint8_t, 256> table;
+            table.fill(0xFF);
+            for (int i = 0; i < 10; i++) table['0' + i] = static_cast<uint8_t>(i);
+            for (int i = 0; i < 6; i++) table['a' + i] = static_cast<uint8_t>(10 + i);
+            return table;
+        }();
+        
+        if (hex.size() != 64) return false;
+        const auto* digits = reinterpret_cast<const uint8_t*>(hex.data());
+        uint8_t invalid = 0;
+        for (size_t i = 0; i < 32; i++) {
+            uint8_t high = nibbles[digits[2 * i]];
+            uint8_t low = nibbles[digits[2 * i + 1]];
+            invalid |= high | low;
+            digest[i] = static_cast<uint8_t>((high << 4) | (low & 0x0F));
+        }
+        return !(invalid & 0xF0);
+    }
+    
+    static void initialState(uint32_t state[8]) {
+        std::memcpy(state, H0, sizeof(H0));
+    }
+    
+    static int leadingZeroBits(const Hash256& digest) {
+        int count = 0;
+        for (uint8_t byte : digest) {
+            if (byte != 0) {
+                while (!(byte & 0x80)) {
+                    byte <<= 1;
+                    count++;
+                }
+                break;
+            }
+            count += 8;
+        }
+        return count;
+    }
+    
+    // Same count on a final compression state, whose words are the digest in big-endian order
+    static int leadingZeroBits(const uint32_t state[8]) {
+        int count = 0;
+        for (int i = 0; i < 8; i++) {
+            uint32_t word = state[i];
+            if (word != 0) {
+                while (!(word & 0x80000000u)) {
+                    word <<= 1;
+                    count++;
+                }
+                break;
+            }
+            count += 32;
         }
+        return count;
+    }
+};
+
+const uint32_t CryptoHash::K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t CryptoHash::H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// Inclusion proof: sibling hashes from the leaf up to the root
+struct MerkleProof {
+    size_t index = 0;
+    std::vector<Hash256> siblings;
+};
+
+// Merkle tree with every level cached. Appending a leaf rehashes only the path from it to
+// the root, O(log n); the root matches CryptoHash::merkleRoot over the same leaves.
+class MerkleTree {
+private:
+    std::vector<std::vector<Hash256>> levels; // levels[0] holds the leaves
+    
+public:
+    void append(const Hash256& leaf) {
+        if (levels.empty()) levels.emplace_back();
+        levels[0].push_back(leaf);
         
-        return merkleRoot(newLevel);
+        // An odd last node is paired with itself until its sibling arrives
+        for (size_t level = 0; levels[level].size() > 1; level++) {
+            const std::vector<Hash256>& nodes = levels[level];
+            size_t i = nodes.size() - 1;
+            size_t left = i & ~size_t(1);
+            Hash256 parent = CryptoHash::hashPair(nodes[left], left + 1 < nodes.size() ? nodes[left + 1] : nodes[left]);
+            
+            if (level + 1 == levels.size()) levels.emplace_back();
+            std::vector<Hash256>& above = levels[level + 1];
+            if (i / 2 < above.size()) {
+                above[i / 2] = parent;
+            } else {
+                above.push_back(parent);
+            }
+        }
+    }
+    
+    void clear() {
+        levels.clear();
+    }
+    
+    size_t size() const {
+        return levels.empty() ? 0 : levels[0].size();
+    }
+    
+    Hash256 root() const {
+        return levels.empty() ? CryptoHash::hash("") : levels.back().front();
+    }
+    
+    MerkleProof prove(size_t index) const {
+        if (index >= size()) {
+            throw std::out_of_range("Merkle proof requested for leaf " + std::to_string(index) +
+                                    " of " + std::to_string(size()));
+        }
+        MerkleProof proof;
+        proof.index = index;
+        for (size_t level = 0; levels[level].size() > 1; level++, index /= 2) {
+            const std::vector<Hash256>& nodes = levels[level];
+            size_t sibling = index ^ 1;
+            proof.siblings.push_back(sibling < nodes.size() ? nodes[sibling] : nodes[index]);
+        }
+        return proof;
+    }
+    
+    static bool verify(const Hash256& leaf, const MerkleProof& proof, const Hash256& root) {
+        Hash256 node = leaf;
+        size_t index = proof.index;
+        for (const auto& sibling : proof.siblings) {
+            node = (index & 1) ? CryptoHash::hashPair(sibling, node) : CryptoHash::hashPair(node, sibling);
+            index /= 2;
+        }
+        return node == root;
+    }
+};
+
+// Account identifier: a wallet's 32-byte key, or a short name ("coinbase", "genesis", miner
+// labels) stored inline. Fixed-size and trivially copyable, so transactions, coins and indexes
+// hold addresses without allocating; hex is produced only for display.
+class Address {
+public:
+    static constexpr size_t MAX_NAME = 32;
+    
+private:
+    Hash256 bytes{};
+    uint8_t tag = 1; // 0: key; otherwise a name of tag - 1 bytes (default: the empty name)
+    
+public:
+    Address() = default;
+    
+    // 64 lowercase hex digits are a key; anything else is a name
+    Address(const std::string& text) {
+        if (CryptoHash::fromHex(text, bytes)) {
+            tag = 0;
+        } else {
+            *this = fromName(text);
+        }
+    }
+    
+    Address(const char* text) : Address(std::string(text)) {}
+    
+    static Address fromKey(const Hash256& key) {
+        Address address;
+        address.bytes = key;
+        address.tag = 0;
+        return address;
+    }
+    
+    static Address fromName(std::string_view name) {
+        if (name.size() > MAX_NAME) {
+            throw std::invalid_argument("Address names are limited to " + std::to_string(MAX_NAME) + " bytes");
+        }
+        Address address;
+        std::memcpy(address.bytes.data(), name.data(), name.size());
+        address.tag = static_cast<uint8_t>(name.size() + 1);
+        return address;
+    }
+    
+    bool isKey() const { return tag == 0; }
+    bool empty() const { return tag == 1; }
+    bool isName(std::string_view text) const { return !isKey() && name() == text; }
+    
+    const Hash256& key() const { return bytes; }
+    uint8_t getTag() const { return tag; }
+    
+    std::string_view name() const {
+        return std::string_view(reinterpret_cast<const char*>(bytes.data()), isKey() ? 0 : tag - 1u);
+    }
+    
+    std::string toString() const {
+        return isKey() ? CryptoHash::toHex(bytes) : std::string(name());
+    }
+    
+    bool operator==(const Address& other) const { return tag == other.tag && bytes == other.bytes; }
+    bool operator!=(const Address& other) const { return !(*this == other); }
+    bool operator<(const Address& other) const {
+        return tag != other.tag ? tag < other.tag : bytes < other.bytes;
+    }
+};
+
+struct AddressHash {
+    size_t operator()(const Address& address) const {
+        return address.isKey() ? DigestHash()(address.key()) : std::hash<std::string_view>()(address.name());
     }
 };
 
@@ -88,14 +523,14 @@ public:
         std::uniform_int_distribution<> dis(1000000, 9999999);
         
         privateKey = std::to_string(dis(gen));
-        publicKey = CryptoHash::hash(privateKey);
+        publicKey = CryptoHash::toHex(CryptoHash::hash(privateKey));
     }
     
-    std::string sign(const std::string& message) const {
+    Hash256 sign(const std::string& message) const {
         return CryptoHash::hash(message + privateKey);
     }
     
-    bool verify(const std::string& message, const std::string& signature) const {
+    bool verify(const std::string& message, const Hash256& signature) const {
         return signature == CryptoHash::hash(message + privateKey);
     }
     
@@ -103,39 +538,237 @@ public:
     std::string getPrivateKey() const { return privateKey; }
     
     static bool verifySignature(const std::string& message, 
-                               const std::string& signature,
-                               const std::string& publicKey) {
+                               const Hash256& signature,
+                               const Address& publicKey) {
         // Simplified verification - in reality this would be more complex
-        return !signature.empty() && !publicKey.empty();
+        return signature != Hash256{} && !publicKey.empty();
+    }
+};
+
+// Amounts are integers in base units, COIN of them to a coin, so balances add up exactly
+using Amount = int64_t;
+constexpr Amount COIN = 100000000;
+
+inline Amount toAmount(double coins) {
+    return static_cast<Amount>(std::llround(coins * COIN));
+}
+
+inline double toCoins(Amount amount) {
+    return static_cast<double>(amount) / COIN;
+}
+
+// Compact binary encoding: fixed-width little-endian integers, LEB128 varints, raw hashes and
+// addresses. Writes go to a caller-provided buffer and never allocate; the counting variant
+// writes nothing and only measures, so a buffer can be sized exactly before encoding.
+template <bool Counting>
+class BasicByteWriter {
+private:
+    uint8_t* out;
+    size_t written = 0;
+    
+public:
+    explicit BasicByteWriter(uint8_t* buffer = nullptr) : out(buffer) {}
+    
+    void putByte(uint8_t value) {
+        if constexpr (!Counting) out[written] = value;
+        written++;
+    }
+    
+    void putUint(uint64_t value, int bytes) {
+        if constexpr (!Counting) {
+            for (int i = 0; i < bytes; i++) {
+                out[written + i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+        written += bytes;
+    }
+    
+    // Seven bits per byte, low bits first; the high bit marks a continuation
+    void putVarint(uint64_t value) {
+        while (value >= 0x80) {
+            putByte(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        putByte(static_cast<uint8_t>(value));
+    }
+    
+    void putBytes(const uint8_t* data, size_t size) {
+        if constexpr (!Counting) std::memcpy(out + written, data, size);
+        written += size;
+    }
+    
+    void putHash(const Hash256& digest) {
+        putBytes(digest.data(), digest.size());
+    }
+    
+    void putString(const std::string& text) {
+        putVarint(text.size());
+        putBytes(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    }
+    
+    // Keys take a zero tag and their 32 raw bytes; names, such as "coinbase", are stored as
+    // text with their length + 1 as the tag (one byte, as names are at most 32 bytes)
+    void putAddress(const Address& address) {
+        putByte(address.getTag());
+        if (address.isKey()) {
+            putHash(address.key());
+        } else {
+            putBytes(address.key().data(), address.getTag() - 1u);
+        }
+    }
+    
+    // Negative values are only produced by malformed transactions; they still round-trip
+    void putAmount(Amount amount) {
+        putVarint(static_cast<uint64_t>(amount));
+    }
+    
+    void putTime(std::chrono::system_clock::time_point time) {
+        putVarint(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            time.time_since_epoch()).count()));
+    }
+    
+    size_t size() const { return written; }
+};
+
+using ByteWriter = BasicByteWriter<false>;
+using ByteCounter = BasicByteWriter<true>;
+
+// Bounds-checked reader for the encoding above. Strings are decoded into existing objects,
+// so a reused destination keeps its capacity and decoding does not allocate.
+class ByteReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    
+    const uint8_t* take(size_t count) {
+        if (count > size - pos) {
+            throw std::runtime_error("Truncated record at byte " + std::to_string(pos));
+        }
+        const uint8_t* start = data + pos;
+        pos += count;
+        return start;
+    }
+    
+public:
+    ByteReader(const uint8_t* bytes, size_t length) : data(bytes), size(length) {}
+    
+    uint8_t getByte() {
+        return *take(1);
+    }
+    
+    uint64_t getUint(int bytes) {
+        const uint8_t* p = take(bytes);
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return value;
+    }
+    
+    uint64_t getVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = getByte();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        throw std::runtime_error("Varint too long at byte " + std::to_string(pos));
+    }
+    
+    Hash256 getHash() {
+        Hash256 digest;
+        std::memcpy(digest.data(), take(digest.size()), digest.size());
+        return digest;
+    }
+    
+    void getString(std::string& text) {
+        size_t length = getVarint();
+        text.assign(reinterpret_cast<const char*>(take(length)), length);
+    }
+    
+    void getAddress(Address& address) {
+        uint64_t tag = getVarint();
+        if (tag == 0) {
+            address = Address::fromKey(getHash());
+        } else if (tag - 1 > Address::MAX_NAME) {
+            throw std::runtime_error("Address name too long at byte " + std::to_string(pos));
+        } else {
+            address = Address::fromName(std::string_view(reinterpret_cast<const char*>(take(tag - 1)), tag - 1));
+        }
+    }
+    
+    Amount getAmount() {
+        return static_cast<Amount>(getVarint());
+    }
+    
+    std::chrono::system_clock::time_point getTime() {
+        return std::chrono::system_clock::time_point(
+            std::chrono::milliseconds(static_cast<int64_t>(getVarint())));
     }
+    
+    const uint8_t* position() const { return data + pos; }
+    size_t remaining() const { return size - pos; }
 };
 
 // Transaction class
 class Transaction {
 public:
-    std::string txId;
-    std::string sender;
-    std::string receiver;
-    double amount;
-    double fee;
+    // Version byte that starts every encoded transaction and block
+    static constexpr uint8_t ENCODING_VERSION = 1;
+    
+    Hash256 txId;
+    Address sender;
+    Address receiver;
+    Amount amount;
+    Amount fee;
     std::chrono::time_point<std::chrono::system_clock> timestamp;
-    std::string signature;
-    std::map<std::string, std::string> metadata;
+    Hash256 signature{}; // All zero until signed
+    // Key/value pairs, encoded in this order; a vector so that decoding into an existing
+    // transaction reuses its strings
+    std::vector<std::pair<std::string, std::string>> metadata;
     
-    Transaction(const std::string& from, const std::string& to, 
+    // Amounts are given in coins
+    Transaction(const Address& from, const Address& to, 
                 double amt, double txFee = 0.001)
-        : sender(from), receiver(to), amount(amt), fee(txFee),
+        : sender(from), receiver(to), amount(toAmount(amt)), fee(toAmount(txFee)),
           timestamp(std::chrono::system_clock::now()) {
         
         generateTxId();
     }
     
     void generateTxId() {
-        std::stringstream ss;
-        ss << sender << receiver << amount << fee 
-           << std::chrono::duration_cast<std::chrono::milliseconds>(
-               timestamp.time_since_epoch()).count();
-        txId = CryptoHash::hash(ss.str());
+        txId = calculateTxId();
+    }
+    
+    // Hash of the encoded body, written in one pass to a stack buffer unless metadata makes
+    // it large
+    Hash256 calculateTxId() const {
+        uint8_t stackBuffer[256];
+        std::vector<uint8_t> heapBuffer;
+        uint8_t* buffer = stackBuffer;
+        size_t bound = maxBodySize();
+        if (bound > sizeof(stackBuffer)) {
+            heapBuffer.resize(bound);
+            buffer = heapBuffer.data();
+        }
+        ByteWriter writer(buffer);
+        encodeBody(writer);
+        return CryptoHash::sha256(buffer, writer.size());
+    }
+    
+    // Upper bound of the encoded body size; varints take at most 10 bytes
+    size_t maxBodySize() const {
+        size_t bound = 1 + 2 * (1 + 32) + 3 * 10 + 10;
+        for (const auto& entry : metadata) {
+            bound += 20 + entry.first.size() + entry.second.size();
+        }
+        return bound;
+    }
+    
+    // Block rewards are minted by the miner and carry no signature
+    bool isCoinbase() const {
+        return sender.isName("coinbase");
     }
     
     void sign(const DigitalSignature& signer) {
@@ -144,45 +777,145 @@ public:
     }
     
     bool verify() const {
-        if (signature.empty()) return false;
+        if (signature == Hash256{}) return false;
         std::string message = getTxData();
         return DigitalSignature::verifySignature(message, signature, sender);
     }
     
+    // The txId commits to every field, so it is the signed message
     std::string getTxData() const {
-        std::stringstream ss;
-        ss << txId << sender << receiver << amount << fee;
-        return ss.str();
+        return std::string(reinterpret_cast<const char*>(txId.data()), txId.size());
     }
     
     std::string toString() const {
         std::stringstream ss;
-        ss << "TX[" << txId.substr(0, 8) << "...] "
-           << sender.substr(0, 8) << "... -> " 
-           << receiver.substr(0, 8) << "... "
-           << amount << " coins (fee: " << fee << ")";
+        ss << "TX[" << CryptoHash::toHex(txId).substr(0, 8) << "...] "
+           << sender.toString().substr(0, 8) << "... -> " 
+           << receiver.toString().substr(0, 8) << "... "
+           << toCoins(amount) << " coins (fee: " << toCoins(fee) << ")";
         return ss.str();
     }
     
-    double getTotalAmount() const {
+    Amount getTotalAmount() const {
         return amount + fee;
     }
+    
+    // Base units per encoded byte
+    double feeRate() const {
+        return static_cast<double>(fee) / static_cast<double>(encodedSize());
+    }
+    
+    // Body (what the txId hashes): version, addresses, amounts, timestamp, metadata; the
+    // encoded transaction appends the signature. The txId itself is recomputed on decode.
+    template <typename Writer>
+    void encodeBody(Writer& out) const {
+        out.putByte(ENCODING_VERSION);
+        out.putAddress(sender);
+        out.putAddress(receiver);
+        out.putAmount(amount);
+        out.putAmount(fee);
+        out.putTime(timestamp);
+        out.putVarint(metadata.size());
+        for (const auto& entry : metadata) {
+            out.putString(entry.first);
+            out.putString(entry.second);
+        }
+    }
+    
+    template <typename Writer>
+    void encode(Writer& out) const {
+        encodeBody(out);
+        out.putHash(signature);
+    }
+    
+    size_t encodedSize() const {
+        ByteCounter counter;
+        encode(counter);
+        return counter.size();
+    }
+    
+    // Writes encodedSize() bytes to `out`; returns the number written
+    size_t encode(uint8_t* out) const {
+        ByteWriter writer(out);
+        encode(writer);
+        return writer.size();
+    }
+    
+    // Decodes into an existing transaction, reusing its metadata strings
+    static void decode(ByteReader& in, Transaction& tx) {
+        const uint8_t* body = in.position();
+        uint8_t version = in.getByte();
+        if (version != ENCODING_VERSION) {
+            throw std::runtime_error("Unsupported transaction encoding version " + std::to_string(version));
+        }
+        in.getAddress(tx.sender);
+        in.getAddress(tx.receiver);
+        tx.amount = in.getAmount();
+        tx.fee = in.getAmount();
+        tx.timestamp = in.getTime();
+        size_t entries = in.getVarint();
+        if (entries > in.remaining() / 2) {
+            throw std::runtime_error("Truncated transaction metadata");
+        }
+        tx.metadata.resize(entries);
+        for (auto& entry : tx.metadata) {
+            in.getString(entry.first);
+            in.getString(entry.second);
+        }
+        tx.txId = CryptoHash::sha256(body, static_cast<size_t>(in.position() - body));
+        tx.signature = in.getHash();
+    }
+    
+    static Transaction decode(ByteReader& in) {
+        Transaction tx;
+        decode(in, tx);
+        return tx;
+    }
+    
+private:
+    Transaction() : txId{}, amount(0), fee(0) {}
+};
+
+// Reference to a transaction output: the id it was created under and its position
+struct OutPoint {
+    Hash256 txId;
+    uint32_t index;
+    
+    bool operator==(const OutPoint& other) const {
+        return index == other.index && txId == other.txId;
+    }
+    
+    bool operator<(const OutPoint& other) const {
+        return txId != other.txId ? txId < other.txId : index < other.index;
+    }
+};
+
+struct OutPointHash {
+    size_t operator()(const OutPoint& point) const {
+        return DigestHash()(point.txId) ^ (point.index * 0x9E3779B97F4A7C15ull);
+    }
 };
 
 // UTXO (Unspent Transaction Output)
 class UTXO {
 public:
-    std::string txId;
+    Hash256 txId;
     int outputIndex;
-    std::string owner;
-    double amount;
+    Address owner;
+    Amount amount;
     bool spent;
     
-    UTXO(const std::string& id, int index, const std::string& addr, double amt)
+    UTXO() : txId{}, outputIndex(0), amount(0), spent(false) {}
+    
+    UTXO(const Hash256& id, int index, const Address& addr, Amount amt)
         : txId(id), outputIndex(index), owner(addr), amount(amt), spent(false) {}
     
+    OutPoint outpoint() const {
+        return {txId, static_cast<uint32_t>(outputIndex)};
+    }
+    
     std::string getKey() const {
-        return txId + ":" + std::to_string(outputIndex);
+        return CryptoHash::toHex(txId) + ":" + std::to_string(outputIndex);
     }
 };
 
@@ -190,86 +923,295 @@ public:
 class Block {
 public:
     int index;
-    std::string previousHash;
-    std::string merkleRoot;
+    Hash256 previousHash;
+    Hash256 merkleRoot;
     std::chrono::time_point<std::chrono::system_clock> timestamp;
     std::vector<Transaction> transactions;
-    int nonce;
-    std::string hash;
+    uint32_t nonce;
+    Hash256 hash;
     int difficulty;
-    std::string minerAddress;
-    double blockReward;
+    Address minerAddress;
+    Amount blockReward;
+    MerkleTree txTree; // Cached tree over the txIds of `transactions`
     
-    Block(int idx, const std::string& prevHash, int diff = 4)
-        : index(idx), previousHash(prevHash), difficulty(diff), nonce(0),
-          timestamp(std::chrono::system_clock::now()), blockReward(50.0) {}
+    // Fixed binary header: index, previous hash, merkle root, timestamp (ms), difficulty, nonce
+    static constexpr size_t HEADER_SIZE = 4 + 32 + 32 + 8 + 4 + 4;
+    static constexpr size_t NONCE_OFFSET = HEADER_SIZE - 4;
     
+    // Encoded block: version, header, miner address, reward, transaction count, transactions
+    static constexpr uint8_t ENCODING_VERSION = 1;
+    static constexpr size_t MIN_ENCODED_SIZE = 1 + HEADER_SIZE + 3;
+    
+    Block(int idx, const Hash256& prevHash, int diff = 4)
+        : index(idx), previousHash(prevHash), merkleRoot{}, timestamp(std::chrono::system_clock::now()),
+          nonce(0), hash{}, difficulty(diff), blockReward(50 * COIN) {}
+    
+    // Appends update the cached tree along one path; after editing `transactions`
+    // directly, call updateMerkleRoot to rebuild it
     void addTransaction(const Transaction& tx) {
+        if (txTree.size() != transactions.size()) {
+            rebuildTxTree();
+        }
         transactions.push_back(tx);
-        updateMerkleRoot();
+        txTree.append(tx.txId);
+        merkleRoot = txTree.root();
     }
     
     void updateMerkleRoot() {
-        std::vector<std::string> txHashes;
+        rebuildTxTree();
+        merkleRoot = txTree.root();
+    }
+    
+    void rebuildTxTree() {
+        txTree.clear();
+        for (const auto& tx : transactions) {
+            txTree.append(tx.txId);
+        }
+    }
+    
+    // Inclusion proof for a light client holding only the header's merkle root
+    MerkleProof proveTransaction(size_t position) const {
+        if (txTree.size() == transactions.size()) {
+            return txTree.prove(position);
+        }
+        MerkleTree tree;
+        for (const auto& tx : transactions) {
+            tree.append(tx.txId);
+        }
+        return tree.prove(position);
+    }
+    
+    Hash256 calculateMerkleRoot() const {
+        std::vector<Hash256> txHashes;
+        txHashes.reserve(transactions.size());
         for (const auto& tx : transactions) {
             txHashes.push_back(tx.txId);
         }
-        merkleRoot = CryptoHash::merkleRoot(txHashes);
+        return CryptoHash::merkleRoot(std::move(txHashes));
     }
     
-    std::string calculateHash() const {
-        std::stringstream ss;
-        ss << index << previousHash << merkleRoot << nonce << difficulty
-           << std::chrono::duration_cast<std::chrono::milliseconds>(
-               timestamp.time_since_epoch()).count();
-        return CryptoHash::hash(ss.str());
+    static void putLittleEndian(uint8_t* out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
     }
     
-    bool mine(const std::string& miner) {
+    void serializeHeader(uint8_t* out) const {
+        putLittleEndian(out, static_cast<uint32_t>(index), 4);
+        std::memcpy(out + 4, previousHash.data(), 32);
+        std::memcpy(out + 36, merkleRoot.data(), 32);
+        putLittleEndian(out + 68, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            timestamp.time_since_epoch()).count()), 8);
+        putLittleEndian(out + 76, static_cast<uint32_t>(difficulty), 4);
+        putLittleEndian(out + NONCE_OFFSET, nonce, 4);
+    }
+    
+    Hash256 calculateHash() const {
+        uint8_t header[HEADER_SIZE];
+        serializeHeader(header);
+        return CryptoHash::sha256(header, sizeof(header));
+    }
+    
+    // Difficulty counts leading zero hex digits, so the target is four zero bits per digit
+    int targetBits() const {
+        return difficulty * 4;
+    }
+    
+    bool meetsDifficulty(const Hash256& digest) const {
+        return CryptoHash::leadingZeroBits(digest) >= targetBits();
+    }
+    
+    // Splits the nonce space across `threadCount` threads (0: one per hardware thread)
+    bool mine(const Address& miner, unsigned threadCount = 0, bool verbose = true) {
         minerAddress = miner;
-        std::string target(difficulty, '0');
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
         
-        std::cout << "Mining block " << index << " (difficulty: " << difficulty << ")..." << std::endl;
+        if (!verbose) {
+            searchNonce(threadCount);
+            return true;
+        }
         
-        auto startTime = std::chrono::high_resolution_clock::now();
-        
-        do {
-            nonce++;
-            hash = calculateHash();
-            
-            // Show mining progress
-            if (nonce % 100000 == 0) {
-                std::cout << "Nonce: " << nonce << ", Hash: " << hash.substr(0, 16) << "..." << std::endl;
-            }
-            
-        } while (hash.substr(0, difficulty) != target);
+        std::cout << "Mining block " << index << " (difficulty: " << difficulty 
+                  << ", threads: " << threadCount << ")..." << std::endl;
         
+        auto startTime = std::chrono::high_resolution_clock::now();
+        std::vector<uint64_t> hashes = searchNonce(threadCount);
         auto endTime = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+        double seconds = std::max(std::chrono::duration<double>(endTime - startTime).count(), 1e-9);
         
-        std::cout << "Block mined! Hash: " << hash << std::endl;
+        std::cout << "Block mined! Hash: " << CryptoHash::toHex(hash) << std::endl;
         std::cout << "Mining time: " << duration.count() << " ms" << std::endl;
         std::cout << "Nonce: " << nonce << std::endl;
+        for (size_t t = 0; t < hashes.size(); t++) {
+            std::cout << "  Thread " << t << ": " << hashes[t] << " hashes, " 
+                      << static_cast<uint64_t>(hashes[t] / seconds) << " H/s" << std::endl;
+        }
         
         return true;
     }
     
+    // Returns the attempts made by each thread. The first 64 header bytes do not depend on
+    // the nonce, so they are compressed once (the midstate); every attempt only patches the
+    // nonce into a pre-padded final block and compresses that one block.
+    std::vector<uint64_t> searchNonce(unsigned threadCount) {
+        std::vector<uint64_t> hashes(threadCount, 0);
+        
+        while (true) {
+            uint8_t header[HEADER_SIZE];
+            serializeHeader(header);
+            
+            uint32_t midstate[8];
+            CryptoHash::initialState(midstate);
+            CryptoHash::compress(midstate, header, 1);
+            
+            uint8_t tail[64] = {};
+            std::memcpy(tail, header + 64, HEADER_SIZE - 64);
+            tail[HEADER_SIZE - 64] = 0x80;
+            uint64_t bitLength = HEADER_SIZE * 8;
+            for (int i = 0; i < 8; i++) {
+                tail[56 + i] = static_cast<uint8_t>(bitLength >> (56 - 8 * i));
+            }
+            
+            int target = targetBits();
+            std::atomic<bool> found(false);
+            std::atomic<uint32_t> winner(0);
+            
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < threadCount; t++) {
+                threads.emplace_back([&, t]() {
+                    uint8_t block[64];
+                    std::memcpy(block, tail, sizeof(block));
+                    uint64_t attempts = 0;
+                    
+                    for (uint64_t candidate = t; candidate <= UINT32_MAX; candidate += threadCount) {
+                        if (found.load(std::memory_order_relaxed)) break;
+                        
+                        putLittleEndian(block + NONCE_OFFSET - 64, candidate, 4);
+                        uint32_t state[8];
+                        std::memcpy(state, midstate, sizeof(state));
+                        CryptoHash::compress(state, block, 1);
+                        attempts++;
+                        
+                        if (CryptoHash::leadingZeroBits(state) >= target) {
+                            bool expected = false;
+                            if (found.compare_exchange_strong(expected, true)) {
+                                winner = static_cast<uint32_t>(candidate);
+                            }
+                            break;
+                        }
+                    }
+                    hashes[t] += attempts;
+                });
+            }
+            
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            
+            if (found) {
+                nonce = winner;
+                hash = calculateHash();
+                return hashes;
+            }
+            
+            // Nonce space exhausted: a later timestamp gives a fresh header
+            timestamp += std::chrono::milliseconds(1);
+        }
+    }
+    
+    // The header is kept in its fixed hashing layout; the hash is recomputed from it on decode
+    template <typename Writer>
+    void encode(Writer& out) const {
+        uint8_t header[HEADER_SIZE];
+        serializeHeader(header);
+        out.putByte(ENCODING_VERSION);
+        out.putBytes(header, HEADER_SIZE);
+        out.putAddress(minerAddress);
+        out.putAmount(blockReward);
+        out.putVarint(transactions.size());
+        for (const auto& tx : transactions) {
+            tx.encode(out);
+        }
+    }
+    
+    size_t encodedSize() const {
+        ByteCounter counter;
+        encode(counter);
+        return counter.size();
+    }
+    
+    // Writes encodedSize() bytes to `out`; returns the number written
+    size_t encode(uint8_t* out) const {
+        ByteWriter writer(out);
+        encode(writer);
+        return writer.size();
+    }
+    
+    // Hash of an encoded block, read straight from its header bytes
+    static Hash256 encodedHash(const uint8_t* data) {
+        return CryptoHash::sha256(data + 1, HEADER_SIZE);
+    }
+    
+    static Block decode(const uint8_t* data, size_t size) {
+        Block block(0, Hash256{});
+        decode(data, size, block);
+        return block;
+    }
+    
+    // Decodes into an existing block. Its transactions are decoded in place, so a block reused
+    // for decoding allocates only when it holds fewer transactions than the one decoded.
+    static void decode(const uint8_t* data, size_t size, Block& block) {
+        ByteReader in(data, size);
+        uint8_t version = in.getByte();
+        if (version != ENCODING_VERSION) {
+            throw std::runtime_error("Unsupported block encoding version " + std::to_string(version));
+        }
+        block.index = static_cast<int>(in.getUint(4));
+        block.previousHash = in.getHash();
+        block.merkleRoot = in.getHash();
+        block.timestamp = std::chrono::system_clock::time_point(
+            std::chrono::milliseconds(static_cast<int64_t>(in.getUint(8))));
+        block.difficulty = static_cast<int>(in.getUint(4));
+        block.nonce = static_cast<uint32_t>(in.getUint(4));
+        block.hash = encodedHash(data);
+        in.getAddress(block.minerAddress);
+        block.blockReward = in.getAmount();
+        
+        size_t txCount = in.getVarint();
+        if (txCount > in.remaining()) {
+            throw std::runtime_error("Truncated block: " + std::to_string(txCount) + " transactions");
+        }
+        auto& txs = block.transactions;
+        if (txs.size() > txCount) txs.erase(txs.begin() + txCount, txs.end());
+        for (auto& tx : txs) {
+            Transaction::decode(in, tx);
+        }
+        txs.reserve(txCount);
+        while (txs.size() < txCount) {
+            txs.push_back(Transaction::decode(in));
+        }
+        block.txTree.clear(); // Rebuilt on demand
+    }
+    
     bool isValid() const {
         if (hash != calculateHash()) return false;
+        if (!meetsDifficulty(hash)) return false;
         
-        std::string target(difficulty, '0');
-        if (hash.substr(0, difficulty) != target) return false;
+        if (merkleRoot != calculateMerkleRoot()) return false;
         
         // Verify all transactions
         for (const auto& tx : transactions) {
-            if (!tx.verify()) return false;
+            if (!tx.isCoinbase() && !tx.verify()) return false;
         }
         
         return true;
     }
     
-    double getTotalFees() const {
-        double totalFees = 0.0;
+    Amount getTotalFees() const {
+        Amount totalFees = 0;
         for (const auto& tx : transactions) {
             totalFees += tx.fee;
         }
@@ -279,12 +1221,12 @@ public:
     std::string toString() const {
         std::stringstream ss;
         ss << "Block #" << index << "\n";
-        ss << "Hash: " << hash << "\n";
-        ss << "Previous: " << previousHash << "\n";
-        ss << "Merkle Root: " << merkleRoot << "\n";
+        ss << "Hash: " << CryptoHash::toHex(hash) << "\n";
+        ss << "Previous: " << CryptoHash::toHex(previousHash) << "\n";
+        ss << "Merkle Root: " << CryptoHash::toHex(merkleRoot) << "\n";
         ss << "Transactions: " << transactions.size() << "\n";
-        ss << "Miner: " << minerAddress.substr(0, 16) << "...\n";
-        ss << "Reward: " << blockReward + getTotalFees() << " coins\n";
+        ss << "Miner: " << minerAddress.toString().substr(0, 16) << "...\n";
+        ss << "Reward: " << toCoins(blockReward + getTotalFees()) << " coins\n";
         ss << "Nonce: " << nonce << "\n";
         return ss.str();
     }
@@ -294,130 +1236,1254 @@ public:
 class Wallet {
 private:
     DigitalSignature keyPair;
-    std::string address;
+    Address address;
     
 public:
     Wallet() {
-        address = keyPair.getPublicKey();
+        address = Address(keyPair.getPublicKey());
     }
     
-    std::string getAddress() const { return address; }
+    const Address& getAddress() const { return address; }
     
-    Transaction createTransaction(const std::string& to, double amount, double fee = 0.001) {
+    Transaction createTransaction(const Address& to, double amount, double fee = 0.001) {
         Transaction tx(address, to, amount, fee);
         tx.sign(keyPair);
         return tx;
     }
     
-    bool verifyOwnership(const std::string& message, const std::string& signature) const {
+    bool verifyOwnership(const std::string& message, const Hash256& signature) const {
         return keyPair.verify(message, signature);
     }
 };
 
-// Memory pool for pending transactions
+// Memory pool for pending transactions. Indexed by txId (O(1) dedup), by fee rate (an
+// ordered set: best first for block assembly, worst last for eviction) and by sender.
 class MemoryPool {
 private:
-    std::vector<Transaction> pendingTransactions;
-    std::mutex poolMutex;
+    // Highest fee rate first; ties go to the earlier arrival
+    struct Priority {
+        double feeRate;
+        uint64_t sequence;
+        Hash256 txId;
+        
+        bool operator<(const Priority& other) const {
+            if (feeRate != other.feeRate) return feeRate > other.feeRate;
+            return sequence < other.sequence;
+        }
+    };
+    
+    struct Entry {
+        Transaction tx;
+        std::set<Priority>::iterator priority;
+    };
+    
+    std::unordered_map<Hash256, Entry, DigestHash> byId;
+    std::set<Priority> byFeeRate;
+    std::unordered_map<Address, std::unordered_set<Hash256, DigestHash>, AddressHash> bySender;
+    uint64_t nextSequence = 0;
+    mutable std::mutex poolMutex;
     size_t maxSize;
     
+    // Caller holds poolMutex
+    void erase(std::unordered_map<Hash256, Entry, DigestHash>::iterator it) {
+        auto sender = bySender.find(it->second.tx.sender);
+        if (sender != bySender.end()) {
+            sender->second.erase(it->first);
+            if (sender->second.empty()) bySender.erase(sender);
+        }
+        byFeeRate.erase(it->second.priority);
+        byId.erase(it);
+    }
+    
 public:
     MemoryPool(size_t maxPoolSize = 10000) : maxSize(maxPoolSize) {}
     
-    void addTransaction(const Transaction& tx) {
-        std::lock_guard<std::mutex> lock(poolMutex);
+    // Returns false for invalid or duplicate transactions, and for ones that pay a lower
+    // fee rate than everything in a full pool
+    bool addTransaction(const Transaction& tx) {
+        if (!tx.verify()) return false;
+        double feeRate = tx.feeRate();
         
-        // Verify transaction before adding
-        if (!tx.verify()) {
-            std::cout << "Invalid transaction rejected: " << tx.txId << std::endl;
-            return;
-        }
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (byId.count(tx.txId)) return false;
         
-        // Check for duplicate
-        for (const auto& existingTx : pendingTransactions) {
-            if (existingTx.txId == tx.txId) {
-                return; // Already exists
-            }
+        if (byId.size() >= maxSize) {
+            if (maxSize == 0 || !(feeRate > byFeeRate.rbegin()->feeRate)) return false;
+            erase(byId.find(byFeeRate.rbegin()->txId));
         }
         
-        pendingTransactions.push_back(tx);
+        auto priority = byFeeRate.insert(Priority{feeRate, nextSequence++, tx.txId}).first;
+        byId.emplace(tx.txId, Entry{tx, priority});
+        bySender[tx.sender].insert(tx.txId);
+        return true;
+    }
+    
+    // Highest fee rate first
+    std::vector<Transaction> getTransactions(size_t maxCount = 100) const {
+        std::lock_guard<std::mutex> lock(poolMutex);
         
-        // Remove oldest transactions if pool is full
-        if (pendingTransactions.size() > maxSize) {
-            pendingTransactions.erase(pendingTransactions.begin());
+        std::vector<Transaction> selected;
+        selected.reserve(std::min(maxCount, byFeeRate.size()));
+        for (auto it = byFeeRate.begin(); it != byFeeRate.end() && selected.size() < maxCount; ++it) {
+            selected.push_back(byId.at(it->txId).tx);
         }
-        
-        std::cout << "Transaction added to mempool: " << tx.toString() << std::endl;
+        return selected;
     }
     
-    std::vector<Transaction> getTransactions(size_t maxCount = 100) {
+    std::vector<Transaction> getTransactionsFrom(const Address& sender) const {
         std::lock_guard<std::mutex> lock(poolMutex);
         
-        // Sort by fee (highest first) for priority processing
-        std::sort(pendingTransactions.begin(), pendingTransactions.end(),
-                  [](const Transaction& a, const Transaction& b) {
-                      return a.fee > b.fee;
-                  });
-        
-        size_t count = std::min(maxCount, pendingTransactions.size());
-        return std::vector<Transaction>(pendingTransactions.begin(), 
-                                       pendingTransactions.begin() + count);
+        std::vector<Transaction> pending;
+        auto it = bySender.find(sender);
+        if (it != bySender.end()) {
+            for (const Hash256& txId : it->second) {
+                pending.push_back(byId.at(txId).tx);
+            }
+        }
+        return pending;
+    }
+    
+    bool contains(const Hash256& txId) const {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        return byId.count(txId) != 0;
+    }
+    
+    std::optional<Transaction> getTransaction(const Hash256& txId) const {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        auto it = byId.find(txId);
+        if (it == byId.end()) return std::nullopt;
+        return it->second.tx;
     }
     
     void removeTransactions(const std::vector<Transaction>& txs) {
         std::lock_guard<std::mutex> lock(poolMutex);
         
         for (const auto& tx : txs) {
-            pendingTransactions.erase(
-                std::remove_if(pendingTransactions.begin(), pendingTransactions.end(),
-                              [&tx](const Transaction& t) { return t.txId == tx.txId; }),
-                pendingTransactions.end());
+            auto it = byId.find(tx.txId);
+            if (it != byId.end()) erase(it);
         }
     }
     
     size_t size() const {
         std::lock_guard<std::mutex> lock(poolMutex);
-        return pendingTransactions.size();
+        return byId.size();
     }
     
     void clear() {
         std::lock_guard<std::mutex> lock(poolMutex);
-        pendingTransactions.clear();
+        byId.clear();
+        byFeeRate.clear();
+        bySender.clear();
+    }
+};
+
+// Unspent outputs keyed by binary outpoint, plus a per-address index of unspent coins,
+// running balance and transaction history. Blocks are applied and disconnected incrementally.
+// A transfer spends the sender's coins in outpoint order; output 0 pays the receiver and
+// output 1 returns the change. Block reward and fees go to the miner as outputs 0 and 1 of
+// the block hash, which (unlike a coinbase txId) is unique.
+class UtxoSet {
+public:
+    // Position of a transaction in the chain
+    struct TxLocation {
+        uint32_t height;
+        uint32_t position;
+    };
+    
+    struct AddressEntry {
+        Amount balance = 0;
+        std::set<OutPoint> unspent;
+        std::vector<TxLocation> history;
+    };
+    
+    // An unspent output of a known owner
+    struct Coin {
+        OutPoint point;
+        Amount amount;
+    };
+    
+    // What applyBlock changed, so the block can be disconnected again
+    struct BlockUndo {
+        std::vector<UTXO> spent;
+        std::vector<OutPoint> created;
+        std::vector<Address> historyTouched;
+    };
+    
+private:
+    std::unordered_map<OutPoint, UTXO, OutPointHash> outputs;
+    std::unordered_map<Address, AddressEntry, AddressHash> addresses;
+    Amount totalValue = 0;
+    size_t transactionCount = 0;
+    
+    void insert(const UTXO& coin) {
+        AddressEntry& entry = addresses[coin.owner];
+        entry.unspent.insert(coin.outpoint());
+        entry.balance += coin.amount;
+        totalValue += coin.amount;
+    }
+    
+    void erase(const OutPoint& point) {
+        auto it = outputs.find(point);
+        AddressEntry& entry = addresses[it->second.owner];
+        entry.unspent.erase(point);
+        entry.balance -= it->second.amount;
+        totalValue -= it->second.amount;
+        outputs.erase(it);
+    }
+    
+    bool create(const OutPoint& point, const Address& owner, Amount amount, BlockUndo& undo) {
+        if (amount <= 0) return true; // No empty outputs
+        UTXO coin(point.txId, static_cast<int>(point.index), owner, amount);
+        if (!outputs.emplace(point, coin).second) return false;
+        insert(coin);
+        undo.created.push_back(point);
+        return true;
+    }
+    
+    // Spends the owner's coins, lowest outpoint first, until `total` is covered
+    bool spend(const Address& owner, Amount total, Amount& gathered, BlockUndo& undo) {
+        auto it = addresses.find(owner);
+        if (it == addresses.end() || it->second.balance < total) return false;
+        
+        std::set<OutPoint>& coins = it->second.unspent;
+        gathered = 0;
+        while (gathered < total && !coins.empty()) {
+            OutPoint point = *coins.begin();
+            const UTXO& coin = outputs.at(point);
+            gathered += coin.amount;
+            undo.spent.push_back(coin);
+            erase(point);
+        }
+        return gathered >= total;
+    }
+    
+    void recordHistory(const Address& address, const TxLocation& location, BlockUndo& undo) {
+        addresses[address].history.push_back(location);
+        undo.historyTouched.push_back(address);
+    }
+    
+    // Spent coins are restored first: an output created and spent within the block is
+    // then present again when the created outputs are erased
+    void rollback(const BlockUndo& undo) {
+        for (auto it = undo.historyTouched.rbegin(); it != undo.historyTouched.rend(); ++it) {
+            addresses[*it].history.pop_back();
+        }
+        for (auto it = undo.spent.rbegin(); it != undo.spent.rend(); ++it) {
+            outputs.emplace(it->outpoint(), *it);
+            insert(*it);
+        }
+        for (auto it = undo.created.rbegin(); it != undo.created.rend(); ++it) {
+            erase(*it);
+        }
+    }
+    
+public:
+    // Applies every transfer of the block at `height`. On failure (a sender without enough
+    // coins, or an output that already exists) the set is left unchanged.
+    bool applyBlock(const Block& block, uint32_t height, BlockUndo* undoOut = nullptr) {
+        BlockUndo undo;
+        bool ok = true;
+        for (uint32_t position = 0; ok && position < block.transactions.size(); position++) {
+            const Transaction& tx = block.transactions[position];
+            TxLocation location{height, position};
+            if (height == 0) {
+                // Genesis transactions mint the initial supply
+                ok = create({tx.txId, 0}, tx.receiver, tx.amount, undo);
+            } else if (tx.isCoinbase()) {
+                ok = create({block.hash, 0}, tx.receiver, tx.amount, undo);
+            } else {
+                Amount gathered = 0;
+                ok = spend(tx.sender, tx.getTotalAmount(), gathered, undo) &&
+                     create({tx.txId, 0}, tx.receiver, tx.amount, undo) &&
+                     create({tx.txId, 1}, tx.sender, gathered - tx.getTotalAmount(), undo);
+                if (ok) recordHistory(tx.sender, location, undo);
+            }
+            if (ok) recordHistory(tx.receiver, location, undo);
+        }
+        if (ok && height > 0) {
+            ok = create({block.hash, 1}, block.minerAddress, block.getTotalFees(), undo);
+        }
+        
+        if (!ok) {
+            rollback(undo);
+            return false;
+        }
+        transactionCount += block.transactions.size();
+        if (undoOut) {
+            *undoOut = std::move(undo);
+        }
+        return true;
+    }
+    
+    void disconnectBlock(const Block& block, const BlockUndo& undo) {
+        rollback(undo);
+        transactionCount -= block.transactions.size();
     }
+    
+    // Adds an output that is not backed by a chain transaction
+    bool credit(const OutPoint& point, const Address& owner, Amount amount) {
+        BlockUndo ignored;
+        return create(point, owner, amount, ignored);
+    }
+    
+    Amount balanceOf(const Address& address) const {
+        auto it = addresses.find(address);
+        return (it != addresses.end()) ? it->second.balance : 0;
+    }
+    
+    const AddressEntry* find(const Address& address) const {
+        auto it = addresses.find(address);
+        return (it != addresses.end()) ? &it->second : nullptr;
+    }
+    
+    std::vector<Coin> coinsOf(const AddressEntry& entry) const {
+        std::vector<Coin> coins;
+        coins.reserve(entry.unspent.size());
+        for (const auto& point : entry.unspent) {
+            coins.push_back({point, outputs.at(point).amount});
+        }
+        return coins;
+    }
+    
+    const std::unordered_map<Address, AddressEntry, AddressHash>& getAddresses() const { return addresses; }
+    size_t size() const { return outputs.size(); }
+    Amount getTotalValue() const { return totalValue; }
+    size_t getTransactionCount() const { return transactionCount; }
+};
+
+#ifdef BLOCKCHAIN_BLOCK_STORE
+// Append-only on-disk block store. Blocks are framed records in numbered segment files; a
+// memory-mapped index maps each height to its record, mirrored in memory by a hash -> height
+// table. Segments are mapped read-only at full capacity, so stored blocks are read in place.
+// Files only ever grow while the store is open: truncation marks records dead instead of
+// shrinking segments under readers.
+class BlockStore {
+public:
+    struct Options {
+        uint64_t segmentSize = 128ull << 20;
+        uint32_t syncEvery = 1; // fsync after this many appends; 0 leaves syncing to flush()
+    };
+    
+    // Bytes of a stored block, valid for the lifetime of the store (also across truncate)
+    struct BlockBytes {
+        const uint8_t* data;
+        size_t size;
+    };
+    
+private:
+    static constexpr uint32_t RECORD_MAGIC = 0x4B4C4231;
+    static constexpr uint32_t DEAD_RECORD_MAGIC = 0x44414544; // Dropped by truncate(), skipped on recovery
+    static constexpr uint32_t INDEX_MAGIC = 0x58444931;
+    static constexpr uint32_t INDEX_VERSION = 1;
+    static constexpr size_t RECORD_HEADER = 12; // magic, payload length, checksum
+    static constexpr size_t INDEX_HEADER = 64;
+    
+    struct IndexHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t count;
+    };
+    
+    struct IndexEntry {
+        uint8_t hash[32];
+        uint32_t segment;
+        uint32_t length; // payload bytes
+        uint64_t offset; // record start within the segment
+    };
+    static_assert(sizeof(IndexEntry) == 48, "index entries are fixed-size");
+    
+    struct Segment {
+        int fd = -1;
+        uint64_t size = 0;
+        uint8_t* map = nullptr;
+        size_t mapSize = 0;
+    };
+    
+    std::string directory;
+    Options options;
+    std::vector<Segment> segments;
+    int indexFd = -1;
+    uint8_t* indexMap = nullptr;
+    size_t indexCapacity = 0;
+    uint64_t count = 0;
+    uint32_t unsynced = 0;
+    std::unordered_map<Hash256, uint32_t, DigestHash> heightByHash;
+    std::vector<uint8_t> record; // reused encoding buffer
+    mutable std::mutex storeMutex;
+    
+    static void check(bool ok, const std::string& what) {
+        if (!ok) {
+            throw std::runtime_error("Block store: " + what + ": " + std::strerror(errno));
+        }
+    }
+    
+    static uint32_t checksum(const uint8_t* data, size_t size) {
+        uint32_t h = 2166136261u; // FNV-1a
+        for (size_t i = 0; i < size; i++) {
+            h = (h ^ data[i]) * 16777619u;
+        }
+        return h;
+    }
+    
+    static uint32_t readUint32(const uint8_t* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+    
+    std::string segmentPath(size_t number) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "blk%05zu.dat", number);
+        return directory + "/" + name;
+    }
+    
+    IndexHeader* indexHeader() const {
+        return reinterpret_cast<IndexHeader*>(indexMap);
+    }
+    
+    IndexEntry* entry(uint64_t height) const {
+        return reinterpret_cast<IndexEntry*>(indexMap + INDEX_HEADER) + height;
+    }
+    
+    void openSegment(size_t number, bool create) {
+        Segment segment;
+        segment.fd = ::open(segmentPath(number).c_str(), O_RDWR | (create ? O_CREAT : 0), 0644);
+        check(segment.fd >= 0, "cannot open " + segmentPath(number));
+        struct stat info;
+        check(::fstat(segment.fd, &info) == 0, "cannot stat " + segmentPath(number));
+        segment.size = static_cast<uint64_t>(info.st_size);
+        
+        // Mapped past EOF so appended records become readable without remapping
+        segment.mapSize = static_cast<size_t>(std::max<uint64_t>(options.segmentSize, segment.size));
+        void* map = ::mmap(nullptr, segment.mapSize, PROT_READ, MAP_SHARED, segment.fd, 0);
+        check(map != MAP_FAILED, "cannot map " + segmentPath(number));
+        segment.map = static_cast<uint8_t*>(map);
+        segments.push_back(segment);
+    }
+    
+    void mapIndex(size_t capacity) {
+        size_t bytes = INDEX_HEADER + capacity * sizeof(IndexEntry);
+        check(::ftruncate(indexFd, static_cast<off_t>(bytes)) == 0, "cannot grow index");
+        if (indexMap) {
+            ::munmap(indexMap, INDEX_HEADER + indexCapacity * sizeof(IndexEntry));
+        }
+        void* map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, indexFd, 0);
+        check(map != MAP_FAILED, "cannot map index");
+        indexMap = static_cast<uint8_t*>(map);
+        indexCapacity = capacity;
+    }
+    
+    void openIndex() {
+        std::string path = directory + "/index.dat";
+        indexFd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        check(indexFd >= 0, "cannot open " + path);
+        struct stat info;
+        check(::fstat(indexFd, &info) == 0, "cannot stat " + path);
+        
+        size_t stored = info.st_size > static_cast<off_t>(INDEX_HEADER)
+            ? (static_cast<size_t>(info.st_size) - INDEX_HEADER) / sizeof(IndexEntry) : 0;
+        mapIndex(std::max<size_t>(stored, 1024));
+        
+        IndexHeader* header = indexHeader();
+        if (header->magic != INDEX_MAGIC || header->version != INDEX_VERSION || header->count > stored) {
+            // Missing or unreadable index: rebuilt from the segments by recover()
+            header->magic = INDEX_MAGIC;
+            header->version = INDEX_VERSION;
+            header->count = 0;
+        }
+        count = header->count;
+    }
+    
+    bool recordIntact(const IndexEntry& e) const {
+        if (e.segment >= segments.size()) return false;
+        const Segment& segment = segments[e.segment];
+        if (e.offset + RECORD_HEADER + e.length > segment.size) return false;
+        const uint8_t* p = segment.map + e.offset;
+        return readUint32(p) == RECORD_MAGIC && readUint32(p + 4) == e.length &&
+               readUint32(p + 8) == checksum(p + RECORD_HEADER, e.length);
+    }
+    
+    void addEntry(uint32_t segment, uint64_t offset, uint32_t length, const uint8_t* hash) {
+        if (count == indexCapacity) {
+            mapIndex(indexCapacity * 2);
+        }
+        IndexEntry* e = entry(count);
+        std::memcpy(e->hash, hash, 32);
+        e->segment = segment;
+        e->length = length;
+        e->offset = offset;
+        Hash256 key;
+        std::memcpy(key.data(), hash, 32);
+        heightByHash[key] = static_cast<uint32_t>(count);
+        indexHeader()->count = ++count;
+    }
+    
+    // Crash recovery: drops index entries whose records did not reach disk, indexes complete
+    // records written after the last index update, and truncates a torn trailing record
+    void recover() {
+        while (count > 0 && !recordIntact(*entry(count - 1))) {
+            count--;
+        }
+        indexHeader()->count = count;
+        for (uint64_t h = 0; h < count; h++) {
+            Hash256 key;
+            std::memcpy(key.data(), entry(h)->hash, 32);
+            heightByHash[key] = static_cast<uint32_t>(h);
+        }
+        
+        size_t number = 0;
+        uint64_t offset = 0;
+        if (count > 0) {
+            const IndexEntry* last = entry(count - 1);
+            number = last->segment;
+            offset = last->offset + RECORD_HEADER + last->length;
+        }
+        
+        for (; number < segments.size(); number++, offset = 0) {
+            Segment& segment = segments[number];
+            while (offset + RECORD_HEADER <= segment.size) {
+                const uint8_t* p = segment.map + offset;
+                uint32_t length = readUint32(p + 4);
+                uint32_t magic = readUint32(p);
+                if ((magic != RECORD_MAGIC && magic != DEAD_RECORD_MAGIC) || length < Block::MIN_ENCODED_SIZE ||
+                    offset + RECORD_HEADER + length > segment.size ||
+                    readUint32(p + 8) != checksum(p + RECORD_HEADER, length)) {
+                    break;
+                }
+                if (magic == DEAD_RECORD_MAGIC) {
+                    offset += RECORD_HEADER + length;
+                    continue;
+                }
+                Hash256 hash = Block::encodedHash(p + RECORD_HEADER);
+                addEntry(static_cast<uint32_t>(number), offset, length, hash.data());
+                offset += RECORD_HEADER + length;
+            }
+            if (offset < segment.size) {
+                // Everything after a torn record is unreachable; later segments are dropped too
+                check(::ftruncate(segment.fd, static_cast<off_t>(offset)) == 0, "cannot truncate segment");
+                segment.size = offset;
+                while (segments.size() > number + 1) {
+                    closeSegment(segments.back());
+                    ::unlink(segmentPath(segments.size() - 1).c_str());
+                    segments.pop_back();
+                }
+            }
+        }
+    }
+    
+    static void closeSegment(Segment& segment) {
+        if (segment.map) ::munmap(segment.map, segment.mapSize);
+        if (segment.fd >= 0) ::close(segment.fd);
+        segment = Segment();
+    }
+    
+    void syncLocked() {
+        if (unsynced == 0) return;
+        // Data before index, so a synced index entry never points at unsynced bytes
+        check(::fsync(segments.back().fd) == 0, "cannot sync segment");
+        check(::msync(indexMap, INDEX_HEADER + count * sizeof(IndexEntry), MS_SYNC) == 0, "cannot sync index");
+        unsynced = 0;
+    }
+    
+public:
+    explicit BlockStore(const std::string& dir) : BlockStore(dir, Options()) {}
+    
+    BlockStore(const std::string& dir, Options opts) : directory(dir), options(opts) {
+        std::filesystem::create_directories(directory);
+        for (size_t number = 0; std::filesystem::exists(segmentPath(number)); number++) {
+            openSegment(number, false);
+        }
+        if (segments.empty()) {
+            openSegment(0, true);
+        }
+        openIndex();
+        recover();
+    }
+    
+    BlockStore(const BlockStore&) = delete;
+    BlockStore& operator=(const BlockStore&) = delete;
+    
+    ~BlockStore() {
+        try {
+            flush();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+        for (auto& segment : segments) {
+            closeSegment(segment);
+        }
+        if (indexMap) ::munmap(indexMap, INDEX_HEADER + indexCapacity * sizeof(IndexEntry));
+        if (indexFd >= 0) ::close(indexFd);
+    }
+    
+    // Appends the block at the next height and returns that height
+    uint32_t append(const Block& block) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        size_t encodedSize = block.encodedSize();
+        if (RECORD_HEADER + encodedSize > options.segmentSize) {
+            throw std::runtime_error("Block store: block " + std::to_string(block.index) +
+                                     " is larger than a segment");
+        }
+        record.resize(RECORD_HEADER + encodedSize); // Capacity is kept, so appends stop allocating
+        uint32_t length = static_cast<uint32_t>(block.encode(record.data() + RECORD_HEADER));
+        Block::putLittleEndian(record.data(), RECORD_MAGIC, 4);
+        Block::putLittleEndian(record.data() + 4, length, 4);
+        Block::putLittleEndian(record.data() + 8, checksum(record.data() + RECORD_HEADER, length), 4);
+        
+        if (segments.back().size + record.size() > options.segmentSize) {
+            syncLocked();
+            openSegment(segments.size(), true);
+        }
+        Segment& segment = segments.back();
+        for (size_t written = 0; written < record.size();) {
+            ssize_t n = ::pwrite(segment.fd, record.data() + written, record.size() - written,
+                                 static_cast<off_t>(segment.size + written));
+            if (n < 0 && errno == EINTR) continue;
+            check(n > 0, "cannot write block " + std::to_string(block.index));
+            written += static_cast<size_t>(n);
+        }
+        
+        uint64_t offset = segment.size;
+        segment.size += record.size();
+        addEntry(static_cast<uint32_t>(segments.size() - 1), offset, length, block.hash.data());
+        unsynced++;
+        if (options.syncEvery && unsynced >= options.syncEvery) {
+            syncLocked();
+        }
+        return static_cast<uint32_t>(count - 1);
+    }
+    
+    void flush() {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        syncLocked();
+    }
+    
+    // Drops the blocks at `height` and above, e.g. when a chain reorganization replaces them.
+    // Only the record headers are rewritten as dead; payloads stay mapped for earlier reads
+    // and new blocks are appended after them.
+    void truncate(size_t height) {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (height >= count) return;
+        
+        uint8_t dead[4];
+        Block::putLittleEndian(dead, DEAD_RECORD_MAGIC, 4);
+        std::vector<bool> touched(segments.size(), false);
+        for (uint64_t h = height; h < count; h++) {
+            const IndexEntry* e = entry(h);
+            check(::pwrite(segments[e->segment].fd, dead, sizeof(dead), static_cast<off_t>(e->offset)) ==
+                  static_cast<ssize_t>(sizeof(dead)), "cannot mark block " + std::to_string(h) + " dead");
+            touched[e->segment] = true;
+            Hash256 key;
+            std::memcpy(key.data(), e->hash, 32);
+            heightByHash.erase(key);
+        }
+        
+        // Dead marks before the index, as in syncLocked()
+        for (size_t number = 0; number < segments.size(); number++) {
+            if (touched[number]) {
+                check(::fsync(segments[number].fd) == 0, "cannot sync segment");
+            }
+        }
+        count = height;
+        indexHeader()->count = count;
+        unsynced++;
+        syncLocked();
+    }
+    
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        return count;
+    }
+    
+    // Zero-copy access to the serialized block at `height`
+    BlockBytes read(size_t height) const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        if (height >= count) {
+            throw std::out_of_range("Block store: no block at height " + std::to_string(height));
+        }
+        const IndexEntry* e = entry(height);
+        return {segments[e->segment].map + e->offset + RECORD_HEADER, e->length};
+    }
+    
+    Block load(size_t height) const {
+        BlockBytes bytes = read(height);
+        return Block::decode(bytes.data, bytes.size);
+    }
+    
+    std::optional<size_t> heightOf(const Hash256& hash) const {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        auto it = heightByHash.find(hash);
+        if (it == heightByHash.end()) return std::nullopt;
+        return it->second;
+    }
+};
+#endif // BLOCKCHAIN_BLOCK_STORE
+
+// Consensus parameters every node of a network must share
+struct ConsensusRules {
+    Amount blockReward = 50 * COIN;   // Most a coinbase may claim; fees are paid to the miner separately
+    size_t retargetInterval = 10;     // Blocks between difficulty adjustments; 0 keeps the genesis difficulty
+    double targetBlockSeconds = 60.0; // Difficulty steps up when blocks come faster, down when slower
+};
+
+// Chain validation pipeline. Header hashes, proof of work, links, merkle roots, txIds and
+// signatures are independent per block and per transaction, so they are checked on a pool
+// of workers; applying blocks to the UTXO set depends on chain order and stays sequential.
+class ChainValidator {
+public:
+    // Ordered by precedence when a block fails several checks
+    enum class Failure : uint8_t { NONE, HASH, DIFFICULTY, LINK, MERKLE, TXID, AMOUNT, SIGNATURE, COINBASE, SPEND };
+    
+    struct Result {
+        bool valid = true;
+        size_t failedBlock = 0;
+        Failure failure = Failure::NONE;
+        double elapsedMs = 0.0;
+    };
+    
+    static const char* describe(Failure failure) {
+        switch (failure) {
+            case Failure::NONE: return "ok";
+            case Failure::HASH: return "header hash mismatch";
+            case Failure::DIFFICULTY: return "unexpected difficulty or insufficient proof of work";
+            case Failure::LINK: return "height or previous hash mismatch";
+            case Failure::MERKLE: return "merkle root mismatch";
+            case Failure::TXID: return "transaction id mismatch";
+            case Failure::AMOUNT: return "negative amount";
+            case Failure::SIGNATURE: return "invalid signature";
+            case Failure::COINBASE: return "invalid coinbase";
+            case Failure::SPEND: return "spends unavailable coins";
+        }
+        return "unknown";
+    }
+    
+private:
+    static constexpr size_t TX_CHUNK = 64;
+    
+    unsigned threadCount;
+    ConsensusRules rules;
+    
+    // One unit of stateless work: a block header (txBegin == txEnd) or a chunk of its transactions
+    struct WorkItem {
+        size_t block;
+        size_t txBegin;
+        size_t txEnd;
+    };
+    
+    template <typename Task>
+    void parallelFor(size_t count, Task task) const {
+        unsigned workers = static_cast<unsigned>(std::min<size_t>(threadCount, count));
+        if (workers <= 1) {
+            for (size_t i = 0; i < count; i++) task(i);
+            return;
+        }
+        
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> pool;
+        for (unsigned w = 0; w < workers; w++) {
+            pool.emplace_back([&]() {
+                for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                    task(i);
+                }
+            });
+        }
+        for (auto& worker : pool) {
+            worker.join();
+        }
+    }
+    
+    // Transactions of the genesis block mint the initial supply and are not signed
+    static Failure checkTransaction(const Transaction& tx, bool genesis) {
+        if (tx.txId != tx.calculateTxId()) return Failure::TXID;
+        if (tx.amount < 0 || tx.fee < 0) return Failure::AMOUNT; // Would mint change for the sender
+        if (genesis || tx.isCoinbase()) return Failure::NONE;
+        return tx.verify() ? Failure::NONE : Failure::SIGNATURE;
+    }
+    
+    template <typename Chain>
+    Failure checkHeader(const Chain& chain, size_t i) const {
+        const Block& block = chain[i];
+        Hash256 digest = block.calculateHash();
+        if (digest != block.hash) return Failure::HASH;
+        if (!block.meetsDifficulty(digest)) return Failure::DIFFICULTY;
+        if (i > 0 && block.difficulty != expectedDifficulty(rules, i, [&](size_t height) -> const Block& {
+                return chain[height];
+            })) {
+            return Failure::DIFFICULTY;
+        }
+        if (static_cast<size_t>(block.index) != i) return Failure::LINK;
+        if (i > 0 && block.previousHash != chain[i - 1].hash) return Failure::LINK;
+        if (block.merkleRoot != block.calculateMerkleRoot()) return Failure::MERKLE;
+        return checkCoinbase(block, rules, i == 0);
+    }
+    
+    // Every block after genesis opens with exactly one coinbase, claiming at most the reward
+    static Failure checkCoinbase(const Block& block, const ConsensusRules& rules, bool genesis) {
+        if (genesis) return Failure::NONE;
+        const auto& txs = block.transactions;
+        if (block.blockReward != rules.blockReward || txs.empty() || !txs[0].isCoinbase() ||
+            txs[0].amount > rules.blockReward) {
+            return Failure::COINBASE;
+        }
+        for (size_t i = 1; i < txs.size(); i++) {
+            if (txs[i].isCoinbase()) return Failure::COINBASE;
+        }
+        return Failure::NONE;
+    }
+    
+    static void recordFailure(std::atomic<uint8_t>& slot, Failure failure) {
+        uint8_t code = static_cast<uint8_t>(failure);
+        uint8_t current = slot.load();
+        while ((current == 0 || code < current) && !slot.compare_exchange_weak(current, code)) {}
+    }
+    
+public:
+    explicit ChainValidator(unsigned threads = 0, const ConsensusRules& consensus = ConsensusRules())
+        : threadCount(threads ? threads : std::max(1u, std::thread::hardware_concurrency())), rules(consensus) {}
+    
+    // Difficulty the block at `height` must declare: its parent's, except every retargetInterval
+    // blocks, where it moves one step towards targetBlockSeconds per block over the last
+    // interval. `ancestor(h)` returns the block at height h on the new block's branch.
+    template <typename Ancestor>
+    static int expectedDifficulty(const ConsensusRules& rules, size_t height, Ancestor ancestor) {
+        const Block& parent = ancestor(height - 1);
+        if (rules.retargetInterval == 0 || height % rules.retargetInterval != 0) return parent.difficulty;
+        
+        // Timestamps are compared at the millisecond precision the header hashes
+        auto milliseconds = [](const Block& block) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(block.timestamp.time_since_epoch()).count();
+        };
+        const Block& first = ancestor(height - rules.retargetInterval);
+        double averageSeconds = (milliseconds(parent) - milliseconds(first)) / 1000.0 / rules.retargetInterval;
+        if (averageSeconds < rules.targetBlockSeconds * 0.8) return parent.difficulty + 1;
+        if (averageSeconds > rules.targetBlockSeconds * 1.2 && parent.difficulty > 1) return parent.difficulty - 1;
+        return parent.difficulty;
+    }
+    
+    // Stateless checks of a single block, e.g. one received from a peer; its expected
+    // difficulty, linking it to its parent and replaying its spends are left to the caller
+    static Failure checkBlock(const Block& block, const ConsensusRules& rules) {
+        Hash256 digest = block.calculateHash();
+        if (digest != block.hash) return Failure::HASH;
+        if (!block.meetsDifficulty(digest)) return Failure::DIFFICULTY;
+        if (block.merkleRoot != block.calculateMerkleRoot()) return Failure::MERKLE;
+        for (const auto& tx : block.transactions) {
+            Failure failure = checkTransaction(tx, block.index == 0);
+            if (failure != Failure::NONE) return failure;
+        }
+        return checkCoinbase(block, rules, block.index == 0);
+    }
+    
+    // Stateless checks for a batch of incoming transactions; entry i is nonzero when tx i passes
+    std::vector<char> verifyTransactions(const std::vector<Transaction>& txs) const {
+        std::vector<char> passed(txs.size(), 0);
+        size_t chunks = (txs.size() + TX_CHUNK - 1) / TX_CHUNK;
+        parallelFor(chunks, [&](size_t chunk) {
+            size_t end = std::min(txs.size(), (chunk + 1) * TX_CHUNK);
+            for (size_t i = chunk * TX_CHUNK; i < end; i++) {
+                passed[i] = checkTransaction(txs[i], false) == Failure::NONE;
+            }
+        });
+        return passed;
+    }
+    
+    // Sequential pass: applies each block to the UTXO set in chain order. Returns the first
+    // block that spends coins its sender does not hold, or `limit` when all blocks apply.
+    template <typename Chain>
+    static size_t replayUtxos(const Chain& chain, size_t limit, UtxoSet& utxos,
+                              std::vector<UtxoSet::BlockUndo>* undoLog) {
+        for (size_t i = 0; i < limit; i++) {
+            UtxoSet::BlockUndo undo;
+            if (!utxos.applyBlock(chain[i], static_cast<uint32_t>(i), undoLog ? &undo : nullptr)) return i;
+            if (undoLog) undoLog->push_back(std::move(undo));
+        }
+        return limit;
+    }
+    
+    // Validates the whole chain (any sequence of blocks indexable by height). When given,
+    // `utxos` receives the replayed UTXO set and `undoLog` the undo data of every block.
+    template <typename Chain>
+    Result validate(const Chain& chain, UtxoSet* utxos = nullptr,
+                    std::vector<UtxoSet::BlockUndo>* undoLog = nullptr) const {
+        auto start = std::chrono::high_resolution_clock::now();
+        
+        std::vector<WorkItem> items;
+        for (size_t i = 0; i < chain.size(); i++) {
+            items.push_back({i, 0, 0});
+            size_t txCount = chain[i].transactions.size();
+            for (size_t begin = 0; begin < txCount; begin += TX_CHUNK) {
+                items.push_back({i, begin, std::min(txCount, begin + TX_CHUNK)});
+            }
+        }
+        
+        // Workers skip blocks past the earliest failure seen so far
+        std::vector<std::atomic<uint8_t>> failures(chain.size());
+        std::atomic<size_t> firstFailure{chain.size()};
+        parallelFor(items.size(), [&](size_t n) {
+            const WorkItem& item = items[n];
+            if (item.block > firstFailure.load(std::memory_order_relaxed)) return;
+            
+            Failure failure = Failure::NONE;
+            if (item.txBegin == item.txEnd) {
+                failure = checkHeader(chain, item.block);
+            } else {
+                const auto& txs = chain[item.block].transactions;
+                for (size_t t = item.txBegin; t < item.txEnd && failure == Failure::NONE; t++) {
+                    failure = checkTransaction(txs[t], item.block == 0);
+                }
+            }
+            if (failure == Failure::NONE) return;
+            
+            recordFailure(failures[item.block], failure);
+            size_t current = firstFailure.load();
+            while (item.block < current && !firstFailure.compare_exchange_weak(current, item.block)) {}
+        });
+        
+        Result result;
+        size_t limit = firstFailure.load();
+        UtxoSet replayed;
+        size_t overdrawn = replayUtxos(chain, limit, replayed, undoLog);
+        if (overdrawn < limit) {
+            result.valid = false;
+            result.failedBlock = overdrawn;
+            result.failure = Failure::SPEND;
+        } else if (limit < chain.size()) {
+            result.valid = false;
+            result.failedBlock = limit;
+            result.failure = static_cast<Failure>(failures[limit].load());
+        }
+        if (utxos) {
+            *utxos = std::move(replayed);
+        }
+        
+        auto end = std::chrono::high_resolution_clock::now();
+        result.elapsedMs = std::chrono::duration<double, std::milli>(end - start).count();
+        return result;
+    }
+};
+
+// Immutable chain state published by the writer. Readers take the current snapshot with one
+// atomic shared_ptr load and never wait on chainMutex or the miner. (libstdc++ guards atomic
+// shared_ptr loads with a hashed spinlock held just for the reference count increment, so
+// this is lock-free for readers only with respect to writers' work, not in the strict sense.)
+// A retired snapshot is freed when its last reader lets go, which plays the part of an RCU
+// grace period. Blocks sit in fixed-size chunks and per-address state (balance, unspent coins,
+// history) in hashed shards, so publishing a block copies only the last chunk, the shards
+// holding the addresses it touched and those addresses' states.
+class ChainSnapshot {
+public:
+    static constexpr size_t CHUNK_SIZE = 64;
+    static constexpr size_t ADDRESS_SHARDS = 256;
+    
+    struct AddressState {
+        Amount balance = 0;
+        std::vector<UtxoSet::Coin> unspent;      // Outpoint order
+        std::vector<UtxoSet::TxLocation> history;
+    };
+    
+    using BlockChunk = std::vector<std::shared_ptr<const Block>>;
+    using AddressShard = std::unordered_map<Address, std::shared_ptr<const AddressState>, AddressHash>;
+    
+private:
+    std::vector<std::shared_ptr<const BlockChunk>> chunks;
+    size_t length = 0;
+    std::array<std::shared_ptr<const AddressShard>, ADDRESS_SHARDS> shards;
+    size_t transactionCount = 0;
+    Amount totalValue = 0;
+    
+    static size_t shardOf(const Address& address) {
+        return AddressHash()(address) % ADDRESS_SHARDS;
+    }
+    
+    const AddressState* stateOf(const Address& address) const {
+        const AddressShard& shard = *shards[shardOf(address)];
+        auto it = shard.find(address);
+        return (it != shard.end()) ? it->second.get() : nullptr;
+    }
+    
+    // Full chunks are shared between snapshots; only the partial last one is copied
+    void append(std::shared_ptr<const Block> block) {
+        if (length % CHUNK_SIZE == 0) {
+            auto chunk = std::make_shared<BlockChunk>();
+            chunk->reserve(CHUNK_SIZE);
+            chunk->push_back(std::move(block));
+            chunks.push_back(std::move(chunk));
+        } else {
+            auto chunk = std::make_shared<BlockChunk>(*chunks.back());
+            chunk->push_back(std::move(block));
+            chunks.back() = std::move(chunk);
+        }
+        length++;
+    }
+    
+    void truncate(size_t newLength) {
+        chunks.resize((newLength + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        if (newLength % CHUNK_SIZE != 0) {
+            auto chunk = std::make_shared<BlockChunk>(chunks.back()->begin(),
+                                                      chunks.back()->begin() + newLength % CHUNK_SIZE);
+            chunks.back() = std::move(chunk);
+        }
+        length = newLength;
+    }
+    
+    // Copies each touched shard once and rebuilds the addresses' states from `utxos`
+    void refresh(const std::vector<Address>& addresses, const UtxoSet& utxos) {
+        std::array<std::shared_ptr<AddressShard>, ADDRESS_SHARDS> copies;
+        std::unordered_set<Address, AddressHash> rebuilt; // Addresses repeat within a block
+        for (const auto& address : addresses) {
+            if (!rebuilt.insert(address).second) continue;
+            size_t shard = shardOf(address);
+            if (!copies[shard]) {
+                copies[shard] = std::make_shared<AddressShard>(*shards[shard]);
+            }
+            auto state = std::make_shared<AddressState>();
+            if (const UtxoSet::AddressEntry* entry = utxos.find(address)) {
+                state->balance = entry->balance;
+                state->unspent = utxos.coinsOf(*entry);
+                state->history = entry->history;
+            }
+            (*copies[shard])[address] = std::move(state);
+        }
+        for (size_t shard = 0; shard < ADDRESS_SHARDS; shard++) {
+            if (copies[shard]) shards[shard] = std::move(copies[shard]);
+        }
+        transactionCount = utxos.getTransactionCount();
+        totalValue = utxos.getTotalValue();
+    }
+    
+    static std::vector<Address> addressesOf(const Block& block) {
+        std::vector<Address> addresses;
+        for (const auto& tx : block.transactions) {
+            if (!tx.isCoinbase()) addresses.push_back(tx.sender);
+            addresses.push_back(tx.receiver);
+        }
+        addresses.push_back(block.minerAddress);
+        return addresses;
+    }
+    
+public:
+    ChainSnapshot() {
+        for (auto& shard : shards) {
+            shard = std::make_shared<const AddressShard>();
+        }
+    }
+    
+    // Writer side: the successor with `block` appended, after `utxos` has applied it
+    std::shared_ptr<const ChainSnapshot> extend(std::shared_ptr<const Block> block, const UtxoSet& utxos) const {
+        auto next = std::make_shared<ChainSnapshot>(*this);
+        std::vector<Address> addresses = addressesOf(*block);
+        next->append(std::move(block));
+        next->refresh(addresses, utxos);
+        return next;
+    }
+    
+    // Writer side: the successor after a reorganization kept the first `keep` blocks and
+    // connected `added` on top; `removed` are the disconnected blocks
+    std::shared_ptr<const ChainSnapshot> reorganize(size_t keep,
+                                                    const std::vector<std::shared_ptr<const Block>>& removed,
+                                                    const std::vector<std::shared_ptr<const Block>>& added,
+                                                    const UtxoSet& utxos) const {
+        auto next = std::make_shared<ChainSnapshot>(*this);
+        if (keep < next->length) next->truncate(keep);
+        std::vector<Address> addresses;
+        for (const auto& block : removed) {
+            std::vector<Address> touched = addressesOf(*block);
+            addresses.insert(addresses.end(), touched.begin(), touched.end());
+        }
+        for (const auto& block : added) {
+            std::vector<Address> touched = addressesOf(*block);
+            addresses.insert(addresses.end(), touched.begin(), touched.end());
+            next->append(block);
+        }
+        next->refresh(addresses, utxos);
+        return next;
+    }
+    
+    // Writer side: addresses credited outside of a block
+    std::shared_ptr<const ChainSnapshot> withAddresses(const std::vector<Address>& addresses,
+                                                      const UtxoSet& utxos) const {
+        auto next = std::make_shared<ChainSnapshot>(*this);
+        next->refresh(addresses, utxos);
+        return next;
+    }
+    
+    // Writer side: a snapshot built from scratch, e.g. for a chain loaded from disk
+    static std::shared_ptr<const ChainSnapshot> build(std::vector<Block> blocks, const UtxoSet& utxos) {
+        auto snapshot = std::make_shared<ChainSnapshot>();
+        for (auto& block : blocks) {
+            snapshot->append(std::make_shared<const Block>(std::move(block)));
+        }
+        std::vector<Address> addresses;
+        for (const auto& entry : utxos.getAddresses()) {
+            addresses.push_back(entry.first);
+        }
+        snapshot->refresh(addresses, utxos);
+        return snapshot;
+    }
+    
+    size_t size() const { return length; }
+    
+    const Block& operator[](size_t height) const {
+        return *(*chunks[height / CHUNK_SIZE])[height % CHUNK_SIZE];
+    }
+    
+    const Block& tip() const { return (*this)[length - 1]; }
+    
+    std::shared_ptr<const Block> blockAt(size_t height) const {
+        return (*chunks[height / CHUNK_SIZE])[height % CHUNK_SIZE];
+    }
+    
+    Amount balanceOf(const Address& address) const {
+        const AddressState* state = stateOf(address);
+        return state ? state->balance : 0;
+    }
+    
+    std::vector<UTXO> unspentOf(const Address& address) const {
+        std::vector<UTXO> coins;
+        if (const AddressState* state = stateOf(address)) {
+            coins.reserve(state->unspent.size());
+            for (const auto& coin : state->unspent) {
+                coins.emplace_back(coin.point.txId, static_cast<int>(coin.point.index), address, coin.amount);
+            }
+        }
+        return coins;
+    }
+    
+    // Transactions sent or received by `address`, in chain order
+    std::vector<Transaction> historyOf(const Address& address) const {
+        std::vector<Transaction> history;
+        if (const AddressState* state = stateOf(address)) {
+            history.reserve(state->history.size());
+            for (const auto& location : state->history) {
+                history.push_back((*this)[location.height].transactions[location.position]);
+            }
+        }
+        return history;
+    }
+    
+    template <typename Visitor>
+    void forEachBalance(Visitor visit) const {
+        for (const auto& shard : shards) {
+            for (const auto& entry : *shard) {
+                visit(entry.first, entry.second->balance);
+            }
+        }
+    }
+    
+    size_t getTransactionCount() const { return transactionCount; }
+    Amount getTotalValue() const { return totalValue; }
 };
 
 // Blockchain class
 class Blockchain {
+public:
+    // Outcome of offering a block to the node
+    enum class BlockStatus { CONNECTED, REORGANIZED, SIDE_BRANCH, ORPHAN, DUPLICATE, INVALID };
+    
 private:
-    std::vector<Block> chain;
-    std::unordered_map<std::string, UTXO> utxoSet;
-    std::unordered_map<std::string, double> balances;
+    // Readers load `published` and never take chainMutex (see ChainSnapshot); writers (genesis,
+    // mining, loading, incoming blocks, rewards) serialize on chainMutex, update the UTXO set
+    // and publish a successor snapshot
+    std::shared_ptr<const ChainSnapshot> published;
+    UtxoSet utxos;
+    uint64_t offChainRewards = 0;
     MemoryPool mempool;
-    int difficulty;
-    double blockReward;
-    std::mutex chainMutex;
+    std::atomic<int> difficulty; // Of the next block on the current tip
+    ConsensusRules rules;
+    mutable std::mutex chainMutex;
+    
+    // Every block this node accepted, on the active chain or on a side branch. The active
+    // chain is the valid one with the most work; ties keep the branch seen first.
+    struct BlockEntry {
+        std::shared_ptr<const Block> block;
+        size_t height;
+        double chainWork; // Expected hashes behind the chain ending at this block
+        bool invalid = false; // Could not be connected, and neither can its descendants
+    };
+    std::unordered_map<Hash256, BlockEntry, DigestHash> blockIndex;
+    std::vector<UtxoSet::BlockUndo> undoLog; // One entry per block of the active chain
+    
+    // Blocks that arrived before their parent, keyed by the missing parent
+    static constexpr size_t MAX_ORPHANS = 512;
+    std::unordered_multimap<Hash256, std::shared_ptr<const Block>, DigestHash> orphans;
+    std::atomic<size_t> reorganizations{0};
+    std::atomic<size_t> deepestReorganization{0};
     
     // Mining and consensus
     std::atomic<bool> miningActive;
+    unsigned miningThreads = 0; // 0: one per hardware thread
+    unsigned validationThreads = 0;
     std::thread miningThread;
-    std::string minerAddress;
+    Address minerAddress;
     
     // Network simulation
     std::vector<std::string> networkNodes;
     std::mutex networkMutex;
+    std::function<void(const Block&)> blockHandler;
+    std::function<void(const Transaction&)> transactionHandler;
+    
+#ifdef BLOCKCHAIN_BLOCK_STORE
+    std::unique_ptr<BlockStore> store; // Blocks are appended as they join the chain
+#endif
     
 public:
     Blockchain(int initialDifficulty = 4, double reward = 50.0)
-        : difficulty(initialDifficulty), blockReward(reward), miningActive(false) {
+        : difficulty(initialDifficulty), miningActive(false) {
+        rules.blockReward = toAmount(reward);
         createGenesisBlock();
     }
     
+    // Joins an existing network: starts from its genesis block instead of mining a new one
+    explicit Blockchain(const Block& genesis, const ConsensusRules& consensus = ConsensusRules())
+        : difficulty(genesis.difficulty), rules(consensus), miningActive(false) {
+        if (genesis.index != 0 || ChainValidator::checkBlock(genesis, rules) != ChainValidator::Failure::NONE) {
+            throw std::invalid_argument("Not a valid genesis block");
+        }
+        adoptGenesis(genesis);
+    }
+    
+#ifdef BLOCKCHAIN_BLOCK_STORE
+    // Restarting node: reloads and revalidates the stored chain; a new store gets a fresh genesis
+    Blockchain(const std::string& storeDirectory, int initialDifficulty = 4, double reward = 50.0,
+               BlockStore::Options storeOptions = BlockStore::Options())
+        : difficulty(initialDifficulty), miningActive(false) {
+        rules.blockReward = toAmount(reward);
+        store = std::make_unique<BlockStore>(storeDirectory, storeOptions);
+        if (store->size() == 0) {
+            createGenesisBlock();
+            store->append((*snapshot())[0]);
+        } else {
+            loadFromStore();
+        }
+    }
+    
+    // Attaches a store to a running node and writes out the blocks it does not hold yet
+    void persistTo(const std::string& directory, BlockStore::Options options = BlockStore::Options()) {
+        auto opened = std::make_unique<BlockStore>(directory, options);
+        std::lock_guard<std::mutex> lock(chainMutex);
+        auto view = snapshot();
+        size_t stored = opened->size();
+        if (stored > view->size() || (stored > 0 && opened->heightOf((*view)[stored - 1].hash) != stored - 1)) {
+            throw std::runtime_error("Block store at " + directory + " holds a different chain");
+        }
+        for (size_t height = stored; height < view->size(); height++) {
+            opened->append((*view)[height]);
+        }
+        store = std::move(opened);
+    }
+    
+    const BlockStore* getStore() const { return store.get(); }
+#endif
+    
     ~Blockchain() {
         stopMining();
     }
     
+    // Consistent, immutable view of the chain for any number of queries
+    std::shared_ptr<const ChainSnapshot> snapshot() const {
+        return std::atomic_load_explicit(&published, std::memory_order_acquire);
+    }
+    
     void createGenesisBlock() {
-        Block genesis(0, "0", difficulty);
+        Block genesis(0, Hash256{}, difficulty);
         genesis.timestamp = std::chrono::system_clock::now();
         
         // Genesis transaction (coin creation)
@@ -425,36 +2491,56 @@ public:
         genesisTx.generateTxId();
         genesis.addTransaction(genesisTx);
         
-        genesis.mine("genesis");
-        
-        std::lock_guard<std::mutex> lock(chainMutex);
-        chain.push_back(genesis);
-        
-        // Initialize genesis UTXO
-        UTXO genesisUtxo(genesisTx.txId, 0, "genesis", 1000000);
-        utxoSet[genesisUtxo.getKey()] = genesisUtxo;
-        balances["genesis"] = 1000000;
+        genesis.mine("genesis", miningThreads);
+        adoptGenesis(std::move(genesis));
         
         std::cout << "Genesis block created!" << std::endl;
     }
     
-    bool isChainValid() const {
+#ifdef BLOCKCHAIN_BLOCK_STORE
+    void loadFromStore() {
+        std::vector<Block> loaded;
+        loaded.reserve(store->size());
+        for (size_t height = 0; height < store->size(); height++) {
+            loaded.push_back(store->load(height));
+        }
+        
+        UtxoSet replayed;
+        std::vector<UtxoSet::BlockUndo> replayedUndo;
+        auto result = ChainValidator(validationThreads, rules).validate(loaded, &replayed, &replayedUndo);
+        if (!result.valid) {
+            throw std::runtime_error("Stored chain is invalid at block " + std::to_string(result.failedBlock) +
+                                     ": " + ChainValidator::describe(result.failure));
+        }
+        
         std::lock_guard<std::mutex> lock(chainMutex);
+        utxos = std::move(replayed);
+        undoLog = std::move(replayedUndo);
+        publish(ChainSnapshot::build(std::move(loaded), utxos));
         
-        for (size_t i = 1; i < chain.size(); i++) {
-            const Block& currentBlock = chain[i];
-            const Block& previousBlock = chain[i - 1];
-            
-            if (!currentBlock.isValid()) {
-                return false;
-            }
-            
-            if (currentBlock.previousHash != previousBlock.hash) {
-                return false;
-            }
+        auto view = snapshot();
+        difficulty = nextDifficulty(*view);
+        blockIndex.clear();
+        orphans.clear();
+        double work = 0.0;
+        for (size_t height = 0; height < view->size(); height++) {
+            auto block = view->blockAt(height);
+            work += blockWork(*block);
+            blockIndex[block->hash] = BlockEntry{block, height, work};
         }
         
-        return true;
+        std::cout << "Loaded " << snapshot()->size() << " blocks from disk (validated in "
+                  << std::fixed << std::setprecision(2) << result.elapsedMs << " ms)" << std::endl;
+    }
+#endif
+    
+    // Revalidates the published snapshot; mining carries on while blocks are re-hashed
+    ChainValidator::Result validateChain() const {
+        return ChainValidator(validationThreads, rules).validate(*snapshot());
+    }
+    
+    bool isChainValid() const {
+        return validateChain().valid;
     }
     
     void addTransaction(const Transaction& tx) {
@@ -467,29 +2553,96 @@ public:
         mempool.addTransaction(tx);
     }
     
-    bool validateTransaction(const Transaction& tx) const {
-        // Basic validation
-        if (tx.amount <= 0 || tx.fee < 0) return false;
-        if (tx.sender == tx.receiver) return false;
-        if (!tx.verify()) return false;
-        
-        // Check balance (simplified - in reality would check UTXOs)
-        auto it = balances.find(tx.sender);
-        if (it == balances.end()) return false;
-        
-        return it->second >= tx.getTotalAmount();
+    // Signatures of the whole batch are checked in parallel; balance checks stay sequential.
+    // Returns the number of transactions accepted into the mempool.
+    size_t addTransactions(const std::vector<Transaction>& txs) {
+        std::vector<char> verified = ChainValidator(validationThreads, rules).verifyTransactions(txs);
+        size_t accepted = 0;
+        for (size_t i = 0; i < txs.size(); i++) {
+            if (verified[i] && validateTransaction(txs[i], false) && mempool.addTransaction(txs[i])) {
+                accepted++;
+            }
+        }
+        return accepted;
+    }
+    
+    bool validateTransaction(const Transaction& tx, bool checkSignature = true) const {
+        // Basic validation
+        if (tx.amount <= 0 || tx.fee < 0) return false;
+        if (tx.sender == tx.receiver) return false;
+        if (tx.isCoinbase()) return false; // Only the miner adds one, as the block's first transaction
+        if (checkSignature && !tx.verify()) return false;
+        
+        return snapshot()->balanceOf(tx.sender) >= tx.getTotalAmount();
+    }
+    
+    // Offers a block mined here or received from a peer. Blocks on the active tip extend the
+    // chain; a side branch that gains more work than the active chain replaces it (reorg);
+    // blocks without a known parent wait in the orphan pool. Every block that joins the index,
+    // including orphans it releases, is passed on to broadcastBlock.
+    BlockStatus submitBlock(const Block& block) {
+        std::vector<std::shared_ptr<const Block>> accepted;
+        BlockStatus status;
+        {
+            std::lock_guard<std::mutex> lock(chainMutex);
+            auto incoming = std::make_shared<const Block>(block);
+            status = acceptBlock(incoming);
+            if (joinedIndex(status)) {
+                accepted.push_back(incoming);
+            }
+            
+            // Orphans waiting on an accepted block can be accepted in turn
+            for (size_t next = 0; next < accepted.size(); next++) {
+                auto waiting = orphans.equal_range(accepted[next]->hash);
+                std::vector<std::shared_ptr<const Block>> children;
+                for (auto it = waiting.first; it != waiting.second; ++it) {
+                    children.push_back(it->second);
+                }
+                orphans.erase(waiting.first, waiting.second);
+                for (const auto& child : children) {
+                    if (joinedIndex(acceptBlock(child))) accepted.push_back(child);
+                }
+            }
+        }
+        
+        for (const auto& joined : accepted) {
+            broadcastBlock(*joined);
+        }
+        return status;
+    }
+    
+    // Any block in the index, side branches included
+    std::shared_ptr<const Block> findBlock(const Hash256& hash) const {
+        std::lock_guard<std::mutex> lock(chainMutex);
+        auto it = blockIndex.find(hash);
+        return (it != blockIndex.end()) ? it->second.block : nullptr;
+    }
+    
+    std::optional<Transaction> getPendingTransaction(const Hash256& txId) const {
+        return mempool.getTransaction(txId);
     }
     
-    void startMining(const std::string& miner) {
+    // Assembles a block on the current tip from the best-paying mempool transactions and
+    // mines it quietly; the caller submits it
+    Block mineBlock(const Address& miner, size_t maxTransactions = 100, unsigned threads = 1) {
+        Block block = assembleBlock(miner, mempool.getTransactions(maxTransactions));
+        block.mine(miner, threads, false);
+        return block;
+    }
+    
+    void startMining(const Address& miner) {
         if (miningActive) return;
         
         minerAddress = miner;
         miningActive = true;
         miningThread = std::thread(&Blockchain::miningLoop, this);
         
-        std::cout << "Mining started by: " << miner.substr(0, 16) << "..." << std::endl;
+        std::cout << "Mining started by: " << miner.toString().substr(0, 16) << "..." << std::endl;
     }
     
+    void setMiningThreads(unsigned threads) { miningThreads = threads; }
+    void setValidationThreads(unsigned threads) { validationThreads = threads; }
+    
     void stopMining() {
         miningActive = false;
         if (miningThread.joinable()) {
@@ -497,66 +2650,67 @@ public:
         }
     }
     
-    double getBalance(const std::string& address) const {
-        auto it = balances.find(address);
-        return (it != balances.end()) ? it->second : 0.0;
+    // In coins
+    double getBalance(const Address& address) const {
+        return toCoins(snapshot()->balanceOf(address));
+    }
+    
+    std::vector<UTXO> getUnspentOutputs(const Address& address) const {
+        return snapshot()->unspentOf(address);
     }
     
     size_t getChainLength() const {
-        std::lock_guard<std::mutex> lock(chainMutex);
-        return chain.size();
+        return snapshot()->size();
     }
     
     Block getBlock(size_t index) const {
-        std::lock_guard<std::mutex> lock(chainMutex);
-        if (index < chain.size()) {
-            return chain[index];
+        auto view = snapshot();
+        if (index < view->size()) {
+            return (*view)[index];
+        }
+        throw std::out_of_range("Block index out of range");
+    }
+    
+    // Proof that transaction `position` of block `index` is committed to by its merkle root
+    MerkleProof getMerkleProof(size_t index, size_t position) const {
+        auto view = snapshot();
+        if (index < view->size()) {
+            return (*view)[index].proveTransaction(position);
         }
         throw std::out_of_range("Block index out of range");
     }
     
     Block getLatestBlock() const {
-        std::lock_guard<std::mutex> lock(chainMutex);
-        return chain.back();
+        return snapshot()->tip();
     }
     
-    std::vector<Transaction> getTransactionHistory(const std::string& address) const {
-        std::lock_guard<std::mutex> lock(chainMutex);
-        std::vector<Transaction> history;
-        
-        for (const auto& block : chain) {
-            for (const auto& tx : block.transactions) {
-                if (tx.sender == address || tx.receiver == address) {
-                    history.push_back(tx);
-                }
-            }
-        }
-        
-        return history;
+    // The snapshot's address index lists where the address appears, so no chain scan is needed
+    std::vector<Transaction> getTransactionHistory(const Address& address) const {
+        return snapshot()->historyOf(address);
     }
     
     void printBlockchain() const {
-        std::lock_guard<std::mutex> lock(chainMutex);
+        auto view = snapshot();
         
         std::cout << "\n=== BLOCKCHAIN STATUS ===" << std::endl;
-        std::cout << "Chain length: " << chain.size() << std::endl;
-        std::cout << "Current difficulty: " << difficulty << std::endl;
+        std::cout << "Chain length: " << view->size() << std::endl;
+        std::cout << "Current difficulty: " << nextDifficulty(*view) << std::endl;
         std::cout << "Mempool size: " << mempool.size() << std::endl;
         std::cout << "Mining active: " << (miningActive ? "Yes" : "No") << std::endl;
         
         std::cout << "\n--- RECENT BLOCKS ---" << std::endl;
-        size_t startIdx = (chain.size() > 3) ? chain.size() - 3 : 0;
-        for (size_t i = startIdx; i < chain.size(); i++) {
-            std::cout << chain[i].toString() << std::endl;
+        size_t startIdx = (view->size() > 3) ? view->size() - 3 : 0;
+        for (size_t i = startIdx; i < view->size(); i++) {
+            std::cout << (*view)[i].toString() << std::endl;
         }
         
         std::cout << "--- BALANCES ---" << std::endl;
-        for (const auto& balance : balances) {
-            if (balance.second > 0) {
-                std::cout << balance.first.substr(0, 16) << "...: " 
-                          << balance.second << " coins" << std::endl;
+        view->forEachBalance([](const Address& address, Amount balance) {
+            if (balance > 0) {
+                std::cout << address.toString().substr(0, 16) << "...: " 
+                          << toCoins(balance) << " coins" << std::endl;
             }
-        }
+        });
         std::cout << std::endl;
     }
     
@@ -566,41 +2720,47 @@ public:
         networkNodes.push_back(nodeId);
     }
     
+    // Handlers hand new blocks and transactions to the network; without them broadcasts are only logged
+    void setBroadcastHandlers(std::function<void(const Block&)> onBlock,
+                              std::function<void(const Transaction&)> onTransaction) {
+        blockHandler = std::move(onBlock);
+        transactionHandler = std::move(onTransaction);
+    }
+    
     void broadcastTransaction(const Transaction& tx) {
         // Simulate network broadcast
         std::cout << "Broadcasting transaction: " << tx.toString() << std::endl;
         addTransaction(tx);
+        if (transactionHandler) transactionHandler(tx);
     }
     
     void broadcastBlock(const Block& block) {
+        if (blockHandler) {
+            blockHandler(block);
+            return;
+        }
         // Simulate network broadcast
         std::cout << "Broadcasting new block: " << block.index << std::endl;
     }
     
-    // Advanced features
+    // Advanced features. The retarget itself is a consensus rule (see
+    // ChainValidator::expectedDifficulty); this follows it for the next block on the tip.
     void adjustDifficulty() {
-        std::lock_guard<std::mutex> lock(chainMutex);
-        
-        if (chain.size() < 10) return;
-        
-        // Calculate average block time for last 10 blocks
-        auto totalTime = std::chrono::duration_cast<std::chrono::seconds>(
-            chain.back().timestamp - chain[chain.size() - 10].timestamp);
-        
-        double avgBlockTime = totalTime.count() / 10.0;
-        double targetTime = 60.0; // 1 minute per block
-        
-        if (avgBlockTime < targetTime * 0.8) {
-            difficulty++;
-            std::cout << "Difficulty increased to: " << difficulty << std::endl;
-        } else if (avgBlockTime > targetTime * 1.2 && difficulty > 1) {
-            difficulty--;
-            std::cout << "Difficulty decreased to: " << difficulty << std::endl;
+        int next = nextDifficulty(*snapshot());
+        int previous = difficulty.exchange(next);
+        if (next > previous) {
+            std::cout << "Difficulty increased to: " << next << std::endl;
+        } else if (next < previous) {
+            std::cout << "Difficulty decreased to: " << next << std::endl;
         }
     }
     
-    void rewardMiner(const std::string& miner, double amount) {
-        balances[miner] += amount;
+    // Off-chain reward: credited as an output under a synthetic id
+    void rewardMiner(const Address& miner, double amount) {
+        std::lock_guard<std::mutex> lock(chainMutex);
+        Hash256 id = CryptoHash::hash("reward:" + miner.toString() + ":" + std::to_string(offChainRewards++));
+        utxos.credit({id, 0}, miner, toAmount(amount));
+        publish(snapshot()->withAddresses({miner}, utxos));
     }
     
     // Statistics
@@ -611,98 +2771,252 @@ public:
         double averageBlockTime;
         int currentDifficulty;
         size_t mempoolSize;
+        size_t reorganizations;
+        size_t deepestReorganization;
         std::map<std::string, double> topBalances;
     };
     
     BlockchainStats getStats() const {
-        std::lock_guard<std::mutex> lock(chainMutex);
+        auto view = snapshot();
         
         BlockchainStats stats;
-        stats.totalBlocks = chain.size();
-        stats.currentDifficulty = difficulty;
+        stats.totalBlocks = view->size();
+        stats.currentDifficulty = nextDifficulty(*view);
         stats.mempoolSize = mempool.size();
+        stats.reorganizations = reorganizations;
+        stats.deepestReorganization = deepestReorganization;
         
-        stats.totalTransactions = 0;
-        for (const auto& block : chain) {
-            stats.totalTransactions += block.transactions.size();
-        }
+        stats.totalTransactions = view->getTransactionCount();
         
-        stats.totalCoinsInCirculation = 0;
-        for (const auto& balance : balances) {
-            stats.totalCoinsInCirculation += balance.second;
-        }
+        stats.totalCoinsInCirculation = toCoins(view->getTotalValue());
         
         // Calculate average block time
-        if (chain.size() > 1) {
+        if (view->size() > 1) {
             auto totalTime = std::chrono::duration_cast<std::chrono::seconds>(
-                chain.back().timestamp - chain.front().timestamp);
-            stats.averageBlockTime = totalTime.count() / (chain.size() - 1.0);
+                view->tip().timestamp - (*view)[0].timestamp);
+            stats.averageBlockTime = totalTime.count() / (view->size() - 1.0);
         } else {
             stats.averageBlockTime = 0;
         }
         
         // Top 5 balances
-        std::vector<std::pair<std::string, double>> sortedBalances(balances.begin(), balances.end());
-        std::sort(sortedBalances.begin(), sortedBalances.end(),
-                  [](const auto& a, const auto& b) { return a.second > b.second; });
+        std::vector<std::pair<Address, Amount>> sortedBalances;
+        view->forEachBalance([&](const Address& address, Amount balance) {
+            sortedBalances.emplace_back(address, balance);
+        });
+        size_t top = std::min(size_t(5), sortedBalances.size());
+        std::partial_sort(sortedBalances.begin(), sortedBalances.begin() + top, sortedBalances.end(),
+                          [](const auto& a, const auto& b) { return a.second > b.second; });
         
-        for (size_t i = 0; i < std::min(size_t(5), sortedBalances.size()); i++) {
-            stats.topBalances[sortedBalances[i].first] = sortedBalances[i].second;
+        for (size_t i = 0; i < top; i++) {
+            stats.topBalances[sortedBalances[i].first.toString()] = toCoins(sortedBalances[i].second);
         }
         
         return stats;
     }
     
 private:
+    void publish(std::shared_ptr<const ChainSnapshot> next) {
+        std::atomic_store_explicit(&published, std::move(next), std::memory_order_release);
+    }
+    
+    int nextDifficulty(const ChainSnapshot& view) const {
+        return ChainValidator::expectedDifficulty(rules, view.size(), [&](size_t height) -> const Block& {
+            return view[height];
+        });
+    }
+    
+    static double blockWork(const Block& block) {
+        return std::ldexp(1.0, block.targetBits());
+    }
+    
+    static bool joinedIndex(BlockStatus status) {
+        return status == BlockStatus::CONNECTED || status == BlockStatus::REORGANIZED ||
+               status == BlockStatus::SIDE_BRANCH;
+    }
+    
+    void adoptGenesis(Block genesis) {
+        std::lock_guard<std::mutex> lock(chainMutex);
+        utxos = UtxoSet();
+        undoLog.assign(1, UtxoSet::BlockUndo());
+        utxos.applyBlock(genesis, 0, &undoLog[0]);
+        
+        auto block = std::make_shared<const Block>(std::move(genesis));
+        blockIndex.clear();
+        orphans.clear();
+        blockIndex[block->hash] = BlockEntry{block, 0, blockWork(*block)};
+        publish(ChainSnapshot().extend(block, utxos));
+    }
+    
+    // Caller holds chainMutex
+    BlockStatus acceptBlock(const std::shared_ptr<const Block>& block) {
+        if (blockIndex.count(block->hash)) return BlockStatus::DUPLICATE;
+        auto waiting = orphans.equal_range(block->previousHash);
+        for (auto it = waiting.first; it != waiting.second; ++it) {
+            if (it->second->hash == block->hash) return BlockStatus::DUPLICATE;
+        }
+        if (ChainValidator::checkBlock(*block, rules) != ChainValidator::Failure::NONE) return BlockStatus::INVALID;
+        
+        auto parent = blockIndex.find(block->previousHash);
+        if (parent == blockIndex.end()) {
+            if (orphans.size() >= MAX_ORPHANS) {
+                orphans.erase(orphans.begin());
+            }
+            orphans.emplace(block->previousHash, block);
+            return BlockStatus::ORPHAN;
+        }
+        if (parent->second.invalid || block->index < 0 ||
+            static_cast<size_t>(block->index) != parent->second.height + 1) {
+            return BlockStatus::INVALID;
+        }
+        
+        // The declared difficulty also sets the block's work, so it must be the one the
+        // parent's branch calls for
+        const BlockEntry& parentEntry = parent->second;
+        int expected = ChainValidator::expectedDifficulty(rules, parentEntry.height + 1, [&](size_t height) -> const Block& {
+            const BlockEntry* cursor = &parentEntry;
+            while (cursor->height > height) {
+                cursor = &blockIndex.at(cursor->block->previousHash);
+            }
+            return *cursor->block;
+        });
+        if (block->difficulty != expected) return BlockStatus::INVALID;
+        
+        BlockEntry entry{block, parent->second.height + 1, parent->second.chainWork + blockWork(*block)};
+        BlockEntry& stored = blockIndex.emplace(block->hash, std::move(entry)).first->second;
+        if (stored.chainWork <= blockIndex.at(snapshot()->tip().hash).chainWork) {
+            return BlockStatus::SIDE_BRANCH;
+        }
+        return activateBranch(stored);
+    }
+    
+    // Makes `target` the tip: disconnects the active chain back to the fork point, then
+    // connects the branch leading to `target`. If the branch spends unavailable coins it is
+    // marked invalid and the previous chain is restored. Caller holds chainMutex.
+    BlockStatus activateBranch(BlockEntry& target) {
+        auto view = snapshot();
+        
+        std::vector<std::shared_ptr<const Block>> branch;
+        const BlockEntry* cursor = &target;
+        while (cursor->height >= view->size() || (*view)[cursor->height].hash != cursor->block->hash) {
+            branch.push_back(cursor->block);
+            cursor = &blockIndex.at(cursor->block->previousHash);
+        }
+        std::reverse(branch.begin(), branch.end());
+        size_t keep = cursor->height + 1;
+        
+        std::vector<std::shared_ptr<const Block>> removed;
+        for (size_t height = view->size(); height-- > keep;) {
+            removed.push_back(view->blockAt(height));
+            utxos.disconnectBlock(*removed.back(), undoLog.back());
+            undoLog.pop_back();
+        }
+        
+        size_t connected = 0;
+        for (; connected < branch.size(); connected++) {
+            UtxoSet::BlockUndo undo;
+            if (!utxos.applyBlock(*branch[connected], static_cast<uint32_t>(keep + connected), &undo)) break;
+            undoLog.push_back(std::move(undo));
+        }
+        
+        if (connected < branch.size()) {
+            for (size_t i = connected; i < branch.size(); i++) {
+                blockIndex.at(branch[i]->hash).invalid = true;
+            }
+            while (connected-- > 0) {
+                utxos.disconnectBlock(*branch[connected], undoLog.back());
+                undoLog.pop_back();
+            }
+            for (auto it = removed.rbegin(); it != removed.rend(); ++it) {
+                UtxoSet::BlockUndo undo;
+                utxos.applyBlock(**it, static_cast<uint32_t>((*it)->index), &undo);
+                undoLog.push_back(std::move(undo));
+            }
+            return BlockStatus::INVALID;
+        }
+        
+        publish(view->reorganize(keep, removed, branch, utxos));
+        
+#ifdef BLOCKCHAIN_BLOCK_STORE
+        try {
+            if (store) {
+                if (!removed.empty()) store->truncate(keep);
+                for (const auto& block : branch) {
+                    store->append(*block);
+                }
+            }
+        } catch (const std::exception& e) {
+            // The store can no longer follow the chain; carry on in memory
+            std::cerr << e.what() << std::endl;
+            store.reset();
+        }
+#endif
+        
+        // Transactions of disconnected blocks return to the mempool unless the new branch has them
+        for (const auto& block : removed) {
+            for (const auto& tx : block->transactions) {
+                if (!tx.isCoinbase()) mempool.addTransaction(tx);
+            }
+        }
+        std::vector<Transaction> confirmed;
+        for (const auto& block : branch) {
+            confirmed.insert(confirmed.end(), block->transactions.begin(), block->transactions.end());
+        }
+        mempool.removeTransactions(confirmed);
+        
+        if (removed.empty()) return BlockStatus::CONNECTED;
+        reorganizations++;
+        if (removed.size() > deepestReorganization) deepestReorganization = removed.size();
+        return BlockStatus::REORGANIZED;
+    }
+    
+    // Coinbase first, then `candidates` in order, skipping any that would overdraw their
+    // sender within this block (validation replays balances the same way)
+    Block assembleBlock(const Address& miner, const std::vector<Transaction>& candidates) const {
+        auto view = snapshot();
+        Block block(static_cast<int>(view->size()), view->tip().hash, nextDifficulty(*view));
+        block.blockReward = rules.blockReward;
+        
+        // Add coinbase transaction (mining reward)
+        Transaction coinbase("coinbase", miner, 0, 0);
+        coinbase.amount = rules.blockReward;
+        coinbase.generateTxId();
+        block.addTransaction(coinbase);
+        
+        std::unordered_map<Address, Amount, AddressHash> spent;
+        for (const auto& tx : candidates) {
+            Amount available = view->balanceOf(tx.sender);
+            Amount& pending = spent[tx.sender];
+            if (pending + tx.getTotalAmount() > available) continue;
+            pending += tx.getTotalAmount();
+            block.addTransaction(tx);
+        }
+        return block;
+    }
+    
     void miningLoop() {
         while (miningActive) {
             // Get transactions from mempool
             auto transactions = mempool.getTransactions(10);
             
             if (!transactions.empty()) {
-                // Create new block
-                Block newBlock(getChainLength(), getLatestBlock().hash, difficulty);
-                
-                // Add coinbase transaction (mining reward)
-                Transaction coinbase("coinbase", minerAddress, blockReward, 0);
-                coinbase.generateTxId();
-                newBlock.addTransaction(coinbase);
-                
-                // Add transactions from mempool
-                for (const auto& tx : transactions) {
-                    newBlock.addTransaction(tx);
-                }
+                // Create new block on top of the current tip
+                Block newBlock = assembleBlock(minerAddress, transactions);
                 
                 // Mine the block
-                if (newBlock.mine(minerAddress)) {
-                    // Add block to chain
-                    {
-                        std::lock_guard<std::mutex> lock(chainMutex);
-                        chain.push_back(newBlock);
-                        
-                        // Update balances
-                        for (const auto& tx : newBlock.transactions) {
-                            if (tx.sender != "coinbase") {
-                                balances[tx.sender] -= tx.getTotalAmount();
-                            }
-                            balances[tx.receiver] += tx.amount;
-                        }
-                        
-                        // Reward miner with fees
-                        balances[minerAddress] += newBlock.getTotalFees();
+                if (newBlock.mine(minerAddress, miningThreads)) {
+                    // Add block to chain; a block from a peer may have taken the tip meanwhile
+                    BlockStatus status = submitBlock(newBlock);
+                    if (status != BlockStatus::CONNECTED && status != BlockStatus::REORGANIZED) {
+                        std::cerr << "Mined block " << newBlock.index << " no longer fits the chain" << std::endl;
+                        continue;
                     }
                     
-                    // Remove mined transactions from mempool
-                    std::vector<Transaction> minedTxs(transactions.begin(), transactions.end());
-                    mempool.removeTransactions(minedTxs);
-                    
-                    // Broadcast new block
-                    broadcastBlock(newBlock);
+                    // Remove mined transactions, and those skipped as overdrawn, from mempool
+                    mempool.removeTransactions(transactions);
                     
-                    // Adjust difficulty periodically
-                    if (getChainLength() % 10 == 0) {
-                        adjustDifficulty();
-                    }
+                    // Report difficulty changes at retarget heights
+                    adjustDifficulty();
                 }
             } else {
                 // No transactions to mine, wait a bit
@@ -712,26 +3026,86 @@ private:
     }
 };
 
-// Blockchain network simulator
+// Blockchain network simulator. Nodes share the first node's genesis block and relay new
+// blocks and transactions to each other directly; see NetworkSimulator for latency and bandwidth.
 class BlockchainNetwork {
 private:
     std::vector<std::shared_ptr<Blockchain>> nodes;
     std::vector<std::shared_ptr<Wallet>> wallets;
     std::mutex networkMutex;
     
-public:
-    void addNode() {
-        auto node = std::make_shared<Blockchain>();
+    std::vector<std::shared_ptr<Blockchain>> peersOf(const Blockchain* origin) {
+        std::lock_guard<std::mutex> lock(networkMutex);
+        std::vector<std::shared_ptr<Blockchain>> peers;
+        for (const auto& node : nodes) {
+            if (node.get() != origin) peers.push_back(node);
+        }
+        return peers;
+    }
+    
+    // Peers that accept the block relay it onwards; duplicates stop the flood. A peer that
+    // missed earlier blocks is sent ancestors until one connects and releases the orphans.
+    void relayBlock(const Blockchain* origin, const Block& block) {
+        for (const auto& peer : peersOf(origin)) {
+            if (peer->submitBlock(block) != Blockchain::BlockStatus::ORPHAN) continue;
+            auto missing = origin->findBlock(block.previousHash);
+            while (missing && peer->submitBlock(*missing) == Blockchain::BlockStatus::ORPHAN) {
+                missing = origin->findBlock(missing->previousHash);
+            }
+        }
+    }
+    
+    void relayTransaction(const Blockchain* origin, const Transaction& tx) {
+        for (const auto& peer : peersOf(origin)) {
+            peer->addTransaction(tx);
+        }
+    }
+    
+    void connectNode(std::shared_ptr<Blockchain> node) {
+        std::shared_ptr<Blockchain> first = getNode(0);
+        
+        // A late joiner catches up on the chain so far
+        if (first) {
+            for (size_t height = 1; height < first->getChainLength(); height++) {
+                node->submitBlock(first->getBlock(height));
+            }
+        }
+        
+        const Blockchain* origin = node.get();
+        node->setBroadcastHandlers([this, origin](const Block& block) { relayBlock(origin, block); },
+                                   [this, origin](const Transaction& tx) { relayTransaction(origin, tx); });
+        
         std::lock_guard<std::mutex> lock(networkMutex);
         nodes.push_back(node);
         std::cout << "Added blockchain node. Total nodes: " << nodes.size() << std::endl;
     }
     
+public:
+    ~BlockchainNetwork() {
+        // Mining threads relay into other nodes, so all of them stop before any node goes away
+        for (const auto& node : nodes) {
+            node->stopMining();
+        }
+    }
+    
+    void addNode() {
+        std::shared_ptr<Blockchain> first = getNode(0);
+        connectNode(first ? std::make_shared<Blockchain>(first->getBlock(0)) : std::make_shared<Blockchain>());
+    }
+    
+    // Founds the network on a prepared genesis block, e.g. one that funds the wallets
+    void addNode(const Block& genesis) {
+        if (getNode(0)) {
+            throw std::logic_error("The network already has a genesis block");
+        }
+        connectNode(std::make_shared<Blockchain>(genesis));
+    }
+    
     void addWallet() {
         auto wallet = std::make_shared<Wallet>();
         std::lock_guard<std::mutex> lock(networkMutex);
         wallets.push_back(wallet);
-        std::cout << "Created new wallet: " << wallet->getAddress().substr(0, 16) << "..." << std::endl;
+        std::cout << "Created new wallet: " << wallet->getAddress().toString().substr(0, 16) << "..." << std::endl;
     }
     
     std::shared_ptr<Blockchain> getNode(size_t index) {
@@ -805,11 +3179,518 @@ public:
                           << std::fixed << std::setprecision(2) 
                           << balance.second << " coins" << std::endl;
             }
+            
+            std::cout << "\n--- NODES ---" << std::endl;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                auto view = nodes[i]->snapshot();
+                std::cout << "Node " << i << ": " << view->size() << " blocks, tip "
+                          << CryptoHash::toHex(view->tip().hash).substr(0, 16) << "..." << std::endl;
+            }
         }
         std::cout << std::endl;
     }
 };
 
+// Discrete-event simulation of a peer-to-peer network on one thread. Every node is a full
+// Blockchain with its own inbox; a message pays for its bytes on the sender's uplink, then
+// the link latency. Blocks and transactions are announced by hash (INV) and fetched on demand
+// (GET_*), and every node follows the branch with the most work, reorganizing when it changes.
+class NetworkSimulator {
+public:
+    enum class MessageType : uint8_t { INV_TX, INV_BLOCK, GET_TX, GET_BLOCK, TX, BLOCK };
+    static constexpr size_t MESSAGE_TYPES = 6;
+    
+    struct Config {
+        size_t nodes = 200;
+        size_t peersPerNode = 8;          // Outbound links, the ring link included
+        double latencyMs = 40.0;          // Minimum one-way latency of a link
+        double jitterMs = 120.0;          // Each link adds a fixed extra latency up to this
+        double uploadBytesPerMs = 1250.0; // 10 Mbit/s uplink per node
+        double blockIntervalMs = 10000.0; // Mean time between blocks across the network
+        double txIntervalMs = 100.0;      // Mean time between new transactions
+        double durationMs = 600000.0;     // Blocks and transactions are created until then
+        size_t wallets = 50;              // Funded by the genesis block
+        double walletFunds = 1000.0;
+        size_t maxBlockTransactions = 200;
+        int difficulty = 1;
+        uint64_t seed = 1;                // Fixes topology, latencies and event times
+    };
+    
+    struct Report {
+        size_t nodes = 0;
+        double averagePeers = 0.0;
+        double simulatedMs = 0.0;
+        double wallMs = 0.0;
+        size_t blocksMined = 0;
+        size_t staleBlocks = 0;           // Mined, but not on the final chain
+        size_t orphanArrivals = 0;        // Blocks that arrived before their parent
+        size_t reorganizations = 0;
+        size_t deepestReorganization = 0;
+        size_t transactionsCreated = 0;
+        size_t chainLength = 0;
+        double blockPropagationP50 = 0.0; // Time until a block is held by 90% of nodes
+        double blockPropagationP90 = 0.0;
+        double txPropagationP50 = 0.0;
+        double txPropagationP90 = 0.0;
+        std::array<uint64_t, MESSAGE_TYPES> messages{};
+        std::array<uint64_t, MESSAGE_TYPES> bytes{};
+        size_t nodesOnBestTip = 0;
+        size_t tieBreakBlocks = 0;        // Mined after the run until all nodes agreed
+    };
+    
+    static const char* describe(MessageType type) {
+        switch (type) {
+            case MessageType::INV_TX: return "INV_TX";
+            case MessageType::INV_BLOCK: return "INV_BLOCK";
+            case MessageType::GET_TX: return "GET_TX";
+            case MessageType::GET_BLOCK: return "GET_BLOCK";
+            case MessageType::TX: return "TX";
+            case MessageType::BLOCK: return "BLOCK";
+        }
+        return "UNKNOWN";
+    }
+    
+private:
+    static constexpr size_t MESSAGE_HEADER_BYTES = 24; // Envelope: magic, command, length, checksum
+    static constexpr size_t INVENTORY_BYTES = 36;      // Inventory type and hash
+    static constexpr double REQUEST_TIMEOUT_MS = 5000.0; // Then another announcer is asked
+    static constexpr size_t MAX_TIE_BREAKS = 16;
+    static constexpr double PROPAGATION_SHARE = 0.9;
+    
+    using Payload = std::shared_ptr<const std::vector<uint8_t>>;
+    
+    struct Message {
+        double arrival;
+        uint64_t sequence; // Keeps equal arrival times in send order
+        size_t from;
+        MessageType type;
+        Hash256 hash;
+        Payload payload; // Serialized body of TX and BLOCK
+        
+        bool operator>(const Message& other) const {
+            return arrival != other.arrival ? arrival > other.arrival : sequence > other.sequence;
+        }
+    };
+    
+    struct Link {
+        size_t peer;
+        double latencyMs;
+    };
+    
+    struct Node {
+        std::shared_ptr<Blockchain> chain;
+        Address minerAddress;
+        std::vector<Link> links;
+        std::priority_queue<Message, std::vector<Message>, std::greater<Message>> inbox;
+        double uplinkFreeAt = 0.0;
+        std::unordered_set<Hash256, DigestHash> known;            // Inventory held or already rejected
+        std::unordered_map<Hash256, double, DigestHash> inFlight; // Requested inventory -> request time
+    };
+    
+    enum class EventKind : uint8_t { DELIVER, MINE, TRANSACTION };
+    
+    struct Event {
+        double time;
+        uint64_t sequence;
+        EventKind kind;
+        size_t node;
+        
+        bool operator>(const Event& other) const {
+            return time != other.time ? time > other.time : sequence > other.sequence;
+        }
+    };
+    
+    // When a block or transaction was created and how long each accepting node waited for it
+    struct Spread {
+        double created;
+        std::vector<double> delays;
+    };
+    
+    Config config;
+    std::mt19937_64 rng;
+    std::exponential_distribution<double> blockGap;
+    std::exponential_distribution<double> txGap;
+    std::vector<Node> nodes;
+    std::vector<std::shared_ptr<Wallet>> wallets;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    double now = 0.0;
+    uint64_t sequence = 0;
+    size_t relayOrigin = SIZE_MAX; // Peer that sent the block being submitted
+    std::unordered_map<Hash256, Payload, DigestHash> encoded; // Wire form, shared by all senders
+    std::unordered_map<Hash256, Spread, DigestHash> blockSpread;
+    std::unordered_map<Hash256, Spread, DigestHash> txSpread;
+    std::vector<Hash256> minedBlocks;
+    Report report;
+    
+    // A ring keeps the graph connected; random extra links give it a small diameter
+    void connect() {
+        std::uniform_real_distribution<double> jitter(0.0, config.jitterMs);
+        std::uniform_int_distribution<size_t> pick(0, nodes.size() - 1);
+        auto linked = [&](size_t a, size_t b) {
+            for (const Link& link : nodes[a].links) {
+                if (link.peer == b) return true;
+            }
+            return false;
+        };
+        auto link = [&](size_t a, size_t b) {
+            double latency = config.latencyMs + jitter(rng);
+            nodes[a].links.push_back({b, latency});
+            nodes[b].links.push_back({a, latency});
+        };
+        
+        for (size_t id = 0; id < nodes.size(); id++) {
+            size_t next = (id + 1) % nodes.size();
+            if (!linked(id, next)) link(id, next);
+        }
+        for (size_t id = 0; id < nodes.size(); id++) {
+            size_t added = 1;
+            for (size_t attempt = 0; added < config.peersPerNode && attempt < 8 * config.peersPerNode; attempt++) {
+                size_t peer = pick(rng);
+                if (peer == id || linked(id, peer)) continue;
+                link(id, peer);
+                added++;
+            }
+        }
+    }
+    
+    double latencyBetween(size_t from, size_t to) const {
+        for (const Link& link : nodes[from].links) {
+            if (link.peer == to) return link.latencyMs;
+        }
+        throw std::logic_error("Nodes " + std::to_string(from) + " and " + std::to_string(to) + " are not linked");
+    }
+    
+    void schedule(double time, EventKind kind, size_t node = 0) {
+        events.push(Event{time, sequence++, kind, node});
+    }
+    
+    // The uplink sends one message at a time, so a block sent to many peers queues behind itself
+    void send(size_t from, size_t to, MessageType type, const Hash256& hash, Payload payload = nullptr) {
+        size_t size = MESSAGE_HEADER_BYTES + (payload ? payload->size() : INVENTORY_BYTES);
+        Node& sender = nodes[from];
+        sender.uplinkFreeAt = std::max(now, sender.uplinkFreeAt) + size / config.uploadBytesPerMs;
+        double arrival = sender.uplinkFreeAt + latencyBetween(from, to);
+        
+        nodes[to].inbox.push(Message{arrival, sequence++, from, type, hash, std::move(payload)});
+        schedule(arrival, EventKind::DELIVER, to);
+        report.messages[static_cast<size_t>(type)]++;
+        report.bytes[static_cast<size_t>(type)] += size;
+    }
+    
+    void announce(size_t id, MessageType type, const Hash256& hash, size_t except) {
+        for (const Link& link : nodes[id].links) {
+            if (link.peer != except) send(id, link.peer, type, hash);
+        }
+    }
+    
+    // False while an earlier request for the same inventory may still be answered
+    bool request(Node& node, const Hash256& hash) {
+        auto it = node.inFlight.find(hash);
+        if (it != node.inFlight.end() && now - it->second < REQUEST_TIMEOUT_MS) return false;
+        node.inFlight[hash] = now;
+        return true;
+    }
+    
+    Payload encodeBlock(const Block& block) {
+        Payload& bytes = encoded[block.hash];
+        if (!bytes) {
+            auto out = std::make_shared<std::vector<uint8_t>>(block.encodedSize());
+            block.encode(out->data());
+            bytes = std::move(out);
+        }
+        return bytes;
+    }
+    
+    Payload encodeTransaction(const Transaction& tx) {
+        Payload& bytes = encoded[tx.txId];
+        if (!bytes) {
+            auto out = std::make_shared<std::vector<uint8_t>>(tx.encodedSize());
+            tx.encode(out->data());
+            bytes = std::move(out);
+        }
+        return bytes;
+    }
+    
+    void recordArrival(std::unordered_map<Hash256, Spread, DigestHash>& spreads, const Hash256& hash) {
+        auto it = spreads.find(hash);
+        if (it != spreads.end()) it->second.delays.push_back(now - it->second.created);
+    }
+    
+    // Broadcast handler of node `id`: runs for every block that joins its index
+    void onBlockAccepted(size_t id, const Block& block) {
+        Node& node = nodes[id];
+        node.known.insert(block.hash);
+        node.inFlight.erase(block.hash);
+        for (const auto& tx : block.transactions) {
+            node.known.insert(tx.txId); // Confirmed transactions are not fetched again
+        }
+        recordArrival(blockSpread, block.hash);
+        announce(id, MessageType::INV_BLOCK, block.hash, relayOrigin);
+    }
+    
+    void deliver(size_t id) {
+        Node& node = nodes[id];
+        while (!node.inbox.empty() && node.inbox.top().arrival <= now) {
+            Message message = node.inbox.top();
+            node.inbox.pop();
+            handle(id, message);
+        }
+    }
+    
+    void handle(size_t id, const Message& message) {
+        Node& node = nodes[id];
+        switch (message.type) {
+            case MessageType::INV_TX:
+            case MessageType::INV_BLOCK:
+                if (!node.known.count(message.hash) && request(node, message.hash)) {
+                    send(id, message.from, message.type == MessageType::INV_TX ? MessageType::GET_TX
+                                                                                : MessageType::GET_BLOCK,
+                         message.hash);
+                }
+                break;
+            case MessageType::GET_TX:
+                if (auto tx = node.chain->getPendingTransaction(message.hash)) {
+                    send(id, message.from, MessageType::TX, message.hash, encodeTransaction(*tx));
+                }
+                break;
+            case MessageType::GET_BLOCK:
+                if (auto block = node.chain->findBlock(message.hash)) {
+                    send(id, message.from, MessageType::BLOCK, message.hash, encodeBlock(*block));
+                }
+                break;
+            case MessageType::TX: {
+                node.inFlight.erase(message.hash);
+                if (!node.known.insert(message.hash).second) break;
+                ByteReader reader(message.payload->data(), message.payload->size());
+                Transaction tx = Transaction::decode(reader);
+                if (node.chain->addTransactions({tx}) == 0) break;
+                recordArrival(txSpread, tx.txId);
+                announce(id, MessageType::INV_TX, tx.txId, message.from);
+                break;
+            }
+            case MessageType::BLOCK: {
+                node.inFlight.erase(message.hash);
+                if (!node.known.insert(message.hash).second) break;
+                Block block = Block::decode(message.payload->data(), message.payload->size());
+                relayOrigin = message.from;
+                Blockchain::BlockStatus status = node.chain->submitBlock(block);
+                relayOrigin = SIZE_MAX;
+                if (status == Blockchain::BlockStatus::ORPHAN) {
+                    // Ask the peer that had this block for its parent
+                    report.orphanArrivals++;
+                    if (!node.known.count(block.previousHash) && request(node, block.previousHash)) {
+                        send(id, message.from, MessageType::GET_BLOCK, block.previousHash);
+                    }
+                }
+                break;
+            }
+        }
+    }
+    
+    // Every node has the same hash power, so the finder is picked uniformly
+    void mine() {
+        size_t id = std::uniform_int_distribution<size_t>(0, nodes.size() - 1)(rng);
+        Node& node = nodes[id];
+        Block block = node.chain->mineBlock(node.minerAddress, config.maxBlockTransactions);
+        blockSpread[block.hash] = Spread{now, {}};
+        minedBlocks.push_back(block.hash);
+        report.blocksMined++;
+        node.chain->submitBlock(block);
+    }
+    
+    void createTransaction() {
+        std::uniform_int_distribution<size_t> pickWallet(0, wallets.size() - 1);
+        size_t from = pickWallet(rng);
+        size_t to = pickWallet(rng);
+        size_t id = std::uniform_int_distribution<size_t>(0, nodes.size() - 1)(rng);
+        if (from == to) return;
+        
+        Node& node = nodes[id];
+        double balance = node.chain->getBalance(wallets[from]->getAddress());
+        if (balance < 2.0) return;
+        double amount = std::uniform_real_distribution<double>(1.0, std::min(50.0, balance / 2))(rng);
+        double fee = std::uniform_real_distribution<double>(0.001, 0.01)(rng);
+        
+        Transaction tx = wallets[from]->createTransaction(wallets[to]->getAddress(), amount, fee);
+        txSpread[tx.txId] = Spread{now, {}};
+        report.transactionsCreated++;
+        node.known.insert(tx.txId);
+        if (node.chain->addTransactions({tx}) == 0) return;
+        recordArrival(txSpread, tx.txId);
+        announce(id, MessageType::INV_TX, tx.txId, SIZE_MAX);
+    }
+    
+    // Processes events in time order until none are left; creation stops at the configured duration
+    void drain() {
+        while (!events.empty()) {
+            Event event = events.top();
+            events.pop();
+            now = event.time;
+            switch (event.kind) {
+                case EventKind::DELIVER:
+                    deliver(event.node);
+                    break;
+                case EventKind::MINE:
+                    mine();
+                    if (now + 1.0 < config.durationMs) schedule(now + blockGap(rng), EventKind::MINE);
+                    break;
+                case EventKind::TRANSACTION:
+                    createTransaction();
+                    if (now + 1.0 < config.durationMs) schedule(now + txGap(rng), EventKind::TRANSACTION);
+                    break;
+            }
+        }
+    }
+    
+    // Node holding the most common tip; fills in nodesOnBestTip
+    size_t bestTipNode() {
+        std::unordered_map<Hash256, std::pair<size_t, size_t>, DigestHash> tips; // Tip -> (nodes, a holder)
+        for (size_t id = 0; id < nodes.size(); id++) {
+            auto& entry = tips.emplace(nodes[id].chain->snapshot()->tip().hash, std::make_pair(size_t(0), id)).first->second;
+            entry.first++;
+        }
+        auto best = std::max_element(tips.begin(), tips.end(),
+                                     [](const auto& a, const auto& b) { return a.second.first < b.second.first; });
+        report.nodesOnBestTip = best->second.first;
+        return best->second.second;
+    }
+    
+    // Delay until `share` of all nodes held the item, per item that got that far
+    std::vector<double> propagationTimes(std::unordered_map<Hash256, Spread, DigestHash>& spreads) const {
+        size_t needed = static_cast<size_t>(std::ceil(PROPAGATION_SHARE * nodes.size()));
+        std::vector<double> times;
+        for (auto& entry : spreads) {
+            std::vector<double>& delays = entry.second.delays;
+            if (delays.size() < needed) continue;
+            std::nth_element(delays.begin(), delays.begin() + (needed - 1), delays.end());
+            times.push_back(delays[needed - 1]);
+        }
+        return times;
+    }
+    
+    static double percentile(std::vector<double> values, double share) {
+        if (values.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(std::ceil(share * values.size()));
+        rank = std::min(values.size(), std::max<size_t>(rank, 1)) - 1;
+        std::nth_element(values.begin(), values.begin() + rank, values.end());
+        return values[rank];
+    }
+    
+    void summarize() {
+        auto chain = nodes[bestTipNode()].chain->snapshot();
+        std::unordered_set<Hash256, DigestHash> onChain;
+        for (size_t height = 0; height < chain->size(); height++) {
+            onChain.insert((*chain)[height].hash);
+        }
+        report.chainLength = chain->size();
+        report.staleBlocks = 0;
+        for (const Hash256& hash : minedBlocks) {
+            if (!onChain.count(hash)) report.staleBlocks++;
+        }
+        
+        size_t links = 0;
+        for (const Node& node : nodes) {
+            Blockchain::BlockchainStats stats = node.chain->getStats();
+            report.reorganizations += stats.reorganizations;
+            report.deepestReorganization = std::max(report.deepestReorganization, stats.deepestReorganization);
+            links += node.links.size();
+        }
+        report.nodes = nodes.size();
+        report.averagePeers = static_cast<double>(links) / nodes.size();
+        
+        std::vector<double> blockTimes = propagationTimes(blockSpread);
+        report.blockPropagationP50 = percentile(blockTimes, 0.5);
+        report.blockPropagationP90 = percentile(blockTimes, 0.9);
+        std::vector<double> txTimes = propagationTimes(txSpread);
+        report.txPropagationP50 = percentile(txTimes, 0.5);
+        report.txPropagationP90 = percentile(txTimes, 0.9);
+    }
+    
+public:
+    NetworkSimulator() : NetworkSimulator(Config()) {}
+    
+    explicit NetworkSimulator(const Config& settings)
+        : config(settings), rng(settings.seed),
+          blockGap(1.0 / settings.blockIntervalMs), txGap(1.0 / settings.txIntervalMs) {
+        if (config.nodes < 2 || config.wallets < 2) {
+            throw std::invalid_argument("The simulation needs at least two nodes and two wallets");
+        }
+        
+        // The genesis block funds the wallets that create the simulated transactions
+        Block genesis(0, Hash256{}, config.difficulty);
+        for (size_t i = 0; i < config.wallets; i++) {
+            wallets.push_back(std::make_shared<Wallet>());
+            genesis.addTransaction(Transaction("genesis", wallets.back()->getAddress(), config.walletFunds, 0));
+        }
+        genesis.mine("genesis", 1, false);
+        
+        // Block discovery follows blockIntervalMs rather than hash power, so difficulty stays fixed
+        ConsensusRules rules;
+        rules.retargetInterval = 0;
+        
+        nodes.resize(config.nodes);
+        for (size_t id = 0; id < nodes.size(); id++) {
+            nodes[id].chain = std::make_shared<Blockchain>(genesis, rules);
+            nodes[id].chain->setValidationThreads(1);
+            nodes[id].chain->setBroadcastHandlers([this, id](const Block& block) { onBlockAccepted(id, block); },
+                                                  nullptr);
+            nodes[id].minerAddress = Wallet().getAddress();
+        }
+        connect();
+    }
+    
+    NetworkSimulator(const NetworkSimulator&) = delete;
+    NetworkSimulator& operator=(const NetworkSimulator&) = delete;
+    
+    Report run() {
+        auto wallStart = std::chrono::steady_clock::now();
+        schedule(blockGap(rng), EventKind::MINE);
+        schedule(txGap(rng), EventKind::TRANSACTION);
+        drain();
+        
+        // Equal-work branches stay split until the next block settles them
+        while (report.tieBreakBlocks < MAX_TIE_BREAKS) {
+            bestTipNode();
+            if (report.nodesOnBestTip == nodes.size()) break;
+            report.tieBreakBlocks++;
+            schedule(now, EventKind::MINE);
+            drain();
+        }
+        
+        report.simulatedMs = now;
+        summarize();
+        report.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+        return report;
+    }
+    
+    const Blockchain& getNode(size_t id) const { return *nodes.at(id).chain; }
+    
+    static void printReport(const Report& report) {
+        std::cout << "\n=== NETWORK SIMULATION ===" << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Nodes: " << report.nodes << " (" << report.averagePeers << " peers on average), simulated "
+                  << report.simulatedMs / 1000.0 << " s in " << report.wallMs / 1000.0 << " s" << std::endl;
+        std::cout << "Blocks mined: " << report.blocksMined << ", stale: " << report.staleBlocks << " ("
+                  << (report.blocksMined ? 100.0 * report.staleBlocks / report.blocksMined : 0.0) << "%)"
+                  << ", orphan arrivals: " << report.orphanArrivals << std::endl;
+        std::cout << "Reorganizations: " << report.reorganizations << " (deepest: "
+                  << report.deepestReorganization << " blocks)" << std::endl;
+        std::cout << "Transactions created: " << report.transactionsCreated << ", final chain: "
+                  << report.chainLength << " blocks" << std::endl;
+        std::cout << "Block propagation to 90% of nodes: p50 " << report.blockPropagationP50 << " ms, p90 "
+                  << report.blockPropagationP90 << " ms" << std::endl;
+        std::cout << "Transaction propagation to 90% of nodes: p50 " << report.txPropagationP50 << " ms, p90 "
+                  << report.txPropagationP90 << " ms" << std::endl;
+        for (size_t type = 0; type < MESSAGE_TYPES; type++) {
+            std::cout << "  " << std::left << std::setw(10) << describe(static_cast<MessageType>(type)) << std::right
+                      << std::setw(10) << report.messages[type] << " messages, "
+                      << report.bytes[type] / 1024.0 << " KB" << std::endl;
+        }
+        std::cout << "Consensus: " << report.nodesOnBestTip << "/" << report.nodes << " nodes on the same tip ("
+                  << report.tieBreakBlocks << " tie-break blocks)" << std::endl;
+    }
+};
+
 // Demo function
 void runBlockchainDemo() {
     std::cout << "=== BLOCKCHAIN IMPLEMENTATION DEMO ===" << std::endl;
@@ -817,28 +3698,33 @@ void runBlockchainDemo() {
     
     BlockchainNetwork network;
     
-    // Add blockchain node
-    network.addNode();
-    auto blockchain = network.getNode(0);
-    
     // Create wallets
     std::cout << "\nCreating wallets..." << std::endl;
     for (int i = 0; i < 5; i++) {
         network.addWallet();
     }
     
-    // Distribute initial coins from genesis
-    std::cout << "\nDistributing initial coins..." << std::endl;
-    auto genesisWallet = std::make_shared<Wallet>();
-    // Simulate genesis wallet having the genesis address
-    
+    // Distribute initial coins: the genesis block funds every wallet, as in NetworkSimulator
+    std::cout << "\nDistributing initial coins in the genesis block..." << std::endl;
+    Block genesis(0, Hash256{}, 4);
     for (int i = 0; i < 5; i++) {
-        auto wallet = network.getWallet(i);
-        if (wallet) {
-            Transaction initialTx("genesis", wallet->getAddress(), 1000.0, 0.1);
-            blockchain->addTransaction(initialTx);
-        }
+        genesis.addTransaction(Transaction("genesis", network.getWallet(i)->getAddress(), 1000.0, 0));
     }
+    genesis.mine("genesis", 1, false);
+    
+    // Add blockchain nodes; the second one follows the first through block relay
+    network.addNode(genesis);
+    network.addNode();
+    auto blockchain = network.getNode(0);
+    
+#ifdef BLOCKCHAIN_BLOCK_STORE
+    // Persist the node so it can be restarted from disk below
+    std::string storeDirectory = (std::filesystem::temp_directory_path() / "blockchain_demo_store").string();
+    std::filesystem::remove_all(storeDirectory);
+    BlockStore::Options storeOptions;
+    storeOptions.syncEvery = 4;
+    blockchain->persistTo(storeDirectory, storeOptions);
+#endif
     
     // Start mining
     std::cout << "\nStarting mining..." << std::endl;
@@ -871,10 +3757,43 @@ void runBlockchainDemo() {
     blockchain->printBlockchain();
     
     // Validate blockchain
-    std::cout << "Blockchain validation: " 
-              << (blockchain->isChainValid() ? "VALID" : "INVALID") << std::endl;
+    auto validation = blockchain->validateChain();
+    std::cout << "Blockchain validation: " << (validation.valid ? "VALID" : "INVALID");
+    if (!validation.valid) {
+        std::cout << " (block " << validation.failedBlock << ": "
+                  << ChainValidator::describe(validation.failure) << ")";
+    }
+    std::cout << " in " << std::fixed << std::setprecision(2) << validation.elapsedMs << " ms" << std::endl;
+    
+    // Light-client check: a transaction is proven against the block header alone
+    Block tip = blockchain->getLatestBlock();
+    if (!tip.transactions.empty()) {
+        MerkleProof proof = blockchain->getMerkleProof(tip.index, 0);
+        std::cout << "Merkle proof for block " << tip.index << ", tx 0: " << proof.siblings.size() << " hashes, "
+                  << (MerkleTree::verify(tip.transactions[0].txId, proof, tip.merkleRoot) ? "verified" : "REJECTED")
+                  << std::endl;
+    }
     
     blockchain->stopMining();
+    
+#ifdef BLOCKCHAIN_BLOCK_STORE
+    // Restart from disk: the chain is read back and revalidated instead of re-mined
+    std::cout << "\nRestarting node from " << storeDirectory << "..." << std::endl;
+    {
+        Blockchain restarted(storeDirectory);
+        std::cout << "Restarted node has " << restarted.getChainLength() << " blocks, tip "
+                  << CryptoHash::toHex(restarted.getLatestBlock().hash).substr(0, 16) << "..." << std::endl;
+    }
+    std::filesystem::remove_all(storeDirectory);
+#endif
+    
+    // Load test: gossip between simulated nodes over links with latency and limited bandwidth
+    NetworkSimulator::Config simulation;
+    simulation.nodes = 100;
+    simulation.durationMs = 120000;
+    simulation.txIntervalMs = 200;
+    NetworkSimulator::printReport(NetworkSimulator(simulation).run());
+    
     std::cout << "\nBlockchain demo completed!" << std::endl;
 }
 
@@ -3,6 +3,7 @@
 #include <string>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <sstream>
 #include <fstream>
@@ -11,9 +12,35 @@
 #include <queue>
 #include <functional>
 #include <variant>
+#include <string_view>
+#include <charconv>
+#include <new>
+#include <type_traits>
 #include <regex>
 #include <exception>
 #include <iomanip>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <cstring>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <filesystem>
+
+// Template JIT backend: emits x86-64 machine code into mmap'd pages
+#if defined(__x86_64__) && defined(__linux__)
+#define MINILANG_JIT 1
+#include <sys/mman.h>
+#endif
+
+// Sampling profiler: SIGPROF interval timer
+#if defined(__unix__) || defined(__APPLE__)
+#define MINILANG_SAMPLER 1
+#include <csignal>
+#include <sys/time.h>
+#endif
 
 // Forward declarations
 class Token;
@@ -21,9 +48,10 @@ class ASTNode;
 class Parser;
 class Interpreter;
 class CodeGenerator;
+class Function;
 
 // Token types for lexical analysis
-enum class TokenType {
+enum class TokenType : uint8_t {
     // Literals
     NUMBER,
     STRING,
@@ -53,6 +81,7 @@ enum class TokenType {
     WHILE,
     FOR,
     FUNCTION,
+    PURE,
     RETURN,
     VAR,
     CONST,
@@ -79,42 +108,16 @@ enum class TokenType {
     INVALID
 };
 
-// Token class
-class Token {
-public:
-    TokenType type;
-    std::string lexeme;
-    std::variant<double, std::string, bool> literal;
+// Token: 16-byte POD referencing the source buffer by offset/length
+struct Token {
+    uint32_t offset;
+    uint32_t length;
     int line;
-    int column;
-    
-    Token(TokenType t, const std::string& lex, int ln = 1, int col = 1)
-        : type(t), lexeme(lex), line(ln), column(col) {}
-    
-    Token(TokenType t, const std::string& lex, double value, int ln = 1, int col = 1)
-        : type(t), lexeme(lex), literal(value), line(ln), column(col) {}
-    
-    Token(TokenType t, const std::string& lex, const std::string& value, int ln = 1, int col = 1)
-        : type(t), lexeme(lex), literal(value), line(ln), column(col) {}
-    
-    Token(TokenType t, const std::string& lex, bool value, int ln = 1, int col = 1)
-        : type(t), lexeme(lex), literal(value), line(ln), column(col) {}
-    
-    std::string toString() const {
-        std::string result = "Token(" + tokenTypeToString(type) + ", '" + lexeme + "'";
-        if (std::holds_alternative<double>(literal)) {
-            result += ", " + std::to_string(std::get<double>(literal));
-        } else if (std::holds_alternative<std::string>(literal)) {
-            result += ", \"" + std::get<std::string>(literal) + "\"";
-        } else if (std::holds_alternative<bool>(literal)) {
-            result += ", " + (std::get<bool>(literal) ? "true" : "false");
-        }
-        result += ")";
-        return result;
-    }
+    uint16_t column;   // Saturates on very long lines
+    TokenType type;
     
     static std::string tokenTypeToString(TokenType type) {
-        static std::map<TokenType, std::string> typeNames = {
+        static const std::map<TokenType, std::string> typeNames = {
             {TokenType::NUMBER, "NUMBER"},
             {TokenType::STRING, "STRING"},
             {TokenType::BOOLEAN, "BOOLEAN"},
@@ -143,55 +146,200 @@ public:
     }
 };
 
+// Immutable reference-counted string shared by runtime values and the SymbolTable.
+// Counts are not atomic: strings never cross interpreter threads.
+struct StringObject {
+    uint32_t refCount;
+    std::string text;
+    
+    explicit StringObject(std::string value) : refCount(1), text(std::move(value)) {}
+    
+    static void retain(StringObject* object) {
+        object->refCount++;
+    }
+    
+    static void release(StringObject* object) {
+        if (--object->refCount == 0) delete object;
+    }
+};
+
+// Mutable reference-counted array of unboxed doubles. Values share it, so an update
+// through one variable is seen through every other; counts are not atomic, as for strings.
+struct ArrayObject {
+    uint32_t refCount;
+    std::vector<double> elements;
+    
+    explicit ArrayObject(std::vector<double> values) : refCount(1), elements(std::move(values)) {}
+    
+    static void retain(ArrayObject* object) {
+        object->refCount++;
+    }
+    
+    static void release(ArrayObject* object) {
+        if (--object->refCount == 0) delete object;
+    }
+};
+
+// Interned identifiers and string literals (open addressing). The table holds a reference
+// to each entry, so names stay valid for its lifetime and literal values outlive it safely.
+class SymbolTable {
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    
+    std::vector<StringObject*> names;
+    std::vector<uint64_t> hashes;    // Per symbol, to skip most string comparisons
+    std::vector<uint32_t> buckets;   // Symbol index or EMPTY; size is a power of two
+    
+    static uint64_t hashName(std::string_view name) {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (char c : name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+    
+    void grow() {
+        std::vector<uint32_t> larger(buckets.empty() ? 256 : buckets.size() * 2, EMPTY);
+        size_t mask = larger.size() - 1;
+        for (uint32_t index = 0; index < names.size(); index++) {
+            size_t bucket = hashes[index] & mask;
+            while (larger[bucket] != EMPTY) bucket = (bucket + 1) & mask;
+            larger[bucket] = index;
+        }
+        buckets.swap(larger);
+    }
+    
+public:
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    
+    ~SymbolTable() {
+        for (StringObject* name : names) StringObject::release(name);
+    }
+    
+    uint32_t intern(std::string_view name) {
+        if ((names.size() + 1) * 2 > buckets.size()) grow();
+        
+        uint64_t hash = hashName(name);
+        size_t mask = buckets.size() - 1;
+        size_t bucket = hash & mask;
+        while (buckets[bucket] != EMPTY) {
+            uint32_t index = buckets[bucket];
+            if (hashes[index] == hash && names[index]->text == name) return index;
+            bucket = (bucket + 1) & mask;
+        }
+        
+        uint32_t index = static_cast<uint32_t>(names.size());
+        names.push_back(new StringObject(std::string(name)));
+        hashes.push_back(hash);
+        buckets[bucket] = index;
+        return index;
+    }
+    
+    const std::string& name(uint32_t index) const {
+        return names[index]->text;
+    }
+    
+    StringObject* object(uint32_t index) const {
+        return names[index];
+    }
+    
+    size_t size() const {
+        return names.size();
+    }
+};
+
+// Lexer output: tokens plus the immutable buffers they reference
+struct TokenList {
+    std::shared_ptr<const std::string> source;
+    std::shared_ptr<SymbolTable> symbols;
+    std::vector<Token> tokens;
+    
+    std::string_view text(const Token& token) const {
+        return std::string_view(*source).substr(token.offset, token.length);
+    }
+    
+    std::string describe(const Token& token) const {
+        std::string_view lexeme = text(token);
+        std::string value;
+        if (token.type == TokenType::STRING) {
+            value = "\"" + std::string(lexeme.substr(1, lexeme.size() - 2)) + "\"";
+        } else {
+            double number = 0.0;
+            if (token.type == TokenType::NUMBER) {
+                std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), number);
+            }
+            value = std::to_string(number);
+        }
+        return "Token(" + Token::tokenTypeToString(token.type) + ", '" + std::string(lexeme) + "', " + value + ")";
+    }
+};
+
 // Lexer/Scanner class
 class Lexer {
 private:
-    std::string source;
+    std::shared_ptr<const std::string> source;
+    std::shared_ptr<SymbolTable> symbols;
+    const char* text;      // source->data(), cached for the scanning loop
+    size_t length;
     std::vector<Token> tokens;
     size_t start;
     size_t current;
     int line;
     int column;
+    std::ostream* errors = &std::cerr;
     
-    static std::unordered_map<std::string, TokenType> keywords;
+    static const std::unordered_map<std::string_view, TokenType> keywords;
     
 public:
-    Lexer(const std::string& sourceCode) 
-        : source(sourceCode), start(0), current(0), line(1), column(1) {}
+    Lexer(std::shared_ptr<const std::string> sourceBuffer, 
+          std::shared_ptr<SymbolTable> symbolTable = std::make_shared<SymbolTable>())
+        : source(std::move(sourceBuffer)), symbols(std::move(symbolTable)), 
+          text(source->data()), length(source->size()), start(0), current(0), line(1), column(1) {}
     
-    std::vector<Token> scanTokens() {
+    Lexer(std::string sourceCode)
+        : Lexer(std::make_shared<const std::string>(std::move(sourceCode))) {}
+    
+    void setErrorStream(std::ostream& stream) { errors = &stream; }
+    
+    TokenList scanTokens() {
+        tokens.reserve(source->size() / 4 + 1);
+        
         while (!isAtEnd()) {
             start = current;
             scanToken();
         }
         
-        tokens.emplace_back(TokenType::EOF_TOKEN, "", line, column);
-        return tokens;
+        start = current;
+        addToken(TokenType::EOF_TOKEN);
+        return {source, symbols, std::move(tokens)};
     }
     
 private:
     bool isAtEnd() {
-        return current >= source.length();
+        return current >= length;
     }
     
     char advance() {
         column++;
-        return source[current++];
+        return text[current++];
     }
     
     char peek() {
         if (isAtEnd()) return '\0';
-        return source[current];
+        return text[current];
     }
     
     char peekNext() {
-        if (current + 1 >= source.length()) return '\0';
-        return source[current + 1];
+        if (current + 1 >= length) return '\0';
+        return text[current + 1];
     }
     
     bool match(char expected) {
         if (isAtEnd()) return false;
-        if (source[current] != expected) return false;
+        if (text[current] != expected) return false;
         
         current++;
         column++;
@@ -208,7 +356,7 @@ private:
                 // Ignore whitespace
                 break;
             case '\n':
-                tokens.emplace_back(TokenType::NEWLINE, "\\n", line, column - 1);
+                addToken(TokenType::NEWLINE);
                 line++;
                 column = 1;
                 break;
@@ -335,12 +483,9 @@ private:
             return;
         }
         
-        // Consume closing "
+        // Consume closing "; the parser strips the quotes from the token text
         advance();
-        
-        // Extract string value (without quotes)
-        std::string value = source.substr(start + 1, current - start - 2);
-        addToken(TokenType::STRING, value);
+        addToken(TokenType::STRING);
     }
     
     void number() {
@@ -352,28 +497,23 @@ private:
             while (isDigit(peek())) advance();
         }
         
-        double value = std::stod(source.substr(start, current - start));
-        addToken(TokenType::NUMBER, value);
+        addToken(TokenType::NUMBER);
     }
     
     void identifier() {
         while (isAlphaNumeric(peek())) advance();
         
-        std::string text = source.substr(start, current - start);
-        TokenType type = TokenType::IDENTIFIER;
+        std::string_view word(text + start, current - start);
         
-        auto it = keywords.find(text);
-        if (it != keywords.end()) {
-            type = it->second;
-        }
-        
-        if (type == TokenType::TRUE) {
-            addToken(type, true);
-        } else if (type == TokenType::FALSE) {
-            addToken(type, false);
-        } else {
-            addToken(type);
+        // All keywords are 2-8 lowercase letters; skip the hash lookup for everything else
+        if (word.size() >= 2 && word.size() <= 8 && word[0] >= 'a' && word[0] <= 'w') {
+            auto it = keywords.find(word);
+            if (it != keywords.end()) {
+                addToken(it->second);
+                return;
+            }
         }
+        addToken(TokenType::IDENTIFIER);
     }
     
     bool isDigit(char c) {
@@ -391,34 +531,22 @@ private:
     }
     
     void addToken(TokenType type) {
-        std::string text = source.substr(start, current - start);
-        tokens.emplace_back(type, text, line, column - text.length());
-    }
-    
-    void addToken(TokenType type, double literal) {
-        std::string text = source.substr(start, current - start);
-        tokens.emplace_back(type, text, literal, line, column - text.length());
-    }
-    
-    void addToken(TokenType type, const std::string& literal) {
-        std::string text = source.substr(start, current - start);
-        tokens.emplace_back(type, text, literal, line, column - text.length());
-    }
-    
-    void addToken(TokenType type, bool literal) {
-        std::string text = source.substr(start, current - start);
-        tokens.emplace_back(type, text, literal, line, column - text.length());
+        uint32_t tokenLength = static_cast<uint32_t>(current - start);
+        int tokenColumn = std::min(column - static_cast<int>(tokenLength), static_cast<int>(UINT16_MAX));
+        tokens.push_back({static_cast<uint32_t>(start), tokenLength, line, 
+                          static_cast<uint16_t>(tokenColumn), type});
     }
     
     void error(const std::string& message) {
-        std::cerr << "Lexer error at line " << line << ", column " << column 
+        *errors << "Lexer error at line " << line << ", column " << column 
                   << ": " << message << std::endl;
-        tokens.emplace_back(TokenType::INVALID, "", line, column);
+        tokens.push_back({static_cast<uint32_t>(current), 0, line, 
+                          static_cast<uint16_t>(std::min(column, static_cast<int>(UINT16_MAX))), TokenType::INVALID});
     }
 };
 
 // Initialize keywords map
-std::unordered_map<std::string, TokenType> Lexer::keywords = {
+const std::unordered_map<std::string_view, TokenType> Lexer::keywords = {
     {"and", TokenType::AND},
     {"or", TokenType::OR},
     {"not", TokenType::NOT},
@@ -427,6 +555,7 @@ std::unordered_map<std::string, TokenType> Lexer::keywords = {
     {"while", TokenType::WHILE},
     {"for", TokenType::FOR},
     {"function", TokenType::FUNCTION},
+    {"pure", TokenType::PURE},
     {"return", TokenType::RETURN},
     {"var", TokenType::VAR},
     {"const", TokenType::CONST},
@@ -454,7 +583,81 @@ enum class ASTNodeType {
     RETURN_STATEMENT,
     PRINT_STATEMENT,
     BLOCK,
-    EXPRESSION_STATEMENT
+    EXPRESSION_STATEMENT,
+    ARRAY_LITERAL,
+    INDEX,
+    INDEX_ASSIGNMENT
+};
+
+// Bump allocator that owns every node of one AST. Nodes are trivially destructible
+// (names and string literals live in the SymbolTable), so the whole tree is released
+// in one shot by freeing the blocks.
+class AstArena {
+private:
+    static constexpr size_t FIRST_BLOCK_SIZE = 4 * 1024;
+    static constexpr size_t MAX_BLOCK_SIZE = 1024 * 1024;
+    
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t nextBlockSize = FIRST_BLOCK_SIZE;
+    size_t bytesReserved = 0;
+    
+    void* allocate(size_t size, size_t alignment) {
+        auto aligned = [&](char* p) {
+            return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + alignment - 1) & ~(alignment - 1));
+        };
+        
+        char* result = aligned(cursor);
+        if (cursor == nullptr || result + size > limit) {
+            size_t blockSize = std::max(nextBlockSize, size + alignment);
+            blocks.emplace_back(new char[blockSize]);
+            cursor = blocks.back().get();
+            limit = cursor + blockSize;
+            bytesReserved += blockSize;
+            nextBlockSize = std::min(nextBlockSize * 2, MAX_BLOCK_SIZE);
+            result = aligned(cursor);
+        }
+        cursor = result + size;
+        return result;
+    }
+    
+public:
+    AstArena() = default;
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+    
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena nodes are never destroyed individually");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+    
+    template<typename T>
+    T* copyArray(const T* items, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "arena arrays hold plain pointers");
+        if (count == 0) return nullptr;
+        T* array = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::copy(items, items + count, array);
+        return array;
+    }
+    
+    size_t bytesUsed() const {
+        return bytesReserved - static_cast<size_t>(limit - cursor);
+    }
+};
+
+// Fixed-size array of child pointers stored in an AstArena
+template<typename T>
+struct ArenaArray {
+    T* items = nullptr;
+    uint32_t count = 0;
+    
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t index) const { return items[index]; }
 };
 
 // AST Node base class
@@ -463,14 +666,18 @@ public:
     ASTNodeType type;
     int line;
     int column;
+    uint32_t id = 0; // Dense per-program index assigned by the Parser (0: synthesized node)
     
     ASTNode(ASTNodeType t, int ln = 0, int col = 0) 
         : type(t), line(ln), column(col) {}
     
-    virtual ~ASTNode() = default;
     virtual std::string toString(int indent = 0) const = 0;
     
 protected:
+    // Nodes live in an AstArena and are never deleted individually
+    ~ASTNode() = default;
+    
+
     std::string getIndent(int level) const {
         return std::string(level * 2, ' ');
     }
@@ -479,12 +686,12 @@ protected:
 // Specific AST Node types
 class LiteralNode : public ASTNode {
 public:
-    std::variant<double, std::string, bool> value;
+    std::variant<double, StringObject*, bool> value; // Strings are owned by the program's SymbolTable
     
     LiteralNode(double val, int ln = 0, int col = 0)
         : ASTNode(ASTNodeType::LITERAL, ln, col), value(val) {}
     
-    LiteralNode(const std::string& val, int ln = 0, int col = 0)
+    LiteralNode(StringObject* val, int ln = 0, int col = 0)
         : ASTNode(ASTNodeType::LITERAL, ln, col), value(val) {}
     
     LiteralNode(bool val, int ln = 0, int col = 0)
@@ -494,8 +701,8 @@ public:
         std::string result = getIndent(indent) + "Literal(";
         if (std::holds_alternative<double>(value)) {
             result += std::to_string(std::get<double>(value));
-        } else if (std::holds_alternative<std::string>(value)) {
-            result += "\"" + std::get<std::string>(value) + "\"";
+        } else if (std::holds_alternative<StringObject*>(value)) {
+            result += "\"" + std::get<StringObject*>(value)->text + "\"";
         } else if (std::holds_alternative<bool>(value)) {
             result += std::get<bool>(value) ? "true" : "false";
         }
@@ -504,9 +711,19 @@ public:
     }
 };
 
+// Variable binding computed by the Resolver; depth GLOBAL_DEPTH addresses the globals frame
+constexpr int GLOBAL_DEPTH = -1;
+
+struct VariableSlot {
+    int depth = GLOBAL_DEPTH;
+    int slot = -1;
+};
+
+// Names reference interned strings in the program's SymbolTable
 class IdentifierNode : public ASTNode {
 public:
-    std::string name;
+    const std::string& name;
+    VariableSlot binding;
     
     IdentifierNode(const std::string& n, int ln = 0, int col = 0)
         : ASTNode(ASTNodeType::IDENTIFIER, ln, col), name(n) {}
@@ -518,12 +735,12 @@ public:
 
 class BinaryOpNode : public ASTNode {
 public:
-    std::unique_ptr<ASTNode> left;
+    ASTNode* left;
     TokenType operator_;
-    std::unique_ptr<ASTNode> right;
+    ASTNode* right;
     
-    BinaryOpNode(std::unique_ptr<ASTNode> l, TokenType op, std::unique_ptr<ASTNode> r)
-        : ASTNode(ASTNodeType::BINARY_OP), left(std::move(l)), operator_(op), right(std::move(r)) {}
+    BinaryOpNode(ASTNode* l, TokenType op, ASTNode* r)
+        : ASTNode(ASTNodeType::BINARY_OP), left(l), operator_(op), right(r) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "BinaryOp(" + Token::tokenTypeToString(operator_) + ")\n";
@@ -536,10 +753,10 @@ public:
 class UnaryOpNode : public ASTNode {
 public:
     TokenType operator_;
-    std::unique_ptr<ASTNode> operand;
+    ASTNode* operand;
     
-    UnaryOpNode(TokenType op, std::unique_ptr<ASTNode> operand_)
-        : ASTNode(ASTNodeType::UNARY_OP), operator_(op), operand(std::move(operand_)) {}
+    UnaryOpNode(TokenType op, ASTNode* operand_)
+        : ASTNode(ASTNodeType::UNARY_OP), operator_(op), operand(operand_) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "UnaryOp(" + Token::tokenTypeToString(operator_) + ")\n";
@@ -550,11 +767,12 @@ public:
 
 class AssignmentNode : public ASTNode {
 public:
-    std::string variable;
-    std::unique_ptr<ASTNode> value;
+    const std::string& variable;
+    ASTNode* value;
+    VariableSlot binding;
     
-    AssignmentNode(const std::string& var, std::unique_ptr<ASTNode> val)
-        : ASTNode(ASTNodeType::ASSIGNMENT), variable(var), value(std::move(val)) {}
+    AssignmentNode(const std::string& var, ASTNode* val)
+        : ASTNode(ASTNodeType::ASSIGNMENT), variable(var), value(val) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "Assignment(" + variable + ")\n";
@@ -565,12 +783,13 @@ public:
 
 class VariableDeclarationNode : public ASTNode {
 public:
-    std::string name;
-    std::unique_ptr<ASTNode> initializer;
+    const std::string& name;
+    ASTNode* initializer;
     bool isConstant;
+    VariableSlot binding;
     
-    VariableDeclarationNode(const std::string& n, std::unique_ptr<ASTNode> init, bool constant = false)
-        : ASTNode(ASTNodeType::VARIABLE_DECLARATION), name(n), initializer(std::move(init)), isConstant(constant) {}
+    VariableDeclarationNode(const std::string& n, ASTNode* init, bool constant = false)
+        : ASTNode(ASTNodeType::VARIABLE_DECLARATION), name(n), initializer(init), isConstant(constant) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + (isConstant ? "Const(" : "Var(") + name + ")";
@@ -583,13 +802,9 @@ public:
 
 class BlockNode : public ASTNode {
 public:
-    std::vector<std::unique_ptr<ASTNode>> statements;
-    
-    BlockNode() : ASTNode(ASTNodeType::BLOCK) {}
+    ArenaArray<ASTNode*> statements;
     
-    void addStatement(std::unique_ptr<ASTNode> stmt) {
-        statements.push_back(std::move(stmt));
-    }
+    BlockNode(ArenaArray<ASTNode*> stmts) : ASTNode(ASTNodeType::BLOCK), statements(stmts) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "Block";
@@ -602,18 +817,20 @@ public:
 
 class FunctionDeclarationNode : public ASTNode {
 public:
-    std::string name;
-    std::vector<std::string> parameters;
-    std::unique_ptr<BlockNode> body;
+    const std::string& name;
+    ArenaArray<const std::string*> parameters;
+    BlockNode* body;
+    bool pure;         // `pure function`: results are memoized by argument values
+    int frameSize = 0; // Parameters occupy the first slots
     
-    FunctionDeclarationNode(const std::string& n, std::vector<std::string> params, std::unique_ptr<BlockNode> b)
-        : ASTNode(ASTNodeType::FUNCTION_DECLARATION), name(n), parameters(std::move(params)), body(std::move(b)) {}
+    FunctionDeclarationNode(const std::string& n, ArenaArray<const std::string*> params, BlockNode* b, bool isPure = false)
+        : ASTNode(ASTNodeType::FUNCTION_DECLARATION), name(n), parameters(params), body(b), pure(isPure) {}
     
     std::string toString(int indent = 0) const override {
-        std::string result = getIndent(indent) + "Function(" + name + ", params: [";
+        std::string result = getIndent(indent) + (pure ? "PureFunction(" : "Function(") + name + ", params: [";
         for (size_t i = 0; i < parameters.size(); i++) {
             if (i > 0) result += ", ";
-            result += parameters[i];
+            result += *parameters[i];
         }
         result += "])\n";
         result += body->toString(indent + 1);
@@ -621,16 +838,42 @@ public:
     }
 };
 
+// Functions provided by the runtime; a user function with the same name takes precedence
+enum class Builtin : uint8_t {
+    NONE,
+    ARRAY, // array(n[, value]): n copies of value (default 0)
+    LEN,   // len(array or string)
+    PUSH,  // push(array, number): appends, returns the new length
+    SUM,   // sum(array)
+    DOT,   // dot(a, b): arrays of equal length
+    MAP    // map(array, function): applies a one-parameter function to every element
+};
+
+inline Builtin builtinNamed(std::string_view name) {
+    static const std::unordered_map<std::string_view, Builtin> builtins = {
+        {"array", Builtin::ARRAY},
+        {"len", Builtin::LEN},
+        {"push", Builtin::PUSH},
+        {"sum", Builtin::SUM},
+        {"dot", Builtin::DOT},
+        {"map", Builtin::MAP}
+    };
+    auto it = builtins.find(name);
+    return it == builtins.end() ? Builtin::NONE : it->second;
+}
+
 class FunctionCallNode : public ASTNode {
 public:
-    std::string name;
-    std::vector<std::unique_ptr<ASTNode>> arguments;
+    const std::string& name;
+    ArenaArray<ASTNode*> arguments;
+    Builtin builtin = Builtin::NONE; // Set by the Parser when the name is a built-in
     
-    FunctionCallNode(const std::string& n) : ASTNode(ASTNodeType::FUNCTION_CALL), name(n) {}
+    // Inline cache, owned by the Interpreter: valid while cacheEpoch matches its definition epoch
+    Function* cachedFunction = nullptr;
+    uint64_t cacheEpoch = 0;
     
-    void addArgument(std::unique_ptr<ASTNode> arg) {
-        arguments.push_back(std::move(arg));
-    }
+    FunctionCallNode(const std::string& n, ArenaArray<ASTNode*> args)
+        : ASTNode(ASTNodeType::FUNCTION_CALL), name(n), arguments(args) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "FunctionCall(" + name + ")";
@@ -641,14 +884,64 @@ public:
     }
 };
 
+class ArrayLiteralNode : public ASTNode {
+public:
+    ArenaArray<ASTNode*> elements;
+    
+    ArrayLiteralNode(ArenaArray<ASTNode*> elems)
+        : ASTNode(ASTNodeType::ARRAY_LITERAL), elements(elems) {}
+    
+    std::string toString(int indent = 0) const override {
+        std::string result = getIndent(indent) + "Array";
+        for (const auto& element : elements) {
+            result += "\n" + element->toString(indent + 1);
+        }
+        return result;
+    }
+};
+
+class IndexNode : public ASTNode {
+public:
+    ASTNode* array;
+    ASTNode* index;
+    
+    IndexNode(ASTNode* arr, ASTNode* idx)
+        : ASTNode(ASTNodeType::INDEX), array(arr), index(idx) {}
+    
+    std::string toString(int indent = 0) const override {
+        std::string result = getIndent(indent) + "Index\n";
+        result += array->toString(indent + 1) + "\n";
+        result += index->toString(indent + 1);
+        return result;
+    }
+};
+
+class IndexAssignmentNode : public ASTNode {
+public:
+    ASTNode* array;
+    ASTNode* index;
+    ASTNode* value;
+    
+    IndexAssignmentNode(ASTNode* arr, ASTNode* idx, ASTNode* val)
+        : ASTNode(ASTNodeType::INDEX_ASSIGNMENT), array(arr), index(idx), value(val) {}
+    
+    std::string toString(int indent = 0) const override {
+        std::string result = getIndent(indent) + "IndexAssignment\n";
+        result += array->toString(indent + 1) + "\n";
+        result += index->toString(indent + 1) + "\n";
+        result += value->toString(indent + 1);
+        return result;
+    }
+};
+
 class IfStatementNode : public ASTNode {
 public:
-    std::unique_ptr<ASTNode> condition;
-    std::unique_ptr<ASTNode> thenBranch;
-    std::unique_ptr<ASTNode> elseBranch;
+    ASTNode* condition;
+    ASTNode* thenBranch;
+    ASTNode* elseBranch;
     
-    IfStatementNode(std::unique_ptr<ASTNode> cond, std::unique_ptr<ASTNode> then_, std::unique_ptr<ASTNode> else_ = nullptr)
-        : ASTNode(ASTNodeType::IF_STATEMENT), condition(std::move(cond)), thenBranch(std::move(then_)), elseBranch(std::move(else_)) {}
+    IfStatementNode(ASTNode* cond, ASTNode* then_, ASTNode* else_ = nullptr)
+        : ASTNode(ASTNodeType::IF_STATEMENT), condition(cond), thenBranch(then_), elseBranch(else_) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "If\n";
@@ -663,11 +956,11 @@ public:
 
 class WhileStatementNode : public ASTNode {
 public:
-    std::unique_ptr<ASTNode> condition;
-    std::unique_ptr<ASTNode> body;
+    ASTNode* condition;
+    ASTNode* body;
     
-    WhileStatementNode(std::unique_ptr<ASTNode> cond, std::unique_ptr<ASTNode> b)
-        : ASTNode(ASTNodeType::WHILE_STATEMENT), condition(std::move(cond)), body(std::move(b)) {}
+    WhileStatementNode(ASTNode* cond, ASTNode* b)
+        : ASTNode(ASTNodeType::WHILE_STATEMENT), condition(cond), body(b) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "While\n";
@@ -679,10 +972,10 @@ public:
 
 class PrintStatementNode : public ASTNode {
 public:
-    std::unique_ptr<ASTNode> expression;
+    ASTNode* expression;
     
-    PrintStatementNode(std::unique_ptr<ASTNode> expr)
-        : ASTNode(ASTNodeType::PRINT_STATEMENT), expression(std::move(expr)) {}
+    PrintStatementNode(ASTNode* expr)
+        : ASTNode(ASTNodeType::PRINT_STATEMENT), expression(expr) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "Print\n";
@@ -693,10 +986,10 @@ public:
 
 class ReturnStatementNode : public ASTNode {
 public:
-    std::unique_ptr<ASTNode> expression;
+    ASTNode* expression;
     
-    ReturnStatementNode(std::unique_ptr<ASTNode> expr = nullptr)
-        : ASTNode(ASTNodeType::RETURN_STATEMENT), expression(std::move(expr)) {}
+    ReturnStatementNode(ASTNode* expr = nullptr)
+        : ASTNode(ASTNodeType::RETURN_STATEMENT), expression(expr) {}
     
     std::string toString(int indent = 0) const override {
         std::string result = getIndent(indent) + "Return";
@@ -707,14 +1000,21 @@ public:
     }
 };
 
-class ProgramNode : public ASTNode {
+// Root of the tree and owner of its storage: every other node lives in `arena`,
+// and identifier names point into `symbols`
+class ProgramNode final : public ASTNode {
 public:
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    AstArena arena;
+    std::shared_ptr<SymbolTable> symbols;
+    std::vector<ASTNode*> statements;
+    bool resolved = false;
+    std::vector<std::string> globalNames; // Indexed by global slot
+    uint32_t nodeCount = 0;               // Node ids are 1..nodeCount
     
     ProgramNode() : ASTNode(ASTNodeType::PROGRAM) {}
     
-    void addStatement(std::unique_ptr<ASTNode> stmt) {
-        statements.push_back(std::move(stmt));
+    void addStatement(ASTNode* stmt) {
+        statements.push_back(stmt);
     }
     
     std::string toString(int indent = 0) const override {
@@ -742,42 +1042,61 @@ public:
 // Recursive descent parser
 class Parser {
 private:
-    std::vector<Token> tokens;
+    TokenList tokenList;
+    const std::vector<Token>& tokens;
     size_t current;
+    AstArena* arena;
+    std::vector<ASTNode*> pending; // Children of the blocks/calls being parsed, innermost last
+    uint32_t nodeCount = 0;
+    size_t errors = 0;
+    std::ostream* errorStream = &std::cerr;
     
 public:
-    Parser(const std::vector<Token>& tokenList) : tokens(tokenList), current(0) {}
+    Parser(TokenList list) : tokenList(std::move(list)), tokens(tokenList.tokens), current(0), arena(nullptr) {}
+    
+    void setErrorStream(std::ostream& stream) { errorStream = &stream; }
     
     std::unique_ptr<ProgramNode> parse() {
         auto program = std::make_unique<ProgramNode>();
+        program->symbols = tokenList.symbols;
+        arena = &program->arena;
         
         while (!isAtEnd()) {
-            if (match(TokenType::NEWLINE)) continue;
+            if (match({TokenType::NEWLINE})) continue;
             
             try {
                 auto stmt = statement();
                 if (stmt) {
-                    program->addStatement(std::move(stmt));
+                    program->addStatement(stmt);
                 }
             } catch (const ParseException& e) {
-                std::cerr << "Parse error: " << e.what() << std::endl;
+                *errorStream << "Parse error: " << e.what() << std::endl;
+                errors++;
+                pending.clear();
                 synchronize();
             }
         }
         
+        arena = nullptr;
+        program->nodeCount = nodeCount;
+        
         return program;
     }
     
+    size_t errorCount() const {
+        return errors;
+    }
+    
 private:
     bool isAtEnd() {
         return peek().type == TokenType::EOF_TOKEN;
     }
     
-    Token peek() {
+    const Token& peek() const {
         return tokens[current];
     }
     
-    Token previous() {
+    const Token& previous() const {
         return tokens[current - 1];
     }
     
@@ -786,7 +1105,7 @@ private:
         return peek().type == type;
     }
     
-    Token advance() {
+    const Token& advance() {
         if (!isAtEnd()) current++;
         return previous();
     }
@@ -801,10 +1120,33 @@ private:
         return false;
     }
     
-    Token consume(TokenType type, const std::string& message) {
+    // Message is a literal so the common (successful) path does not allocate
+    const Token& consume(TokenType type, const char* message) {
         if (check(type)) return advance();
         
-        throw ParseException(message + " at line " + std::to_string(peek().line));
+        throw ParseException(std::string(message) + " at line " + std::to_string(peek().line));
+    }
+    
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        T* node = arena->make<T>(std::forward<Args>(args)...);
+        node->id = ++nodeCount;
+        node->line = previous().line;
+        node->column = previous().column;
+        return node;
+    }
+    
+    // Moves pending[base..] into the arena as one contiguous child array
+    ArenaArray<ASTNode*> takePending(size_t base) {
+        ArenaArray<ASTNode*> children;
+        children.count = static_cast<uint32_t>(pending.size() - base);
+        children.items = arena->copyArray(pending.data() + base, children.count);
+        pending.resize(base);
+        return children;
+    }
+    
+    const std::string& identifierName(const Token& token) {
+        return tokenList.symbols->name(tokenList.symbols->intern(tokenList.text(token)));
     }
     
     void synchronize() {
@@ -815,6 +1157,7 @@ private:
             
             switch (peek().type) {
                 case TokenType::FUNCTION:
+                case TokenType::PURE:
                 case TokenType::VAR:
                 case TokenType::FOR:
                 case TokenType::IF:
@@ -830,10 +1173,23 @@ private:
         }
     }
     
-    std::unique_ptr<ASTNode> statement() {
+    ASTNode* statement() {
+        // Statements report the line they start on
+        const Token& start = peek();
+        ASTNode* node = statementBody();
+        node->line = start.line;
+        node->column = start.column;
+        return node;
+    }
+    
+    ASTNode* statementBody() {
         if (match({TokenType::VAR})) return variableDeclaration(false);
         if (match({TokenType::CONST})) return variableDeclaration(true);
-        if (match({TokenType::FUNCTION})) return functionDeclaration();
+        if (match({TokenType::FUNCTION})) return functionDeclaration(false);
+        if (match({TokenType::PURE})) {
+            consume(TokenType::FUNCTION, "Expected 'function' after 'pure'");
+            return functionDeclaration(true);
+        }
         if (match({TokenType::IF})) return ifStatement();
         if (match({TokenType::WHILE})) return whileStatement();
         if (match({TokenType::PRINT})) return printStatement();
@@ -843,117 +1199,124 @@ private:
         return expressionStatement();
     }
     
-    std::unique_ptr<ASTNode> variableDeclaration(bool isConstant) {
-        Token name = consume(TokenType::IDENTIFIER, "Expected variable name");
+    ASTNode* variableDeclaration(bool isConstant) {
+        const Token& name = consume(TokenType::IDENTIFIER, "Expected variable name");
         
-        std::unique_ptr<ASTNode> initializer = nullptr;
+        ASTNode* initializer = nullptr;
         if (match({TokenType::ASSIGN})) {
             initializer = expression();
         }
         
         consume(TokenType::SEMICOLON, "Expected ';' after variable declaration");
-        return std::make_unique<VariableDeclarationNode>(name.lexeme, std::move(initializer), isConstant);
+        return make<VariableDeclarationNode>(identifierName(name), initializer, isConstant);
     }
     
-    std::unique_ptr<ASTNode> functionDeclaration() {
-        Token name = consume(TokenType::IDENTIFIER, "Expected function name");
+    ASTNode* functionDeclaration(bool isPure) {
+        const Token& name = consume(TokenType::IDENTIFIER, "Expected function name");
         
         consume(TokenType::LEFT_PAREN, "Expected '(' after function name");
         
-        std::vector<std::string> parameters;
+        std::vector<const std::string*> names;
         if (!check(TokenType::RIGHT_PAREN)) {
             do {
-                Token param = consume(TokenType::IDENTIFIER, "Expected parameter name");
-                parameters.push_back(param.lexeme);
+                const Token& param = consume(TokenType::IDENTIFIER, "Expected parameter name");
+                names.push_back(&identifierName(param));
             } while (match({TokenType::COMMA}));
         }
         
         consume(TokenType::RIGHT_PAREN, "Expected ')' after parameters");
         consume(TokenType::LEFT_BRACE, "Expected '{' before function body");
         
-        auto body = std::unique_ptr<BlockNode>(dynamic_cast<BlockNode*>(block().release()));
+        ArenaArray<const std::string*> parameters;
+        parameters.count = static_cast<uint32_t>(names.size());
+        parameters.items = arena->copyArray(names.data(), names.size());
+        
+        BlockNode* body = block();
         
-        return std::make_unique<FunctionDeclarationNode>(name.lexeme, std::move(parameters), std::move(body));
+        return make<FunctionDeclarationNode>(identifierName(name), parameters, body, isPure);
     }
     
-    std::unique_ptr<ASTNode> ifStatement() {
+    ASTNode* ifStatement() {
         consume(TokenType::LEFT_PAREN, "Expected '(' after 'if'");
         auto condition = expression();
         consume(TokenType::RIGHT_PAREN, "Expected ')' after if condition");
         
         auto thenBranch = statement();
-        std::unique_ptr<ASTNode> elseBranch = nullptr;
+        ASTNode* elseBranch = nullptr;
         
         if (match({TokenType::ELSE})) {
             elseBranch = statement();
         }
         
-        return std::make_unique<IfStatementNode>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+        return make<IfStatementNode>(condition, thenBranch, elseBranch);
     }
     
-    std::unique_ptr<ASTNode> whileStatement() {
+    ASTNode* whileStatement() {
         consume(TokenType::LEFT_PAREN, "Expected '(' after 'while'");
         auto condition = expression();
         consume(TokenType::RIGHT_PAREN, "Expected ')' after while condition");
         
         auto body = statement();
         
-        return std::make_unique<WhileStatementNode>(std::move(condition), std::move(body));
+        return make<WhileStatementNode>(condition, body);
     }
     
-    std::unique_ptr<ASTNode> printStatement() {
+    ASTNode* printStatement() {
         auto expr = expression();
         consume(TokenType::SEMICOLON, "Expected ';' after print expression");
-        return std::make_unique<PrintStatementNode>(std::move(expr));
+        return make<PrintStatementNode>(expr);
     }
     
-    std::unique_ptr<ASTNode> returnStatement() {
-        std::unique_ptr<ASTNode> expr = nullptr;
+    ASTNode* returnStatement() {
+        ASTNode* expr = nullptr;
         if (!check(TokenType::SEMICOLON)) {
             expr = expression();
         }
         
         consume(TokenType::SEMICOLON, "Expected ';' after return statement");
-        return std::make_unique<ReturnStatementNode>(std::move(expr));
+        return make<ReturnStatementNode>(expr);
     }
     
-    std::unique_ptr<ASTNode> block() {
-        auto blockNode = std::make_unique<BlockNode>();
+    BlockNode* block() {
+        size_t base = pending.size();
         
         while (!check(TokenType::RIGHT_BRACE) && !isAtEnd()) {
             if (match({TokenType::NEWLINE})) continue;
             
             auto stmt = statement();
             if (stmt) {
-                blockNode->addStatement(std::move(stmt));
+                pending.push_back(stmt);
             }
         }
         
         consume(TokenType::RIGHT_BRACE, "Expected '}' after block");
-        return std::move(blockNode);
+        return make<BlockNode>(takePending(base));
     }
     
-    std::unique_ptr<ASTNode> expressionStatement() {
+    ASTNode* expressionStatement() {
         auto expr = expression();
         consume(TokenType::SEMICOLON, "Expected ';' after expression");
         return expr;
     }
     
-    std::unique_ptr<ASTNode> expression() {
+    ASTNode* expression() {
         return assignment();
     }
     
-    std::unique_ptr<ASTNode> assignment() {
+    ASTNode* assignment() {
         auto expr = logicalOr();
         
         if (match({TokenType::ASSIGN})) {
-            Token equals = previous();
+            const Token& equals = previous();
             auto value = assignment();
             
-            if (auto identifier = dynamic_cast<IdentifierNode*>(expr.get())) {
-                std::string name = identifier->name;
-                expr.release(); // Release ownership since we're creating a new node
-                return std::make_unique<AssignmentNode>(name, std::move(value));
+            if (expr->type == ASTNodeType::IDENTIFIER) {
+                // The identifier node stays behind in the arena, unused
+                return make<AssignmentNode>(static_cast<IdentifierNode*>(expr)->name, value);
+            }
+            if (expr->type == ASTNodeType::INDEX) {
+                auto target = static_cast<IndexNode*>(expr);
+                return make<IndexAssignmentNode>(target->array, target->index, value);
             }
             
             throw ParseException("Invalid assignment target at line " + std::to_string(equals.line));
@@ -962,94 +1325,98 @@ private:
         return expr;
     }
     
-    std::unique_ptr<ASTNode> logicalOr() {
+    ASTNode* logicalOr() {
         auto expr = logicalAnd();
         
         while (match({TokenType::OR})) {
             TokenType operator_ = previous().type;
             auto right = logicalAnd();
-            expr = std::make_unique<BinaryOpNode>(std::move(expr), operator_, std::move(right));
+            expr = make<BinaryOpNode>(expr, operator_, right);
         }
         
         return expr;
     }
     
-    std::unique_ptr<ASTNode> logicalAnd() {
+    ASTNode* logicalAnd() {
         auto expr = equality();
         
         while (match({TokenType::AND})) {
             TokenType operator_ = previous().type;
             auto right = equality();
-            expr = std::make_unique<BinaryOpNode>(std::move(expr), operator_, std::move(right));
+            expr = make<BinaryOpNode>(expr, operator_, right);
         }
         
         return expr;
     }
     
-    std::unique_ptr<ASTNode> equality() {
+    ASTNode* equality() {
         auto expr = comparison();
         
         while (match({TokenType::NOT_EQUAL, TokenType::EQUAL})) {
             TokenType operator_ = previous().type;
             auto right = comparison();
-            expr = std::make_unique<BinaryOpNode>(std::move(expr), operator_, std::move(right));
+            expr = make<BinaryOpNode>(expr, operator_, right);
         }
         
         return expr;
     }
     
-    std::unique_ptr<ASTNode> comparison() {
+    ASTNode* comparison() {
         auto expr = term();
         
         while (match({TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL})) {
             TokenType operator_ = previous().type;
             auto right = term();
-            expr = std::make_unique<BinaryOpNode>(std::move(expr), operator_, std::move(right));
+            expr = make<BinaryOpNode>(expr, operator_, right);
         }
         
         return expr;
     }
     
-    std::unique_ptr<ASTNode> term() {
+    ASTNode* term() {
         auto expr = factor();
         
         while (match({TokenType::MINUS, TokenType::PLUS})) {
             TokenType operator_ = previous().type;
             auto right = factor();
-            expr = std::make_unique<BinaryOpNode>(std::move(expr), operator_, std::move(right));
+            expr = make<BinaryOpNode>(expr, operator_, right);
         }
         
         return expr;
     }
     
-    std::unique_ptr<ASTNode> factor() {
+    ASTNode* factor() {
         auto expr = unary();
         
         while (match({TokenType::DIVIDE, TokenType::MULTIPLY, TokenType::MODULO})) {
             TokenType operator_ = previous().type;
             auto right = unary();
-            expr = std::make_unique<BinaryOpNode>(std::move(expr), operator_, std::move(right));
+            expr = make<BinaryOpNode>(expr, operator_, right);
         }
         
         return expr;
     }
     
-    std::unique_ptr<ASTNode> unary() {
+    ASTNode* unary() {
         if (match({TokenType::NOT, TokenType::MINUS})) {
             TokenType operator_ = previous().type;
             auto right = unary();
-            return std::make_unique<UnaryOpNode>(operator_, std::move(right));
+            return make<UnaryOpNode>(operator_, right);
         }
         
         return call();
     }
     
-    std::unique_ptr<ASTNode> call() {
+    ASTNode* call() {
         auto expr = primary();
         
         while (true) {
             if (match({TokenType::LEFT_PAREN})) {
-                expr = finishCall(std::move(expr));
+                expr = finishCall(expr);
+            } else if (match({TokenType::LEFT_BRACKET})) {
+                auto index = expression();
+                consume(TokenType::RIGHT_BRACKET, "Expected ']' after index");
+                expr = make<IndexNode>(expr, index);
             } else {
                 break;
             }
@@ -1058,48 +1425,53 @@ private:
         return expr;
     }
     
-    std::unique_ptr<ASTNode> finishCall(std::unique_ptr<ASTNode> callee) {
-        auto identifier = dynamic_cast<IdentifierNode*>(callee.get());
-        if (!identifier) {
+    ASTNode* finishCall(ASTNode* callee) {
+        if (callee->type != ASTNodeType::IDENTIFIER) {
             throw ParseException("Invalid function call");
         }
         
-        std::string name = identifier->name;
-        auto call = std::make_unique<FunctionCallNode>(name);
-        
+        size_t base = pending.size();
         if (!check(TokenType::RIGHT_PAREN)) {
             do {
-                call->addArgument(expression());
+                pending.push_back(expression());
             } while (match({TokenType::COMMA}));
         }
         
         consume(TokenType::RIGHT_PAREN, "Expected ')' after arguments");
-        return std::move(call);
+        auto call = make<FunctionCallNode>(static_cast<IdentifierNode*>(callee)->name, takePending(base));
+        call->builtin = builtinNamed(call->name);
+        return call;
     }
     
-    std::unique_ptr<ASTNode> primary() {
+    ASTNode* primary() {
         if (match({TokenType::TRUE})) {
-            return std::make_unique<LiteralNode>(true);
+            return make<LiteralNode>(true);
         }
         
         if (match({TokenType::FALSE})) {
-            return std::make_unique<LiteralNode>(false);
+            return make<LiteralNode>(false);
         }
         
         if (match({TokenType::NIL})) {
-            return std::make_unique<LiteralNode>(0.0); // Represent nil as 0
+            return make<LiteralNode>(0.0); // Represent nil as 0
         }
         
         if (match({TokenType::NUMBER})) {
-            return std::make_unique<LiteralNode>(std::get<double>(previous().literal));
+            std::string_view text = tokenList.text(previous());
+            double value = 0.0;
+            std::from_chars(text.data(), text.data() + text.size(), value);
+            return make<LiteralNode>(value);
         }
         
         if (match({TokenType::STRING})) {
-            return std::make_unique<LiteralNode>(std::get<std::string>(previous().literal));
+            // Token text includes the surrounding quotes
+            std::string_view text = tokenList.text(previous());
+            SymbolTable& symbols = *tokenList.symbols;
+            return make<LiteralNode>(symbols.object(symbols.intern(text.substr(1, text.size() - 2))));
         }
         
         if (match({TokenType::IDENTIFIER})) {
-            return std::make_unique<IdentifierNode>(previous().lexeme);
+            return make<IdentifierNode>(identifierName(previous()));
         }
         
         if (match({TokenType::LEFT_PAREN})) {
@@ -1108,432 +1480,3783 @@ private:
             return expr;
         }
         
+        if (match({TokenType::LEFT_BRACKET})) {
+            size_t base = pending.size();
+            if (!check(TokenType::RIGHT_BRACKET)) {
+                do {
+                    pending.push_back(expression());
+                } while (match({TokenType::COMMA}));
+            }
+            
+            consume(TokenType::RIGHT_BRACKET, "Expected ']' after array elements");
+            return make<ArrayLiteralNode>(takePending(base));
+        }
+        
         throw ParseException("Expected expression at line " + std::to_string(peek().line));
     }
 };
 
-// Runtime value type
-using RuntimeValue = std::variant<double, std::string, bool>;
-
-// Environment for variable storage
-class Environment {
+// Static resolver: binds every variable reference to a (depth, slot) pair.
+// Block scopes are flattened into their function's frame, so depth counts
+// function boundaries (closures) and entering a block costs nothing at runtime.
+class Resolver {
 private:
-    std::unordered_map<std::string, RuntimeValue> variables;
-    std::shared_ptr<Environment> enclosing;
+    struct FunctionScope {
+        std::vector<std::vector<std::pair<std::string, int>>> blocks;
+        int frameSize = 0;
+    };
     
-public:
-    Environment() : enclosing(nullptr) {}
-    Environment(std::shared_ptr<Environment> enc) : enclosing(enc) {}
-    
-    void define(const std::string& name, const RuntimeValue& value) {
-        variables[name] = value;
-    }
+    std::vector<FunctionScope> functions; // functions[0] is the top-level script
+    std::unordered_map<std::string, int> globalSlots;
+    ProgramNode* program = nullptr;
     
-    RuntimeValue get(const std::string& name) {
-        auto it = variables.find(name);
-        if (it != variables.end()) {
-            return it->second;
+public:
+    void resolve(ProgramNode& root) {
+        program = &root;
+        functions.assign(1, FunctionScope());
+        globalSlots.clear();
+        for (size_t i = 0; i < root.globalNames.size(); i++) {
+            globalSlots[root.globalNames[i]] = static_cast<int>(i);
         }
         
-        if (enclosing) {
-            return enclosing->get(name);
+        for (const auto& statement : root.statements) {
+            resolveNode(statement);
         }
         
-        throw std::runtime_error("Undefined variable '" + name + "'");
+        root.resolved = true;
     }
     
-    void assign(const std::string& name, const RuntimeValue& value) {
-        auto it = variables.find(name);
-        if (it != variables.end()) {
-            it->second = value;
-            return;
-        }
+private:
+    bool isGlobalScope() const {
+        return functions.size() == 1 && functions[0].blocks.empty();
+    }
+    
+    int globalSlot(const std::string& name) {
+        auto it = globalSlots.find(name);
+        if (it != globalSlots.end()) return it->second;
         
-        if (enclosing) {
-            enclosing->assign(name, value);
-            return;
+        int slot = static_cast<int>(program->globalNames.size());
+        program->globalNames.push_back(name);
+        globalSlots[name] = slot;
+        return slot;
+    }
+    
+    // Script-level block locals share the globals frame with the global variables
+    int allocateSlot(FunctionScope& scope) {
+        if (&scope == &functions[0]) {
+            int slot = static_cast<int>(program->globalNames.size());
+            program->globalNames.push_back("");
+            return slot;
         }
-        
-        throw std::runtime_error("Undefined variable '" + name + "'");
+        return scope.frameSize++;
     }
     
-    bool isDefined(const std::string& name) {
-        if (variables.find(name) != variables.end()) {
-            return true;
+    VariableSlot declare(const std::string& name) {
+        if (isGlobalScope()) {
+            return {GLOBAL_DEPTH, globalSlot(name)};
         }
         
-        if (enclosing) {
-            return enclosing->isDefined(name);
+        FunctionScope& scope = functions.back();
+        if (scope.blocks.empty()) scope.blocks.emplace_back();
+        
+        // Redeclaring a name in the same scope reuses its slot
+        for (const auto& entry : scope.blocks.back()) {
+            if (entry.first == name) return {0, entry.second};
         }
         
-        return false;
+        int slot = allocateSlot(scope);
+        scope.blocks.back().emplace_back(name, slot);
+        return {0, slot};
     }
-};
-
-// Function object
-class Function {
-public:
-    std::string name;
-    std::vector<std::string> parameters;
-    std::unique_ptr<BlockNode> body;
-    std::shared_ptr<Environment> closure;
     
-    Function(const std::string& n, std::vector<std::string> params, 
-             std::unique_ptr<BlockNode> b, std::shared_ptr<Environment> env)
-        : name(n), parameters(std::move(params)), closure(env) {
-        // Deep copy the body
-        body = std::unique_ptr<BlockNode>(dynamic_cast<BlockNode*>(b.release()));
+    VariableSlot lookup(const std::string& name) {
+        int depth = 0;
+        for (size_t f = functions.size(); f-- > 0; depth++) {
+            const auto& blocks = functions[f].blocks;
+            for (size_t b = blocks.size(); b-- > 0;) {
+                for (const auto& entry : blocks[b]) {
+                    if (entry.first == name) return {depth, entry.second};
+                }
+            }
+        }
+        
+        return {GLOBAL_DEPTH, globalSlot(name)};
     }
-};
-
-// Return exception for control flow
-class ReturnException : public std::exception {
-public:
-    RuntimeValue value;
-    
-    ReturnException(const RuntimeValue& val) : value(val) {}
-};
-
-// Interpreter class
-class Interpreter {
-private:
-    std::shared_ptr<Environment> globals;
-    std::shared_ptr<Environment> environment;
-    std::unordered_map<std::string, Function> functions;
     
-public:
-    Interpreter() {
-        globals = std::make_shared<Environment>();
-        environment = globals;
+    void beginBlock() {
+        functions.back().blocks.emplace_back();
     }
     
-    void interpret(const std::unique_ptr<ProgramNode>& program) {
-        try {
-            for (const auto& statement : program->statements) {
-                execute(statement.get());
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Runtime error: " << e.what() << std::endl;
-        }
+    void endBlock() {
+        functions.back().blocks.pop_back();
     }
     
-private:
-    void execute(ASTNode* node) {
+    void resolveNode(ASTNode* node) {
         if (!node) return;
         
         switch (node->type) {
-            case ASTNodeType::VARIABLE_DECLARATION:
-                executeVariableDeclaration(dynamic_cast<VariableDeclarationNode*>(node));
+            case ASTNodeType::LITERAL:
                 break;
-            case ASTNodeType::FUNCTION_DECLARATION:
-                executeFunctionDeclaration(dynamic_cast<FunctionDeclarationNode*>(node));
+            case ASTNodeType::IDENTIFIER: {
+                auto identifier = static_cast<IdentifierNode*>(node);
+                identifier->binding = lookup(identifier->name);
                 break;
-            case ASTNodeType::IF_STATEMENT:
-                executeIfStatement(dynamic_cast<IfStatementNode*>(node));
+            }
+            case ASTNodeType::ASSIGNMENT: {
+                auto assignment = static_cast<AssignmentNode*>(node);
+                resolveNode(assignment->value);
+                assignment->binding = lookup(assignment->variable);
                 break;
-            case ASTNodeType::WHILE_STATEMENT:
-                executeWhileStatement(dynamic_cast<WhileStatementNode*>(node));
+            }
+            case ASTNodeType::VARIABLE_DECLARATION: {
+                // The initializer sees the outer binding of a shadowed name
+                auto decl = static_cast<VariableDeclarationNode*>(node);
+                resolveNode(decl->initializer);
+                decl->binding = declare(decl->name);
+                break;
+            }
+            case ASTNodeType::BINARY_OP: {
+                auto binary = static_cast<BinaryOpNode*>(node);
+                resolveNode(binary->left);
+                resolveNode(binary->right);
+                break;
+            }
+            case ASTNodeType::UNARY_OP:
+                resolveNode(static_cast<UnaryOpNode*>(node)->operand);
                 break;
+            case ASTNodeType::FUNCTION_CALL:
+                for (const auto& argument : static_cast<FunctionCallNode*>(node)->arguments) {
+                    resolveNode(argument);
+                }
+                break;
+            case ASTNodeType::ARRAY_LITERAL:
+                for (const auto& element : static_cast<ArrayLiteralNode*>(node)->elements) {
+                    resolveNode(element);
+                }
+                break;
+            case ASTNodeType::INDEX: {
+                auto index = static_cast<IndexNode*>(node);
+                resolveNode(index->array);
+                resolveNode(index->index);
+                break;
+            }
+            case ASTNodeType::INDEX_ASSIGNMENT: {
+                auto assignment = static_cast<IndexAssignmentNode*>(node);
+                resolveNode(assignment->array);
+                resolveNode(assignment->index);
+                resolveNode(assignment->value);
+                break;
+            }
+            case ASTNodeType::FUNCTION_DECLARATION: {
+                auto decl = static_cast<FunctionDeclarationNode*>(node);
+                functions.emplace_back();
+                
+                // Parameters and body statements share one scope, as in evaluateFunctionCall
+                beginBlock();
+                for (const std::string* parameter : decl->parameters) {
+                    declare(*parameter);
+                }
+                if (decl->body) {
+                    for (const auto& statement : decl->body->statements) {
+                        resolveNode(statement);
+                    }
+                }
+                
+                decl->frameSize = functions.back().frameSize;
+                functions.pop_back();
+                break;
+            }
+            case ASTNodeType::IF_STATEMENT: {
+                auto ifNode = static_cast<IfStatementNode*>(node);
+                resolveNode(ifNode->condition);
+                resolveNode(ifNode->thenBranch);
+                resolveNode(ifNode->elseBranch);
+                break;
+            }
+            case ASTNodeType::WHILE_STATEMENT: {
+                auto whileNode = static_cast<WhileStatementNode*>(node);
+                resolveNode(whileNode->condition);
+                resolveNode(whileNode->body);
+                break;
+            }
             case ASTNodeType::PRINT_STATEMENT:
-                executePrintStatement(dynamic_cast<PrintStatementNode*>(node));
+                resolveNode(static_cast<PrintStatementNode*>(node)->expression);
                 break;
             case ASTNodeType::RETURN_STATEMENT:
-                executeReturnStatement(dynamic_cast<ReturnStatementNode*>(node));
+                resolveNode(static_cast<ReturnStatementNode*>(node)->expression);
                 break;
             case ASTNodeType::BLOCK:
-                executeBlock(dynamic_cast<BlockNode*>(node));
-                break;
-            case ASTNodeType::ASSIGNMENT:
-                executeAssignment(dynamic_cast<AssignmentNode*>(node));
+                beginBlock();
+                for (const auto& statement : static_cast<BlockNode*>(node)->statements) {
+                    resolveNode(statement);
+                }
+                endBlock();
                 break;
             default:
-                // Expression statement
-                evaluate(node);
                 break;
         }
     }
+};
+
+// Runtime value type
+// Runtime value: 16 bytes, a type tag plus a double, a bool or a reference-counted
+// immutable string, so copying a string value is a pointer copy. nil is represented as 0.
+class RuntimeValue {
+public:
+    enum class Type : uint8_t {
+        NUMBER,
+        BOOLEAN,
+        STRING,
+        ARRAY
+    };
     
-    void executeVariableDeclaration(VariableDeclarationNode* node) {
-        RuntimeValue value = 0.0; // Default value
-        
-        if (node->initializer) {
-            value = evaluate(node->initializer.get());
-        }
-        
-        environment->define(node->name, value);
+private:
+    union Payload {
+        double number;
+        bool boolean;
+        StringObject* string;
+        ArrayObject* array;
+    };
+    
+    Type type_;
+    Payload payload_;
+    
+    void retain() const {
+        if (type_ == Type::STRING) StringObject::retain(payload_.string);
+        else if (type_ == Type::ARRAY) ArrayObject::retain(payload_.array);
+    }
+    
+    void release() {
+        if (type_ == Type::STRING) StringObject::release(payload_.string);
+        else if (type_ == Type::ARRAY) ArrayObject::release(payload_.array);
+    }
+    
+public:
+    RuntimeValue() : type_(Type::NUMBER) {
+        payload_.number = 0.0;
+    }
+    
+    RuntimeValue(double value) : type_(Type::NUMBER) {
+        payload_.number = value;
+    }
+    
+    RuntimeValue(bool value) : type_(Type::BOOLEAN) {
+        payload_.boolean = value;
+    }
+    
+    RuntimeValue(std::string value) : type_(Type::STRING) {
+        payload_.string = new StringObject(std::move(value));
+    }
+    
+    RuntimeValue(const char* value) : RuntimeValue(std::string(value)) {}
+    
+    RuntimeValue(std::vector<double> elements) : type_(Type::ARRAY) {
+        payload_.array = new ArrayObject(std::move(elements));
+    }
+    
+    // Shares an existing string, e.g. an interned literal
+    explicit RuntimeValue(StringObject* value) : type_(Type::STRING) {
+        payload_.string = value;
+        StringObject::retain(value);
+    }
+    
+    RuntimeValue(const RuntimeValue& other) : type_(other.type_), payload_(other.payload_) {
+        retain();
+    }
+    
+    RuntimeValue(RuntimeValue&& other) noexcept : type_(other.type_), payload_(other.payload_) {
+        other.type_ = Type::NUMBER;
+    }
+    
+    RuntimeValue& operator=(const RuntimeValue& other) {
+        other.retain();
+        release();
+        type_ = other.type_;
+        payload_ = other.payload_;
+        return *this;
+    }
+    
+    RuntimeValue& operator=(RuntimeValue&& other) noexcept {
+        if (this != &other) {
+            release();
+            type_ = other.type_;
+            payload_ = other.payload_;
+            other.type_ = Type::NUMBER;
+        }
+        return *this;
+    }
+    
+    ~RuntimeValue() {
+        release();
+    }
+    
+    Type type() const { return type_; }
+    
+    // Layout used by the JIT's argument guards
+    static size_t typeOffset() { return offsetof(RuntimeValue, type_); }
+    static size_t payloadOffset() { return offsetof(RuntimeValue, payload_); }
+    
+    bool isNumber() const { return type_ == Type::NUMBER; }
+    bool isBoolean() const { return type_ == Type::BOOLEAN; }
+    bool isString() const { return type_ == Type::STRING; }
+    bool isArray() const { return type_ == Type::ARRAY; }
+    
+    double asNumber() const { return payload_.number; }
+    bool asBoolean() const { return payload_.boolean; }
+    const std::string& asString() const { return payload_.string->text; }
+    StringObject* stringObject() const { return payload_.string; }
+    std::vector<double>& asArray() const { return payload_.array->elements; } // Shared, so mutable
+    const ArrayObject* arrayObject() const { return payload_.array; }
+    
+    // The string's buffer when this value is its only owner, so it can be appended to in place
+    std::string* uniqueString() {
+        if (type_ != Type::STRING || payload_.string->refCount != 1) return nullptr;
+        return &payload_.string->text;
+    }
+};
+
+static_assert(sizeof(RuntimeValue) == 16, "RuntimeValue should stay register-pair sized");
+
+// Strict ordering (type first), used to deduplicate constants in the bytecode compiler
+inline bool operator<(const RuntimeValue& a, const RuntimeValue& b) {
+    if (a.type() != b.type()) return a.type() < b.type();
+    switch (a.type()) {
+        case RuntimeValue::Type::NUMBER: return a.asNumber() < b.asNumber();
+        case RuntimeValue::Type::BOOLEAN: return a.asBoolean() < b.asBoolean();
+        case RuntimeValue::Type::STRING: return a.asString() < b.asString();
+        case RuntimeValue::Type::ARRAY: return std::less<const ArrayObject*>()(a.arrayObject(), b.arrayObject());
+    }
+    return false;
+}
+
+// Literal nodes reference strings owned by the SymbolTable; the value shares them
+inline RuntimeValue literalValue(const LiteralNode* node) {
+    if (auto text = std::get_if<StringObject*>(&node->value)) {
+        return RuntimeValue(*text);
+    }
+    if (auto number = std::get_if<double>(&node->value)) {
+        return *number;
+    }
+    return std::get<bool>(node->value);
+}
+
+// Value helpers shared by the tree-walking interpreter and the bytecode VM
+inline bool isTruthy(const RuntimeValue& value) {
+    switch (value.type()) {
+        case RuntimeValue::Type::BOOLEAN: return value.asBoolean();
+        case RuntimeValue::Type::NUMBER: return value.asNumber() != 0.0;
+        case RuntimeValue::Type::STRING: return !value.asString().empty();
+        case RuntimeValue::Type::ARRAY: return !value.asArray().empty();
+    }
+    return false;
+}
+
+inline bool isEqual(const RuntimeValue& a, const RuntimeValue& b) {
+    if (a.type() != b.type()) return false;
+
+    switch (a.type()) {
+        case RuntimeValue::Type::NUMBER: return a.asNumber() == b.asNumber();
+        case RuntimeValue::Type::BOOLEAN: return a.asBoolean() == b.asBoolean();
+        case RuntimeValue::Type::STRING:
+            return a.stringObject() == b.stringObject() || a.asString() == b.asString();
+        case RuntimeValue::Type::ARRAY: return a.arrayObject() == b.arrayObject(); // Identity
+    }
+
+    return false;
+}
+
+inline void checkNumberOperand(const RuntimeValue& operand) {
+    if (!operand.isNumber()) {
+        throw std::runtime_error("Operand must be a number");
+    }
+}
+
+inline void checkNumberOperands(const RuntimeValue& left, const RuntimeValue& right) {
+    if (!left.isNumber() || !right.isNumber()) {
+        throw std::runtime_error("Operands must be numbers");
+    }
+}
+
+// Integral numbers print without decimals
+inline void appendNumber(std::string& out, double d) {
+    char buffer[384];
+    int length = (d == (int)d) ? std::snprintf(buffer, sizeof(buffer), "%d", (int)d)
+                               : std::snprintf(buffer, sizeof(buffer), "%f", d);
+    out.append(buffer, static_cast<size_t>(length));
+}
+
+// Appends the printed form of a value
+inline void appendValue(std::string& out, const RuntimeValue& value) {
+    switch (value.type()) {
+        case RuntimeValue::Type::NUMBER:
+            appendNumber(out, value.asNumber());
+            break;
+        case RuntimeValue::Type::BOOLEAN:
+            out += value.asBoolean() ? "true" : "false";
+            break;
+        case RuntimeValue::Type::STRING:
+            out += value.asString();
+            break;
+        case RuntimeValue::Type::ARRAY: {
+            const std::vector<double>& elements = value.asArray();
+            out += '[';
+            for (size_t i = 0; i < elements.size(); i++) {
+                if (i > 0) out += ", ";
+                appendNumber(out, elements[i]);
+            }
+            out += ']';
+            break;
+        }
+    }
+}
+
+inline std::string valueToString(const RuntimeValue& value) {
+    if (value.isString()) return value.asString();
+    
+    std::string result;
+    appendValue(result, value);
+    return result;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const RuntimeValue& value) {
+    if (value.isString()) return out << value.asString();
+    return out << valueToString(value);
+}
+
+// String concatenation as a builder: a uniquely owned left operand (e.g. the result of
+// a previous '+' in the same expression) is appended to in place, otherwise the result
+// is built in one allocation without temporary strings for the operands
+inline RuntimeValue concatenate(RuntimeValue left, const RuntimeValue& right) {
+    if (std::string* buffer = left.uniqueString()) {
+        appendValue(*buffer, right);
+        return left;
+    }
+    
+    std::string result;
+    result.reserve((left.isString() ? left.asString().size() : 16) + 
+                   (right.isString() ? right.asString().size() : 16));
+    appendValue(result, left);
+    appendValue(result, right);
+    return RuntimeValue(std::move(result));
+}
+
+inline RuntimeValue applyBinaryOperator(TokenType op, RuntimeValue left, const RuntimeValue& right) {
+    switch (op) {
+        case TokenType::PLUS:
+            if (left.isNumber() && right.isNumber()) {
+                return left.asNumber() + right.asNumber();
+            }
+            if (left.isString() || right.isString()) {
+                return concatenate(std::move(left), right);
+            }
+            break;
+        case TokenType::MINUS:
+            checkNumberOperands(left, right);
+            return left.asNumber() - right.asNumber();
+        case TokenType::MULTIPLY:
+            checkNumberOperands(left, right);
+            return left.asNumber() * right.asNumber();
+        case TokenType::DIVIDE:
+            checkNumberOperands(left, right);
+            if (right.asNumber() == 0) {
+                throw std::runtime_error("Division by zero");
+            }
+            return left.asNumber() / right.asNumber();
+        case TokenType::MODULO:
+            checkNumberOperands(left, right);
+            return fmod(left.asNumber(), right.asNumber());
+        case TokenType::GREATER:
+            checkNumberOperands(left, right);
+            return left.asNumber() > right.asNumber();
+        case TokenType::GREATER_EQUAL:
+            checkNumberOperands(left, right);
+            return left.asNumber() >= right.asNumber();
+        case TokenType::LESS:
+            checkNumberOperands(left, right);
+            return left.asNumber() < right.asNumber();
+        case TokenType::LESS_EQUAL:
+            checkNumberOperands(left, right);
+            return left.asNumber() <= right.asNumber();
+        case TokenType::EQUAL:
+            return isEqual(left, right);
+        case TokenType::NOT_EQUAL:
+            return !isEqual(left, right);
+        case TokenType::AND:
+            if (!isTruthy(left)) return left;
+            return right;
+        case TokenType::OR:
+            if (isTruthy(left)) return left;
+            return right;
+        default:
+            break;
+    }
+
+    throw std::runtime_error("Unknown binary operator");
+}
+
+inline RuntimeValue applyUnaryOperator(TokenType op, const RuntimeValue& operand) {
+    switch (op) {
+        case TokenType::MINUS:
+            checkNumberOperand(operand);
+            return -operand.asNumber();
+        case TokenType::NOT:
+            return !isTruthy(operand);
+        default:
+            break;
+    }
+
+    throw std::runtime_error("Unknown unary operator");
+}
+
+// Bounds-checked element position for a[i]
+inline size_t arrayIndex(const RuntimeValue& array, const RuntimeValue& index) {
+    if (!array.isArray()) {
+        throw std::runtime_error("Only arrays can be indexed");
+    }
+    if (!index.isNumber()) {
+        throw std::runtime_error("Array index must be a number");
+    }
+    double position = index.asNumber();
+    if (!(position >= 0.0 && position < static_cast<double>(array.asArray().size())) || 
+        position != std::floor(position)) {
+        throw std::runtime_error("Array index out of bounds");
+    }
+    return static_cast<size_t>(position);
+}
+
+inline double arrayElement(const RuntimeValue& value) {
+    if (!value.isNumber()) {
+        throw std::runtime_error("Array elements must be numbers");
+    }
+    return value.asNumber();
+}
+
+// AST optimizer, run between parsing and resolution. Folds constant expressions,
+// propagates `const` declarations with constant initializers into later references
+// and removes the dead branches of if/while statements with constant conditions.
+// Rewrites happen in place; new nodes are allocated in the program's arena.
+class Optimizer {
+public:
+    struct Stats {
+        int foldedExpressions = 0;
+        int propagatedConstants = 0;
+        int removedBranches = 0;
+        
+        bool changed() const {
+            return foldedExpressions + propagatedConstants + removedBranches > 0;
+        }
+        
+        std::string summary() const {
+            if (!changed()) return "no changes";
+            return "folded " + std::to_string(foldedExpressions) + " constant expression(s), " +
+                   "propagated " + std::to_string(propagatedConstants) + " const reference(s), " +
+                   "removed " + std::to_string(removedBranches) + " dead branch(es)";
+        }
+    };
+    
+private:
+    // Names are interned, so they compare by address. A null value marks a
+    // declaration that shadows an outer constant without being one itself.
+    using Scope = std::vector<std::pair<const std::string*, LiteralNode*>>;
+    
+    ProgramNode* program = nullptr;
+    std::vector<Scope> scopes;
+    std::unordered_set<const std::string*> assignedNames; // Assigned, or declared more than once
+    std::unordered_set<const std::string*> declaredNames;
+    Stats stats;
+    bool propagateConstants = true;
+    
+public:
+    // Off for REPL fragments: a later input may still assign a `const` this one cannot see
+    void setConstantPropagation(bool enabled) { propagateConstants = enabled; }
+    
+    Stats optimize(ProgramNode& root) {
+        program = &root;
+        stats = Stats();
+        scopes.assign(1, Scope());
+        assignedNames.clear();
+        declaredNames.clear();
+        
+        // A const that is ever assigned or redeclared (the interpreter allows both) is not
+        // propagated: a function body may run after the `var` that replaced it
+        for (ASTNode* statement : root.statements) {
+            collectAssignments(statement);
+        }
+        
+        std::vector<ASTNode*> kept;
+        kept.reserve(root.statements.size());
+        for (ASTNode* statement : root.statements) {
+            if (ASTNode* optimized = optimizeStatement(statement)) {
+                kept.push_back(optimized);
+            }
+        }
+        root.statements.swap(kept);
+        
+        program = nullptr;
+        return stats;
+    }
+    
+private:
+    void collectAssignments(ASTNode* node) {
+        if (!node) return;
+        
+        switch (node->type) {
+            case ASTNodeType::ASSIGNMENT: {
+                auto assignment = static_cast<AssignmentNode*>(node);
+                assignedNames.insert(&assignment->variable);
+                collectAssignments(assignment->value);
+                break;
+            }
+            case ASTNodeType::VARIABLE_DECLARATION: {
+                auto decl = static_cast<VariableDeclarationNode*>(node);
+                if (!declaredNames.insert(&decl->name).second) {
+                    assignedNames.insert(&decl->name);
+                }
+                collectAssignments(decl->initializer);
+                break;
+            }
+            case ASTNodeType::BINARY_OP:
+                collectAssignments(static_cast<BinaryOpNode*>(node)->left);
+                collectAssignments(static_cast<BinaryOpNode*>(node)->right);
+                break;
+            case ASTNodeType::UNARY_OP:
+                collectAssignments(static_cast<UnaryOpNode*>(node)->operand);
+                break;
+            case ASTNodeType::FUNCTION_CALL:
+                for (ASTNode* argument : static_cast<FunctionCallNode*>(node)->arguments) {
+                    collectAssignments(argument);
+                }
+                break;
+            case ASTNodeType::ARRAY_LITERAL:
+                for (ASTNode* element : static_cast<ArrayLiteralNode*>(node)->elements) {
+                    collectAssignments(element);
+                }
+                break;
+            case ASTNodeType::INDEX:
+                collectAssignments(static_cast<IndexNode*>(node)->array);
+                collectAssignments(static_cast<IndexNode*>(node)->index);
+                break;
+            case ASTNodeType::INDEX_ASSIGNMENT: {
+                auto assignment = static_cast<IndexAssignmentNode*>(node);
+                collectAssignments(assignment->array);
+                collectAssignments(assignment->index);
+                collectAssignments(assignment->value);
+                break;
+            }
+            case ASTNodeType::FUNCTION_DECLARATION:
+                collectAssignments(static_cast<FunctionDeclarationNode*>(node)->body);
+                break;
+            case ASTNodeType::IF_STATEMENT: {
+                auto ifNode = static_cast<IfStatementNode*>(node);
+                collectAssignments(ifNode->condition);
+                collectAssignments(ifNode->thenBranch);
+                collectAssignments(ifNode->elseBranch);
+                break;
+            }
+            case ASTNodeType::WHILE_STATEMENT:
+                collectAssignments(static_cast<WhileStatementNode*>(node)->condition);
+                collectAssignments(static_cast<WhileStatementNode*>(node)->body);
+                break;
+            case ASTNodeType::PRINT_STATEMENT:
+                collectAssignments(static_cast<PrintStatementNode*>(node)->expression);
+                break;
+            case ASTNodeType::RETURN_STATEMENT:
+                collectAssignments(static_cast<ReturnStatementNode*>(node)->expression);
+                break;
+            case ASTNodeType::BLOCK:
+                for (ASTNode* statement : static_cast<BlockNode*>(node)->statements) {
+                    collectAssignments(statement);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    
+    void declare(const std::string& name, LiteralNode* value) {
+        scopes.back().emplace_back(&name, value);
+    }
+    
+    LiteralNode* lookupConstant(const std::string& name) const {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            for (auto entry = scope->rbegin(); entry != scope->rend(); ++entry) {
+                if (entry->first == &name) return entry->second;
+            }
+        }
+        return nullptr;
+    }
+    
+    LiteralNode* makeLiteral(const RuntimeValue& value) {
+        switch (value.type()) {
+            case RuntimeValue::Type::NUMBER:
+                return program->arena.make<LiteralNode>(value.asNumber());
+            case RuntimeValue::Type::BOOLEAN:
+                return program->arena.make<LiteralNode>(value.asBoolean());
+            case RuntimeValue::Type::STRING: {
+                SymbolTable& symbols = *program->symbols;
+                return program->arena.make<LiteralNode>(symbols.object(symbols.intern(value.asString())));
+            }
+            case RuntimeValue::Type::ARRAY:
+                break; // Operators on literals never produce arrays
+        }
+        return nullptr;
+    }
+    
+    // Branches of if/while get their own scope: a bare `const` there is conditional
+    ASTNode* optimizeBranch(ASTNode* branch) {
+        if (!branch) return nullptr;
+        
+        scopes.emplace_back();
+        ASTNode* optimized = optimizeStatement(branch);
+        scopes.pop_back();
+        
+        if (branch->type == ASTNodeType::VARIABLE_DECLARATION) {
+            declare(static_cast<VariableDeclarationNode*>(branch)->name, nullptr);
+        }
+        return optimized ? optimized : program->arena.make<BlockNode>(ArenaArray<ASTNode*>());
+    }
+    
+    // Returns the replacement statement, or nullptr when it can be dropped
+    ASTNode* optimizeStatement(ASTNode* node) {
+        switch (node->type) {
+            case ASTNodeType::VARIABLE_DECLARATION: {
+                auto decl = static_cast<VariableDeclarationNode*>(node);
+                if (decl->initializer) {
+                    decl->initializer = optimizeExpression(decl->initializer);
+                }
+                bool propagate = propagateConstants && decl->isConstant && decl->initializer && 
+                                 decl->initializer->type == ASTNodeType::LITERAL && 
+                                 !assignedNames.count(&decl->name);
+                declare(decl->name, propagate ? static_cast<LiteralNode*>(decl->initializer) : nullptr);
+                return node;
+            }
+            case ASTNodeType::FUNCTION_DECLARATION: {
+                auto decl = static_cast<FunctionDeclarationNode*>(node);
+                scopes.emplace_back();
+                for (const std::string* parameter : decl->parameters) {
+                    declare(*parameter, nullptr);
+                }
+                optimizeBlock(decl->body);
+                scopes.pop_back();
+                return node;
+            }
+            case ASTNodeType::IF_STATEMENT: {
+                auto ifNode = static_cast<IfStatementNode*>(node);
+                ifNode->condition = optimizeExpression(ifNode->condition);
+                
+                if (ifNode->condition->type == ASTNodeType::LITERAL) {
+                    bool taken = isTruthy(literalValue(static_cast<LiteralNode*>(ifNode->condition)));
+                    ASTNode* dead = taken ? ifNode->elseBranch : ifNode->thenBranch;
+                    // Dropping a bare declaration would change which slot later references resolve to
+                    if (!dead || dead->type != ASTNodeType::VARIABLE_DECLARATION) {
+                        if (dead) stats.removedBranches++;
+                        ASTNode* live = taken ? ifNode->thenBranch : ifNode->elseBranch;
+                        if (!live) return nullptr;
+                        
+                        scopes.emplace_back();
+                        ASTNode* optimized = optimizeStatement(live);
+                        scopes.pop_back();
+                        if (live->type == ASTNodeType::VARIABLE_DECLARATION) {
+                            // Unconditional now, but keep it out of constant propagation as before
+                            declare(static_cast<VariableDeclarationNode*>(live)->name, nullptr);
+                        }
+                        return optimized;
+                    }
+                }
+                
+                ifNode->thenBranch = optimizeBranch(ifNode->thenBranch);
+                if (ifNode->elseBranch) {
+                    ifNode->elseBranch = optimizeBranch(ifNode->elseBranch);
+                }
+                return node;
+            }
+            case ASTNodeType::WHILE_STATEMENT: {
+                auto whileNode = static_cast<WhileStatementNode*>(node);
+                whileNode->condition = optimizeExpression(whileNode->condition);
+                
+                if (whileNode->condition->type == ASTNodeType::LITERAL &&
+                    !isTruthy(literalValue(static_cast<LiteralNode*>(whileNode->condition))) &&
+                    whileNode->body->type != ASTNodeType::VARIABLE_DECLARATION) {
+                    stats.removedBranches++;
+                    return nullptr;
+                }
+                
+                whileNode->body = optimizeBranch(whileNode->body);
+                return node;
+            }
+            case ASTNodeType::PRINT_STATEMENT: {
+                auto print = static_cast<PrintStatementNode*>(node);
+                print->expression = optimizeExpression(print->expression);
+                return node;
+            }
+            case ASTNodeType::RETURN_STATEMENT: {
+                auto returnNode = static_cast<ReturnStatementNode*>(node);
+                if (returnNode->expression) {
+                    returnNode->expression = optimizeExpression(returnNode->expression);
+                }
+                return node;
+            }
+            case ASTNodeType::BLOCK:
+                optimizeBlock(static_cast<BlockNode*>(node));
+                return node;
+            default:
+                return optimizeExpression(node);
+        }
+    }
+    
+    void optimizeBlock(BlockNode* block) {
+        scopes.emplace_back();
+        uint32_t kept = 0;
+        for (ASTNode* statement : block->statements) {
+            if (ASTNode* optimized = optimizeStatement(statement)) {
+                block->statements[kept++] = optimized;
+            }
+        }
+        block->statements.count = kept;
+        scopes.pop_back();
+    }
+    
+    ASTNode* optimizeExpression(ASTNode* node) {
+        switch (node->type) {
+            case ASTNodeType::IDENTIFIER: {
+                if (LiteralNode* constant = lookupConstant(static_cast<IdentifierNode*>(node)->name)) {
+                    stats.propagatedConstants++;
+                    return constant; // Literal nodes are immutable, so they can be shared
+                }
+                return node;
+            }
+            case ASTNodeType::ASSIGNMENT: {
+                auto assignment = static_cast<AssignmentNode*>(node);
+                assignment->value = optimizeExpression(assignment->value);
+                return node;
+            }
+            case ASTNodeType::BINARY_OP: {
+                auto binary = static_cast<BinaryOpNode*>(node);
+                binary->left = optimizeExpression(binary->left);
+                binary->right = optimizeExpression(binary->right);
+                
+                if (binary->left->type == ASTNodeType::LITERAL && binary->right->type == ASTNodeType::LITERAL) {
+                    try {
+                        RuntimeValue value = applyBinaryOperator(binary->operator_, 
+                            literalValue(static_cast<LiteralNode*>(binary->left)),
+                            literalValue(static_cast<LiteralNode*>(binary->right)));
+                        stats.foldedExpressions++;
+                        return makeLiteral(value);
+                    } catch (const std::runtime_error&) {
+                        // Type errors and division by zero are left to fail at runtime
+                    }
+                }
+                return node;
+            }
+            case ASTNodeType::UNARY_OP: {
+                auto unary = static_cast<UnaryOpNode*>(node);
+                unary->operand = optimizeExpression(unary->operand);
+                
+                if (unary->operand->type == ASTNodeType::LITERAL) {
+                    try {
+                        RuntimeValue value = applyUnaryOperator(unary->operator_, 
+                            literalValue(static_cast<LiteralNode*>(unary->operand)));
+                        stats.foldedExpressions++;
+                        return makeLiteral(value);
+                    } catch (const std::runtime_error&) {
+                    }
+                }
+                return node;
+            }
+            case ASTNodeType::FUNCTION_CALL:
+                for (ASTNode*& argument : static_cast<FunctionCallNode*>(node)->arguments) {
+                    argument = optimizeExpression(argument);
+                }
+                return node;
+            case ASTNodeType::ARRAY_LITERAL:
+                for (ASTNode*& element : static_cast<ArrayLiteralNode*>(node)->elements) {
+                    element = optimizeExpression(element);
+                }
+                return node;
+            case ASTNodeType::INDEX: {
+                auto index = static_cast<IndexNode*>(node);
+                index->array = optimizeExpression(index->array);
+                index->index = optimizeExpression(index->index);
+                return node;
+            }
+            case ASTNodeType::INDEX_ASSIGNMENT: {
+                auto assignment = static_cast<IndexAssignmentNode*>(node);
+                assignment->array = optimizeExpression(assignment->array);
+                assignment->index = optimizeExpression(assignment->index);
+                assignment->value = optimizeExpression(assignment->value);
+                return node;
+            }
+            default:
+                return node;
+        }
+    }
+};
+
+// Environment for variable storage: a flat frame of slots assigned by the Resolver
+class Environment {
+private:
+    std::vector<RuntimeValue> slots;
+    std::shared_ptr<Environment> enclosing;
+    
+public:
+    Environment(size_t size = 0, std::shared_ptr<Environment> enc = nullptr) 
+        : slots(size, RuntimeValue(0.0)), enclosing(std::move(enc)) {}
+    
+    void resize(size_t size) {
+        if (size > slots.size()) slots.resize(size, RuntimeValue(0.0));
+    }
+    
+    // Reuse as a fresh call frame (see Interpreter::acquireFrame)
+    void reset(size_t size, std::shared_ptr<Environment> enc) {
+        slots.assign(size, RuntimeValue(0.0));
+        enclosing = std::move(enc);
+    }
+    
+    void clear() {
+        slots.clear();
+        enclosing.reset();
+    }
+    
+    RuntimeValue* data() {
+        return slots.data();
+    }
+    
+    RuntimeValue& at(int slot) {
+        return slots[slot];
+    }
+    
+    RuntimeValue& at(int depth, int slot) {
+        Environment* env = this;
+        while (depth-- > 0) {
+            env = env->enclosing.get();
+        }
+        return env->slots[slot];
+    }
+};
+
+// Template JIT for hot numeric functions (x86-64 Linux only, see MINILANG_JIT).
+//
+// The Interpreter counts calls and loop iterations per function; once a function is hot
+// and every value it touches is provably a number or boolean (parameters, frame locals,
+// literals, arithmetic, comparisons, control flow and calls), each AST node is translated
+// into a fixed x86-64 template in mmap'd memory. Values live as doubles in native stack
+// slots (booleans as 0.0/1.0). The entry stub guards that every argument is a number;
+// a failed guard, a division by zero or a call to something that is not compiled makes
+// the native code return DEOPTIMIZE, and the Interpreter re-runs the call itself. That is
+// safe because compiled functions have no side effects.
+//
+// Every while loop also gets an on-stack replacement entry. When a loop gets hot inside a
+// call that started interpreted, the Interpreter passes the live frame to that entry, which
+// guards and loads every slot and jumps to the compiled loop head; the native code then
+// finishes the call. On DEOPTIMIZE the interpreted frame is untouched, so the loop simply
+// continues in the Interpreter. Hot script-level loops, which work on globals rather than a
+// frame, are compiled on their own: the unit runs on copies of the globals it uses and
+// they are written back only when the loop finishes natively.
+
+// Call target used by native call sites; refers to the function currently bound to a
+// name, and is cleared when the name is rebound to something that is not compiled
+struct JitCallCell {
+    const uint8_t* code = nullptr;
+    int64_t arity = -1;
+};
+
+// A compiled function: executable mapping plus its C-ABI entry point
+class NativeFunction {
+public:
+    enum Status { OK = 0, DEOPTIMIZE = 1 };
+    static constexpr size_t MAX_ARGS = 8;
+    using Entry = int (*)(const RuntimeValue* args, double* result);
+    using LoopEntry = int (*)(double* slots);
+    
+    Entry entry = nullptr;
+    const uint8_t* body = nullptr;  // Internal calling convention, used by other native code
+    std::unordered_map<const ASTNode*, Entry> loopEntries; // OSR: take the whole frame, by while node
+    bool returnsBoolean = false;
+    
+    // Script-level loop units: slots[i] holds loopVariables[i - 1] on entry and exit
+    struct LoopVariable {
+        int slot;         // In the globals frame
+        bool named;       // A global variable, which must be defined; else a script-level block local
+    };
+    LoopEntry loopEntry = nullptr;
+    std::vector<LoopVariable> loopVariables;
+    size_t codeSize = 0;
+    
+    NativeFunction() = default;
+    NativeFunction(const NativeFunction&) = delete;
+    NativeFunction& operator=(const NativeFunction&) = delete;
+    
+    ~NativeFunction() {
+#ifdef MINILANG_JIT
+        if (memory) munmap(memory, mappedSize);
+#endif
+    }
+    
+private:
+    friend class JitCompiler;
+    void* memory = nullptr;
+    size_t mappedSize = 0;
+};
+
+// Reason a function cannot be compiled; it stays on the interpreter
+class JitUnsupported : public std::exception {
+private:
+    std::string message;
+    
+public:
+    JitUnsupported(const std::string& msg) : message(msg) {}
+    
+    const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+#ifdef MINILANG_JIT
+
+// Byte emitter with just the instructions the templates need
+class X64Assembler {
+public:
+    std::vector<uint8_t> code;
+    
+    size_t position() const { return code.size(); }
+    
+    void emit(std::initializer_list<uint8_t> bytes) {
+        code.insert(code.end(), bytes);
+    }
+    
+    void emit32(int32_t value) {
+        for (int i = 0; i < 4; i++) code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    
+    void emit64(uint64_t value) {
+        for (int i = 0; i < 8; i++) code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    
+    // Jumps return the offset of their rel32 operand for patch()
+    size_t jump() { emit({0xE9}); emit32(0); return position() - 4; }
+    size_t jumpIfEqual() { emit({0x0F, 0x84}); emit32(0); return position() - 4; }
+    size_t jumpIfNotEqual() { emit({0x0F, 0x85}); emit32(0); return position() - 4; }
+    
+    void patch(size_t operand, size_t target) {
+        int32_t offset = static_cast<int32_t>(target - (operand + 4));
+        for (int i = 0; i < 4; i++) code[operand + i] = static_cast<uint8_t>(offset >> (8 * i));
+    }
+    
+    void patchImmediate(size_t operand, int32_t value) {
+        for (int i = 0; i < 4; i++) code[operand + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+    
+    void jumpBack(size_t target) {
+        emit({0xE9});
+        emit32(static_cast<int32_t>(target - (position() + 4)));
+    }
+    
+    void loadImmediate(double value) {             // mov rax, imm64; movq xmm0, rax
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        emit({0x48, 0xB8}); emit64(bits);
+        emit({0x66, 0x48, 0x0F, 0x6E, 0xC0});
+    }
+    
+    void loadSlot(int slot) {                       // movsd xmm0, [rbp - 8(slot+1)]
+        emit({0xF2, 0x0F, 0x10, 0x85}); emit32(-8 * (slot + 1));
+    }
+    
+    void storeSlot(int slot) {                      // movsd [rbp - 8(slot+1)], xmm0
+        emit({0xF2, 0x0F, 0x11, 0x85}); emit32(-8 * (slot + 1));
+    }
+    
+    void pushXmm0() {                               // sub rsp, 8; movsd [rsp], xmm0
+        emit({0x48, 0x83, 0xEC, 0x08, 0xF2, 0x0F, 0x11, 0x04, 0x24});
+    }
+    
+    void popXmm0() {                                // movsd xmm0, [rsp]; add rsp, 8
+        emit({0xF2, 0x0F, 0x10, 0x04, 0x24, 0x48, 0x83, 0xC4, 0x08});
+    }
+    
+    void adjustStack(int32_t bytes) {               // add rsp, imm32 (negative to reserve)
+        if (bytes > 0) { emit({0x48, 0x81, 0xC4}); emit32(bytes); }
+        if (bytes < 0) { emit({0x48, 0x81, 0xEC}); emit32(-bytes); }
+    }
+    
+    // Jumps to the returned operand when xmm0 is falsy (0.0); NaN counts as truthy, as in isTruthy
+    size_t jumpIfFalsy() {
+        emit({0x66, 0x0F, 0x57, 0xD2});             // xorpd xmm2, xmm2
+        emit({0x66, 0x0F, 0x2E, 0xC2});             // ucomisd xmm0, xmm2
+        emit({0x7A, 0x06});                         // jp +6 (unordered: truthy)
+        return jumpIfEqual();
+    }
+    
+    void prologue(int frameBytes) {                 // push rbp; mov rbp, rsp; sub rsp, frame
+        emit({0x55, 0x48, 0x89, 0xE5});
+        adjustStack(-frameBytes);
+    }
+    
+    void returnStatus(int status) {                 // mov eax, status; leave; ret
+        emit({0xB8}); emit32(status);
+        emit({0xC9, 0xC3});
+    }
+};
+
+// Translates one FunctionDeclarationNode into native code
+class JitCompiler {
+private:
+    enum class Kind { NUMBER, BOOLEAN };
+    
+    std::function<JitCallCell*(const std::string&)> cellFor;
+    X64Assembler as;
+    std::vector<size_t> deoptimizeJumps;
+    int pushedBytes = 0;          // Temporaries on the native stack, for call alignment
+    std::vector<std::pair<const ASTNode*, size_t>> loopHeads;
+    bool loopUnit = false;
+    std::unordered_map<int, int> unitSlots; // Globals frame slot -> unit slot, for loop units
+    std::vector<NativeFunction::LoopVariable> unitVariables;
+    bool hasReturnKind = false;
+    Kind returnKind = Kind::NUMBER;
+    
+public:
+    explicit JitCompiler(std::function<JitCallCell*(const std::string&)> cells) : cellFor(std::move(cells)) {}
+    
+    std::unique_ptr<NativeFunction> compile(const FunctionDeclarationNode* function) {
+        if (function->parameters.size() > NativeFunction::MAX_ARGS) {
+            throw JitUnsupported("more than " + std::to_string(NativeFunction::MAX_ARGS) + " parameters");
+        }
+        int arity = static_cast<int>(function->parameters.size());
+        
+        // Body: rdi points at the arguments, last argument first; returns status in eax, value in xmm0
+        int frameBytes = (8 * function->frameSize + 15) & ~15;
+        as.prologue(frameBytes);
+        for (int i = 0; i < function->frameSize; i++) {
+            if (i < arity) {
+                as.emit({0xF2, 0x0F, 0x10, 0x87}); as.emit32(8 * (arity - 1 - i)); // movsd xmm0, [rdi + d]
+            } else if (i == arity) {
+                as.emit({0x66, 0x0F, 0x57, 0xC0});                                 // xorpd xmm0, xmm0
+            }
+            as.storeSlot(i);
+        }
+        
+        for (ASTNode* statement : function->body->statements) {
+            compileStatement(statement);
+        }
+        
+        // Falling off the end returns nil (0)
+        if (hasReturnKind && returnKind != Kind::NUMBER) {
+            if (function->body->statements.empty() || 
+                function->body->statements[function->body->statements.size() - 1]->type != ASTNodeType::RETURN_STATEMENT) {
+                throw JitUnsupported("returns both booleans and numbers");
+            }
+        }
+        as.emit({0x66, 0x0F, 0x57, 0xC0});          // xorpd xmm0, xmm0
+        as.returnStatus(NativeFunction::OK);
+        
+        size_t deoptimize = as.position();
+        for (size_t jump : deoptimizeJumps) as.patch(jump, deoptimize);
+        as.returnStatus(NativeFunction::DEOPTIMIZE);
+        
+        size_t entry = as.position();
+        emitEntry(arity, 0);
+        
+        // OSR entries: a body prologue that loads every slot from the frame, then the loop head
+        std::vector<std::pair<const ASTNode*, size_t>> loopEntries;
+        for (const auto& [loop, head] : loopHeads) {
+            size_t body = as.position();
+            as.prologue(frameBytes);
+            for (int i = 0; i < function->frameSize; i++) {
+                as.emit({0xF2, 0x0F, 0x10, 0x87}); as.emit32(8 * (function->frameSize - 1 - i)); // movsd xmm0, [rdi + d]
+                as.storeSlot(i);
+            }
+            as.jumpBack(head);
+            loopEntries.emplace_back(loop, as.position());
+            emitEntry(function->frameSize, body);
+        }
+        
+        auto native = install(entry, hasReturnKind && returnKind == Kind::BOOLEAN);
+        for (const auto& [loop, offset] : loopEntries) {
+            native->loopEntries[loop] = reinterpret_cast<NativeFunction::Entry>(static_cast<uint8_t*>(native->memory) + offset);
+        }
+        return native;
+    }
+    
+    // int entry(double* slots) for a script-level loop. Slot 0 keeps the slots pointer and the
+    // globals frame variables the loop uses get slots from 1, which are only known once the loop is compiled,
+    // so the entry jumps to loads emitted after it. Returning from the script is not supported.
+    std::unique_ptr<NativeFunction> compileLoop(WhileStatementNode* loop) {
+        loopUnit = true;
+        as.emit({0x55, 0x48, 0x89, 0xE5});          // push rbp; mov rbp, rsp
+        as.emit({0x48, 0x81, 0xEC});                // sub rsp, frame
+        size_t frameOperand = as.position();
+        as.emit32(0);
+        as.emit({0x48, 0x89, 0xBD}); as.emit32(-8); // mov [rbp - 8], rdi
+        size_t toLoads = as.jump();
+        
+        size_t loopStart = as.position();
+        compileStatement(loop);
+        
+        int count = static_cast<int>(unitVariables.size());
+        as.emit({0x48, 0x8B, 0xBD}); as.emit32(-8); // mov rdi, [rbp - 8]
+        for (int i = 1; i <= count; i++) {
+            as.loadSlot(i);
+            as.emit({0xF2, 0x0F, 0x11, 0x87}); as.emit32(8 * i);   // movsd [rdi + d], xmm0
+        }
+        as.returnStatus(NativeFunction::OK);
+        
+        size_t deoptimize = as.position();
+        for (size_t jump : deoptimizeJumps) as.patch(jump, deoptimize);
+        as.returnStatus(NativeFunction::DEOPTIMIZE);
+        
+        as.patch(toLoads, as.position());
+        for (int i = 1; i <= count; i++) {
+            as.emit({0xF2, 0x0F, 0x10, 0x87}); as.emit32(8 * i);   // movsd xmm0, [rdi + d]
+            as.storeSlot(i);
+        }
+        as.jumpBack(loopStart);
+        as.patchImmediate(frameOperand, (8 * (count + 1) + 15) & ~15);
+        
+        auto native = install(0, false);
+        native->entry = nullptr;
+        native->body = nullptr;
+        native->loopEntry = reinterpret_cast<NativeFunction::LoopEntry>(native->memory);
+        native->loopVariables = std::move(unitVariables);
+        return native;
+    }
+    
+private:
+    // int entry(const RuntimeValue* args, double* result): guards that the first `arity`
+    // values are numbers, then calls the code at `body` with them
+    void emitEntry(int arity, size_t body) {
+        as.emit({0x55, 0x48, 0x89, 0xE5, 0x56});    // push rbp; mov rbp, rsp; push rsi
+        int argumentBytes = 8 * arity + ((arity % 2 == 0) ? 8 : 0); // Keeps rsp 16-byte aligned at the call
+        as.adjustStack(-argumentBytes);
+        
+        std::vector<size_t> guardFailures;
+        for (int i = 0; i < arity; i++) {
+            int32_t typeOffset = static_cast<int32_t>(sizeof(RuntimeValue) * i + RuntimeValue::typeOffset());
+            int32_t payloadOffset = static_cast<int32_t>(sizeof(RuntimeValue) * i + RuntimeValue::payloadOffset());
+            
+            as.emit({0x80, 0xBF}); as.emit32(typeOffset);                  // cmp byte [rdi + type], NUMBER
+            as.emit({static_cast<uint8_t>(RuntimeValue::Type::NUMBER)});
+            guardFailures.push_back(as.jumpIfNotEqual());
+            as.emit({0xF2, 0x0F, 0x10, 0x87}); as.emit32(payloadOffset);   // movsd xmm0, [rdi + payload]
+            as.emit({0xF2, 0x0F, 0x11, 0x84, 0x24}); as.emit32(8 * (arity - 1 - i)); // movsd [rsp + d], xmm0
+        }
+        
+        as.emit({0x48, 0x89, 0xE7});                // mov rdi, rsp
+        as.emit({0xE8}); as.emit32(static_cast<int32_t>(body - (as.position() + 4))); // call body
+        as.emit({0x85, 0xC0});                      // test eax, eax
+        guardFailures.push_back(as.jumpIfNotEqual());
+        as.emit({0x48, 0x8B, 0x75, 0xF8});          // mov rsi, [rbp - 8]
+        as.emit({0xF2, 0x0F, 0x11, 0x06});          // movsd [rsi], xmm0
+        as.returnStatus(NativeFunction::OK);
+        
+        size_t failure = as.position();
+        for (size_t jump : guardFailures) as.patch(jump, failure);
+        as.returnStatus(NativeFunction::DEOPTIMIZE);
+    }
+    
+    std::unique_ptr<NativeFunction> install(size_t entryOffset, bool returnsBoolean) {
+        size_t pageSize = 4096;
+        size_t mappedSize = (as.code.size() + pageSize - 1) & ~(pageSize - 1);
+        void* memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw JitUnsupported("mmap failed");
+        }
+        std::memcpy(memory, as.code.data(), as.code.size());
+        if (mprotect(memory, mappedSize, PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, mappedSize);
+            throw JitUnsupported("mprotect failed");
+        }
+        
+        auto native = std::make_unique<NativeFunction>();
+        native->memory = memory;
+        native->mappedSize = mappedSize;
+        native->codeSize = as.code.size();
+        native->body = static_cast<const uint8_t*>(memory);
+        native->entry = reinterpret_cast<NativeFunction::Entry>(static_cast<uint8_t*>(memory) + entryOffset);
+        native->returnsBoolean = returnsBoolean;
+        return native;
+    }
+    
+    int localSlot(const VariableSlot& binding, const std::string& name) {
+        if (loopUnit) {
+            // Script-level block locals (depth 0) live in the globals frame too
+            if (binding.depth != GLOBAL_DEPTH && binding.depth != 0) {
+                throw JitUnsupported("uses variable '" + name + "' of an enclosing frame");
+            }
+            auto [it, added] = unitSlots.emplace(binding.slot, static_cast<int>(unitVariables.size()) + 1);
+            if (added) unitVariables.push_back({binding.slot, binding.depth == GLOBAL_DEPTH});
+            return it->second;
+        }
+        if (binding.depth != 0 || binding.slot < 0) {
+            throw JitUnsupported("uses non-local variable '" + name + "'");
+        }
+        return binding.slot;
+    }
+    
+    void compileStatement(ASTNode* node) {
+        switch (node->type) {
+            case ASTNodeType::VARIABLE_DECLARATION: {
+                auto decl = static_cast<VariableDeclarationNode*>(node);
+                int slot = localSlot(decl->binding, decl->name);
+                if (decl->initializer) {
+                    expectNumber(compileExpression(decl->initializer), "local variable");
+                } else {
+                    as.emit({0x66, 0x0F, 0x57, 0xC0});  // xorpd xmm0, xmm0
+                }
+                as.storeSlot(slot);
+                break;
+            }
+            case ASTNodeType::IF_STATEMENT: {
+                auto ifNode = static_cast<IfStatementNode*>(node);
+                compileExpression(ifNode->condition);
+                size_t toElse = as.jumpIfFalsy();
+                compileStatement(ifNode->thenBranch);
+                if (ifNode->elseBranch) {
+                    size_t toEnd = as.jump();
+                    as.patch(toElse, as.position());
+                    compileStatement(ifNode->elseBranch);
+                    as.patch(toEnd, as.position());
+                } else {
+                    as.patch(toElse, as.position());
+                }
+                break;
+            }
+            case ASTNodeType::WHILE_STATEMENT: {
+                auto whileNode = static_cast<WhileStatementNode*>(node);
+                size_t loopStart = as.position();
+                loopHeads.emplace_back(whileNode, loopStart);
+                compileExpression(whileNode->condition);
+                size_t toEnd = as.jumpIfFalsy();
+                compileStatement(whileNode->body);
+                as.jumpBack(loopStart);
+                as.patch(toEnd, as.position());
+                break;
+            }
+            case ASTNodeType::RETURN_STATEMENT: {
+                if (loopUnit) throw JitUnsupported("returns from the script");
+                auto returnNode = static_cast<ReturnStatementNode*>(node);
+                Kind kind = Kind::NUMBER;
+                if (returnNode->expression) {
+                    kind = compileExpression(returnNode->expression);
+                } else {
+                    as.emit({0x66, 0x0F, 0x57, 0xC0});  // xorpd xmm0, xmm0
+                }
+                if (hasReturnKind && kind != returnKind) {
+                    throw JitUnsupported("returns both booleans and numbers");
+                }
+                hasReturnKind = true;
+                returnKind = kind;
+                as.emit({0xC9});                        // leave (drops any temporaries)
+                as.emit({0x31, 0xC0, 0xC3});            // xor eax, eax; ret
+                break;
+            }
+            case ASTNodeType::BLOCK:
+                for (ASTNode* statement : static_cast<BlockNode*>(node)->statements) {
+                    compileStatement(statement);
+                }
+                break;
+            case ASTNodeType::PRINT_STATEMENT:
+                throw JitUnsupported("prints");
+            case ASTNodeType::FUNCTION_DECLARATION:
+                throw JitUnsupported("declares a nested function");
+            default:
+                compileExpression(node); // Expression statement; value discarded
+                break;
+        }
+    }
+    
+    void expectNumber(Kind kind, const char* what) {
+        if (kind != Kind::NUMBER) {
+            throw JitUnsupported(std::string(what) + " may hold a non-number");
+        }
+    }
+    
+    // Leaves the value in xmm0
+    Kind compileExpression(ASTNode* node) {
+        switch (node->type) {
+            case ASTNodeType::LITERAL: {
+                auto literal = static_cast<LiteralNode*>(node);
+                if (auto number = std::get_if<double>(&literal->value)) {
+                    as.loadImmediate(*number);
+                    return Kind::NUMBER;
+                }
+                if (auto boolean = std::get_if<bool>(&literal->value)) {
+                    as.loadImmediate(*boolean ? 1.0 : 0.0);
+                    return Kind::BOOLEAN;
+                }
+                throw JitUnsupported("uses a string");
+            }
+            case ASTNodeType::IDENTIFIER: {
+                auto identifier = static_cast<IdentifierNode*>(node);
+                as.loadSlot(localSlot(identifier->binding, identifier->name));
+                return Kind::NUMBER;
+            }
+            case ASTNodeType::ASSIGNMENT: {
+                auto assignment = static_cast<AssignmentNode*>(node);
+                int slot = localSlot(assignment->binding, assignment->variable);
+                expectNumber(compileExpression(assignment->value), "local variable");
+                as.storeSlot(slot);
+                return Kind::NUMBER;
+            }
+            case ASTNodeType::UNARY_OP: {
+                auto unary = static_cast<UnaryOpNode*>(node);
+                Kind operand = compileExpression(unary->operand);
+                if (unary->operator_ == TokenType::MINUS) {
+                    expectNumber(operand, "negated operand");
+                    as.emit({0x48, 0xB8}); as.emit64(0x8000000000000000ull); // mov rax, sign bit
+                    as.emit({0x66, 0x48, 0x0F, 0x6E, 0xC8});                 // movq xmm1, rax
+                    as.emit({0x66, 0x0F, 0x57, 0xC1});                       // xorpd xmm0, xmm1
+                    return Kind::NUMBER;
+                }
+                if (unary->operator_ == TokenType::NOT) {
+                    as.emit({0x66, 0x0F, 0x57, 0xD2});                       // xorpd xmm2, xmm2
+                    as.emit({0x66, 0x0F, 0x2E, 0xC2});                       // ucomisd xmm0, xmm2
+                    as.emit({0x48, 0xB8}); as.emit64(0x3FF0000000000000ull); // mov rax, 1.0
+                    as.emit({0x7A, 0x02, 0x74, 0x02});                       // jp truthy; je done
+                    as.emit({0x31, 0xC0});                                   // truthy: xor eax, eax
+                    as.emit({0x66, 0x48, 0x0F, 0x6E, 0xC0});                 // done: movq xmm0, rax
+                    return Kind::BOOLEAN;
+                }
+                throw JitUnsupported("uses an unknown unary operator");
+            }
+            case ASTNodeType::BINARY_OP:
+                return compileBinary(static_cast<BinaryOpNode*>(node));
+            case ASTNodeType::FUNCTION_CALL:
+                return compileCall(static_cast<FunctionCallNode*>(node));
+            default:
+                throw JitUnsupported("uses an unsupported expression");
+        }
+    }
+    
+    Kind compileBinary(BinaryOpNode* node) {
+        Kind left = compileExpression(node->left);
+        as.pushXmm0();
+        pushedBytes += 8;
+        Kind right = compileExpression(node->right);
+        as.emit({0xF2, 0x0F, 0x10, 0xC8});          // movsd xmm1, xmm0 (right)
+        as.popXmm0();                               // xmm0 = left
+        pushedBytes -= 8;
+        
+        switch (node->operator_) {
+            case TokenType::PLUS:
+            case TokenType::MINUS:
+            case TokenType::MULTIPLY:
+            case TokenType::DIVIDE:
+            case TokenType::MODULO:
+                expectNumber(left, "arithmetic operand");
+                expectNumber(right, "arithmetic operand");
+                emitArithmetic(node->operator_);
+                return Kind::NUMBER;
+            case TokenType::LESS:
+            case TokenType::LESS_EQUAL:
+            case TokenType::GREATER:
+            case TokenType::GREATER_EQUAL:
+                expectNumber(left, "comparison operand");
+                expectNumber(right, "comparison operand");
+                emitComparison(node->operator_);
+                return Kind::BOOLEAN;
+            case TokenType::EQUAL:
+            case TokenType::NOT_EQUAL:
+                // isEqual is false across types; 1.0 == true would not be
+                if (left != right) throw JitUnsupported("compares a boolean with a number");
+                emitComparison(node->operator_);
+                return Kind::BOOLEAN;
+            case TokenType::AND:
+            case TokenType::OR:
+                // Both sides are already evaluated (eager, like the interpreter); pick one
+                if (left != right) throw JitUnsupported("mixes booleans and numbers in and/or");
+                as.emit({0x66, 0x0F, 0x57, 0xD2});      // xorpd xmm2, xmm2
+                as.emit({0x66, 0x0F, 0x2E, 0xC2});      // ucomisd xmm0, xmm2 (left)
+                if (node->operator_ == TokenType::AND) {
+                    as.emit({0x7A, 0x02, 0x74, 0x04});  // jp take_right; je done (falsy: keep left)
+                } else {
+                    as.emit({0x7A, 0x06, 0x75, 0x04});  // jp done; jne done (truthy: keep left)
+                }
+                as.emit({0xF2, 0x0F, 0x10, 0xC1});      // take_right: movsd xmm0, xmm1
+                return left;
+            default:
+                throw JitUnsupported("uses an unknown binary operator");
+        }
+    }
+    
+    void emitArithmetic(TokenType op) {
+        switch (op) {
+            case TokenType::PLUS: as.emit({0xF2, 0x0F, 0x58, 0xC1}); break;     // addsd xmm0, xmm1
+            case TokenType::MINUS: as.emit({0xF2, 0x0F, 0x5C, 0xC1}); break;    // subsd xmm0, xmm1
+            case TokenType::MULTIPLY: as.emit({0xF2, 0x0F, 0x59, 0xC1}); break; // mulsd xmm0, xmm1
+            case TokenType::DIVIDE:
+                // Division by zero is a runtime error: let the interpreter raise it
+                as.emit({0x66, 0x0F, 0x57, 0xD2});      // xorpd xmm2, xmm2
+                as.emit({0x66, 0x0F, 0x2E, 0xCA});      // ucomisd xmm1, xmm2
+                as.emit({0x7A, 0x06});                  // jp +6
+                deoptimizeJumps.push_back(as.jumpIfEqual());
+                as.emit({0xF2, 0x0F, 0x5E, 0xC1});      // divsd xmm0, xmm1
+                break;
+            case TokenType::MODULO: {
+                double (*fmodFunction)(double, double) = std::fmod;
+                int padding = (pushedBytes % 16 != 0) ? 8 : 0;
+                as.adjustStack(-padding);
+                as.emit({0x48, 0xB8}); as.emit64(reinterpret_cast<uint64_t>(fmodFunction)); // mov rax, fmod
+                as.emit({0xFF, 0xD0});                  // call rax
+                as.adjustStack(padding);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    
+    void emitComparison(TokenType op) {
+        switch (op) {
+            case TokenType::LESS: as.emit({0xF2, 0x0F, 0xC2, 0xC1, 0x01}); break;          // cmpltsd xmm0, xmm1
+            case TokenType::LESS_EQUAL: as.emit({0xF2, 0x0F, 0xC2, 0xC1, 0x02}); break;    // cmplesd xmm0, xmm1
+            case TokenType::GREATER:                                                       // cmpltsd xmm1, xmm0
+                as.emit({0xF2, 0x0F, 0xC2, 0xC8, 0x01, 0xF2, 0x0F, 0x10, 0xC1}); break;
+            case TokenType::GREATER_EQUAL:                                                 // cmplesd xmm1, xmm0
+                as.emit({0xF2, 0x0F, 0xC2, 0xC8, 0x02, 0xF2, 0x0F, 0x10, 0xC1}); break;
+            case TokenType::EQUAL: as.emit({0xF2, 0x0F, 0xC2, 0xC1, 0x00}); break;         // cmpeqsd xmm0, xmm1
+            case TokenType::NOT_EQUAL: as.emit({0xF2, 0x0F, 0xC2, 0xC1, 0x04}); break;     // cmpneqsd xmm0, xmm1
+            default: break;
+        }
+        // All-ones mask -> 1.0
+        as.emit({0x48, 0xB8}); as.emit64(0x3FF0000000000000ull);    // mov rax, 1.0
+        as.emit({0x66, 0x48, 0x0F, 0x6E, 0xD0});                    // movq xmm2, rax
+        as.emit({0x66, 0x0F, 0x54, 0xC2});                          // andpd xmm0, xmm2
+    }
+    
+    // Calls go through the callee name's JitCallCell, so rebinding a name deoptimizes its callers
+    Kind compileCall(FunctionCallNode* node) {
+        // Built-ins run in the interpreter unless a compiled user function shadows the name
+        if (node->builtin != Builtin::NONE && !cellFor(node->name)->code) {
+            throw JitUnsupported("calls built-in '" + node->name + "'");
+        }
+        if (node->arguments.size() > NativeFunction::MAX_ARGS) {
+            throw JitUnsupported("calls with more than " + std::to_string(NativeFunction::MAX_ARGS) + " arguments");
+        }
+        int count = static_cast<int>(node->arguments.size());
+        
+        for (ASTNode* argument : node->arguments) {
+            expectNumber(compileExpression(argument), "argument");
+            as.pushXmm0();
+            pushedBytes += 8;
+        }
+        
+        int padding = (pushedBytes % 16 != 0) ? 8 : 0;
+        as.adjustStack(-padding);
+        if (padding) {
+            as.emit({0x48, 0x8D, 0x7C, 0x24, 0x08});    // lea rdi, [rsp + 8]
+        } else {
+            as.emit({0x48, 0x89, 0xE7});                // mov rdi, rsp
+        }
+        
+        JitCallCell* cell = cellFor(node->name);
+        as.emit({0x48, 0xB9}); as.emit64(reinterpret_cast<uint64_t>(cell)); // mov rcx, cell
+        as.emit({0x48, 0x8B, 0x01});                    // mov rax, [rcx]
+        as.emit({0x48, 0x85, 0xC0});                    // test rax, rax
+        deoptimizeJumps.push_back(as.jumpIfEqual());
+        as.emit({0x48, 0x83, 0x79, 0x08, static_cast<uint8_t>(count)}); // cmp qword [rcx + 8], count
+        deoptimizeJumps.push_back(as.jumpIfNotEqual());
+        as.emit({0xFF, 0xD0});                          // call rax
+        as.emit({0x85, 0xC0});                          // test eax, eax
+        deoptimizeJumps.push_back(as.jumpIfNotEqual());
+        
+        as.adjustStack(8 * count + padding);
+        pushedBytes -= 8 * count;
+        return Kind::NUMBER; // Cells only point at functions returning numbers
+    }
+};
+
+#endif // MINILANG_JIT
+
+// Owns compiled code and call cells for one Interpreter
+class Jit {
+public:
+    static constexpr uint32_t HOT_THRESHOLD = 1000;  // Calls plus loop iterations
+    static constexpr uint32_t MAX_DEOPTIMIZATIONS = 16;
+    
+    struct Stats {
+        int compiled = 0;
+        int rejected = 0;
+        uint64_t nativeCalls = 0;
+        uint64_t deoptimizations = 0;
+    };
+    
+private:
+    struct Entry {
+        std::unique_ptr<NativeFunction> native; // Null when the function is not compilable
+        std::string reason;
+    };
+    
+    std::unordered_map<const FunctionDeclarationNode*, Entry> compiled;
+    std::unordered_map<const WhileStatementNode*, Entry> loops;
+    std::unordered_map<std::string, std::unique_ptr<JitCallCell>> cells;
+    Stats stats;
+    
+public:
+    static bool available() {
+#ifdef MINILANG_JIT
+        return true;
+#else
+        return false;
+#endif
+    }
+    
+    using Resolve = std::function<const FunctionDeclarationNode*(const std::string&)>;
+    
+    // Compiles once per declaration; returns null if the function must stay interpreted.
+    // `resolve` maps a callee name to its current declaration, so callees reached from
+    // native code are compiled eagerly instead of deoptimizing their callers.
+    const NativeFunction* compile(const FunctionDeclarationNode* function, const Resolve& resolve) {
+        auto it = compiled.find(function);
+        if (it != compiled.end()) return it->second.native.get();
+        
+        Entry& entry = compiled[function]; // Also marks recursive compiles as in progress
+        build(entry, resolve, [function](auto& compiler) { return compiler.compile(function); });
+        return entry.native.get();
+    }
+    
+    // A hot script-level loop as its own unit (see JitCompiler::compileLoop); compiled once
+    const NativeFunction* compileLoop(WhileStatementNode* loop, const Resolve& resolve) {
+        auto it = loops.find(loop);
+        if (it != loops.end()) return it->second.native.get();
+        
+        Entry& entry = loops[loop];
+        build(entry, resolve, [loop](auto& compiler) { return compiler.compileLoop(loop); });
+        return entry.native.get();
+    }
+    
+    const NativeFunction* lookup(const FunctionDeclarationNode* function) const {
+        auto it = compiled.find(function);
+        return it == compiled.end() ? nullptr : it->second.native.get();
+    }
+    
+    // Called whenever `name` is (re)bound; native callers only reach compiled numeric functions
+    void bind(const std::string& name, const FunctionDeclarationNode* function, const NativeFunction* native) {
+        auto it = cells.find(name);
+        if (it == cells.end()) {
+            if (!native) return; // No native caller can reference a name without a cell
+            it = cells.emplace(name, std::make_unique<JitCallCell>()).first;
+        }
+        bool callable = native && !native->returnsBoolean;
+        it->second->code = callable ? native->body : nullptr;
+        it->second->arity = static_cast<int64_t>(function->parameters.size());
+    }
+    
+    JitCallCell* cell(const std::string& name) {
+        auto& slot = cells[name];
+        if (!slot) slot = std::make_unique<JitCallCell>();
+        return slot.get();
+    }
+    
+    void recordNativeCall() { stats.nativeCalls++; }
+    void recordDeoptimization() { stats.deoptimizations++; }
+    const Stats& getStats() const { return stats; }
+    
+private:
+    template <typename Emit>
+    void build(Entry& entry, const Resolve& resolve, Emit emit) {
+#ifdef MINILANG_JIT
+        try {
+            JitCompiler compiler([this, &resolve](const std::string& name) {
+                if (const FunctionDeclarationNode* callee = resolve(name)) {
+                    bind(name, callee, compile(callee, resolve));
+                }
+                return cell(name);
+            });
+            entry.native = emit(compiler);
+            stats.compiled++;
+        } catch (const JitUnsupported& e) {
+            entry.reason = e.what();
+            stats.rejected++;
+        }
+#else
+        (void)resolve;
+        (void)emit;
+        entry.reason = "JIT not available on this platform";
+        stats.rejected++;
+#endif
+    }
+};
+
+// Memo table of a `pure` function, keyed by argument values
+struct ArgumentsHash {
+    size_t operator()(const std::vector<RuntimeValue>& arguments) const {
+        size_t hash = arguments.size();
+        for (const auto& value : arguments) {
+            size_t h = 0;
+            switch (value.type()) {
+                case RuntimeValue::Type::NUMBER:
+                    // 0.0 and -0.0 are equal, so they must hash alike
+                    h = std::hash<double>()(value.asNumber() == 0.0 ? 0.0 : value.asNumber());
+                    break;
+                case RuntimeValue::Type::BOOLEAN: h = std::hash<bool>()(value.asBoolean()); break;
+                case RuntimeValue::Type::STRING: h = std::hash<std::string>()(value.asString()); break;
+                case RuntimeValue::Type::ARRAY: h = std::hash<const ArrayObject*>()(value.arrayObject()); break;
+            }
+            hash ^= h + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+};
+
+struct ArgumentsEqual {
+    bool operator()(const std::vector<RuntimeValue>& a, const std::vector<RuntimeValue>& b) const {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++) {
+            if (!isEqual(a[i], b[i])) return false;
+        }
+        return true;
+    }
+};
+
+using MemoTable = std::unordered_map<std::vector<RuntimeValue>, RuntimeValue, ArgumentsHash, ArgumentsEqual>;
+
+// Function object (the declaration is owned by the program's AST)
+class Function {
+public:
+    const FunctionDeclarationNode* declaration;
+    std::shared_ptr<Environment> closure;
+    
+    // Tiering state: calls plus loop iterations, and the compiled code once hot
+    uint32_t hotness = 0;
+    uint32_t deoptimizations = 0;
+    const NativeFunction* native = nullptr;
+    bool jitDisabled = false;
+    
+    std::shared_ptr<MemoTable> memo; // Only for `pure` functions; dropped on redefinition
+    
+    Function(const FunctionDeclarationNode* decl, std::shared_ptr<Environment> env)
+        : declaration(decl), closure(std::move(env)) {}
+};
+
+// How a statement completed; anything but NORMAL unwinds to the enclosing loop or call
+enum class Completion {
+    NORMAL,
+    RETURN,    // Value is in Interpreter::returnValue
+    BREAK,
+    CONTINUE
+};
+
+// Execution profile for the tree-walking interpreter. By default it only counts: every
+// statement gets a hit count and every function a call count, one increment each, with
+// no clock reads on the hot path. Timing is sampled: with a sample rate set, a SIGPROF
+// timer records the running statement and call stack, which gives statement and function
+// self/total time and per-stack time for collapsed-stack (flame graph) output.
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+private:
+    struct StatementStats {
+        uint64_t count = 0;
+        uint64_t samples = 0;
+        int line = 0;
+    };
+    
+    struct FunctionStats {
+        const FunctionDeclarationNode* declaration = nullptr;
+        uint64_t calls = 0;
+        uint64_t totalSamples = 0; // Samples with the function anywhere on the stack, once each
+        uint64_t selfSamples = 0;
+    };
+    
+    struct StackNode {
+        uint32_t parent;
+        uint32_t function;    // Declaration id; 0 is the top-level script
+        uint64_t samples = 0;
+    };
+    
+    struct Sample {
+        uint32_t statement;
+        uint32_t stackNode;
+    };
+    
+    std::vector<StatementStats> statements;     // Indexed by node id
+    std::vector<FunctionStats> functions;       // Indexed by declaration id
+    Clock::time_point startTime;
+    int64_t totalNs = 0;
+    
+    // Sampling state. The signal handler only reads the two atomics and appends to the
+    // preallocated sample buffer; everything else is aggregated in end().
+    unsigned sampleHz;
+    std::vector<StackNode> stackNodes;          // Call-stack trie; [0] is the script
+    std::unordered_map<uint64_t, uint32_t> stackChildren;
+    std::vector<uint32_t> callStack;            // Stack nodes of the callers
+    std::atomic<uint32_t> currentStatement{0};
+    std::atomic<uint32_t> currentStack{0};
+    std::vector<Sample> samples;
+    std::atomic<size_t> sampleCount{0};
+    uint64_t droppedSamples = 0;
+    bool sampling = false;
+    
+#ifdef MINILANG_SAMPLER
+    static inline std::atomic<Profiler*> activeSampler{nullptr};
+    struct sigaction previousAction;
+    
+    static void onSample(int) {
+        Profiler* profiler = activeSampler.load(std::memory_order_relaxed);
+        if (!profiler) return;
+        size_t index = profiler->sampleCount.fetch_add(1, std::memory_order_relaxed);
+        if (index < profiler->samples.size()) {
+            profiler->samples[index] = {profiler->currentStatement.load(std::memory_order_relaxed),
+                                        profiler->currentStack.load(std::memory_order_relaxed)};
+        }
+    }
+    
+    bool startSampling() {
+        Profiler* expected = nullptr;
+        if (!activeSampler.compare_exchange_strong(expected, this)) return false; // One sampler per process
+        
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = &Profiler::onSample;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, &previousAction);
+        
+        itimerval timer;
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = static_cast<suseconds_t>(samplePeriodUs());
+        timer.it_value = timer.it_interval;
+        setitimer(ITIMER_PROF, &timer, nullptr);
+        return true;
+    }
+    
+    void stopSampling() {
+        itimerval timer;
+        std::memset(&timer, 0, sizeof(timer));
+        setitimer(ITIMER_PROF, &timer, nullptr);
+        sigaction(SIGPROF, &previousAction, nullptr);
+        activeSampler.store(nullptr);
+    }
+#else
+    bool startSampling() { return false; }
+    void stopSampling() {}
+#endif
+    
+    int64_t samplePeriodUs() const {
+        return std::max<int64_t>(1, 1000000 / std::max(1u, sampleHz));
+    }
+    
+    // The kernel may deliver fewer signals than requested (timer tick granularity), so each
+    // sample stands for an equal share of the measured run time rather than one period
+    double sampleNs() const {
+        size_t recorded = sampleCount.load() - droppedSamples;
+        if (recorded == 0) return static_cast<double>(samplePeriodUs()) * 1000.0;
+        return static_cast<double>(totalNs) / static_cast<double>(recorded);
+    }
+    
+    uint32_t childStackNode(uint32_t parent, uint32_t function) {
+        uint64_t key = (static_cast<uint64_t>(parent) << 32) | function;
+        auto it = stackChildren.find(key);
+        if (it != stackChildren.end()) return it->second;
+        
+        uint32_t index = static_cast<uint32_t>(stackNodes.size());
+        stackNodes.push_back({parent, function});
+        stackChildren.emplace(key, index);
+        return index;
+    }
+    
+    std::string stackPath(uint32_t node) const {
+        std::vector<std::string> names;
+        for (; node != 0; node = stackNodes[node].parent) {
+            names.push_back(functions[stackNodes[node].function].declaration->name);
+        }
+        std::string path = "<script>";
+        for (auto it = names.rbegin(); it != names.rend(); ++it) {
+            path += ";" + *it;
+        }
+        return path;
+    }
+    
+    void aggregateSamples() {
+        size_t count = std::min(sampleCount.load(), samples.size());
+        droppedSamples = sampleCount.load() - count;
+        for (size_t i = 0; i < count; i++) {
+            statements[samples[i].statement].samples++;
+            stackNodes[samples[i].stackNode].samples++;
+        }
+        
+        std::vector<uint32_t> seen;
+        for (uint32_t node = 1; node < stackNodes.size(); node++) {
+            uint64_t nodeSamples = stackNodes[node].samples;
+            if (nodeSamples == 0) continue;
+            functions[stackNodes[node].function].selfSamples += nodeSamples;
+            seen.clear();
+            for (uint32_t cursor = node; cursor != 0; cursor = stackNodes[cursor].parent) {
+                uint32_t function = stackNodes[cursor].function;
+                if (std::find(seen.begin(), seen.end(), function) != seen.end()) continue; // Recursion
+                seen.push_back(function);
+                functions[function].totalSamples += nodeSamples;
+            }
+        }
+    }
+    
+public:
+    // `hz` > 0 enables timing samples at that rate (where SIGPROF is available)
+    explicit Profiler(const ProgramNode& program, unsigned hz = 0)
+        : statements(program.nodeCount + 1), functions(program.nodeCount + 1), sampleHz(hz) {
+        stackNodes.push_back({0, 0});
+    }
+    
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+    
+    ~Profiler() {
+        if (sampling) stopSampling();
+    }
+    
+    static bool samplingSupported() {
+#ifdef MINILANG_SAMPLER
+        return true;
+#else
+        return false;
+#endif
+    }
+    
+    bool isSampling() const { return sampleHz > 0; }
+    
+    void begin() {
+        if (sampleHz > 0 && !sampling) {
+            samples.assign(1 << 20, Sample{0, 0}); // Over 17 minutes of CPU time at 1 kHz
+            sampling = startSampling();
+            if (!sampling) sampleHz = 0;
+        }
+        startTime = Clock::now();
+    }
+    
+    void end() {
+        totalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count();
+        if (sampling) {
+            stopSampling();
+            sampling = false;
+            aggregateSamples();
+        }
+    }
+    
+    // Returns the statement to restore in leaveStatement()
+    uint32_t enterStatement(const ASTNode* node) {
+        StatementStats& stats = statements[node->id];
+        stats.count++;
+        stats.line = node->line;
+        uint32_t previous = currentStatement.load(std::memory_order_relaxed);
+        currentStatement.store(node->id, std::memory_order_relaxed);
+        return previous;
+    }
+    
+    void leaveStatement(uint32_t previous) {
+        currentStatement.store(previous, std::memory_order_relaxed);
+    }
+    
+    void enterFunction(const FunctionDeclarationNode* declaration) {
+        FunctionStats& stats = functions[declaration->id];
+        stats.declaration = declaration;
+        stats.calls++;
+        if (sampleHz > 0) {
+            uint32_t caller = currentStack.load(std::memory_order_relaxed);
+            callStack.push_back(caller);
+            currentStack.store(childStackNode(caller, declaration->id), std::memory_order_relaxed);
+        }
+    }
+    
+    void leaveFunction() {
+        if (sampleHz > 0) {
+            currentStack.store(callStack.back(), std::memory_order_relaxed);
+            callStack.pop_back();
+        }
+    }
+    
+    // Flat profile: functions, then the hottest source lines (by time when sampled, else by count)
+    void report(std::ostream& out, const std::string& source, size_t maxLines = 20) const {
+        double perSampleMs = sampleNs() / 1e6;
+        auto sampledMs = [&](uint64_t count) { return static_cast<double>(count) * perSampleMs; };
+        bool timed = sampleHz > 0;
+        
+        std::vector<std::string_view> sourceLines;
+        std::string_view rest(source);
+        while (!rest.empty()) {
+            size_t newline = rest.find('\n');
+            sourceLines.push_back(rest.substr(0, newline));
+            rest = newline == std::string_view::npos ? std::string_view() : rest.substr(newline + 1);
+        }
+        
+        out << "Total: " << std::fixed << std::setprecision(3) << static_cast<double>(totalNs) / 1e6 << " ms";
+        if (timed) {
+            out << " (" << sampleCount.load() - droppedSamples << " samples at " << sampleHz << " Hz";
+            if (droppedSamples) out << ", " << droppedSamples << " dropped";
+            out << ")";
+        } else {
+            out << " (counts only; --profile-sample adds sampled timing)";
+        }
+        out << std::endl;
+        
+        std::vector<const FunctionStats*> byFunction;
+        for (const auto& stats : functions) {
+            if (stats.calls > 0) byFunction.push_back(&stats);
+        }
+        std::sort(byFunction.begin(), byFunction.end(), [timed](const FunctionStats* a, const FunctionStats* b) {
+            return timed ? a->selfSamples > b->selfSamples : a->calls > b->calls;
+        });
+        
+        out << "\n" << std::setw(10) << "calls";
+        if (timed) out << std::setw(12) << "total ms" << std::setw(12) << "self ms";
+        out << "  function" << std::endl;
+        for (const FunctionStats* stats : byFunction) {
+            out << std::setw(10) << stats->calls;
+            if (timed) out << std::setw(12) << sampledMs(stats->totalSamples) << std::setw(12) << sampledMs(stats->selfSamples);
+            out << "  " << stats->declaration->name << " (line " << stats->declaration->line << ")" << std::endl;
+        }
+        
+        // Statements on the same line are merged
+        std::map<int, StatementStats> byLine;
+        for (const auto& stats : statements) {
+            if (stats.count == 0 || stats.line <= 0) continue;
+            StatementStats& line = byLine[stats.line];
+            line.line = stats.line;
+            line.count += stats.count;
+            line.samples += stats.samples;
+        }
+        std::vector<StatementStats> lines;
+        for (const auto& entry : byLine) lines.push_back(entry.second);
+        std::sort(lines.begin(), lines.end(), [timed](const StatementStats& a, const StatementStats& b) {
+            return timed ? a.samples > b.samples : a.count > b.count;
+        });
+        if (lines.size() > maxLines) lines.resize(maxLines);
+        
+        out << "\n" << std::setw(10) << "count";
+        if (timed) out << std::setw(12) << "self ms";
+        out << std::setw(7) << "line" << "  source" << std::endl;
+        for (const auto& stats : lines) {
+            std::string_view text;
+            if (static_cast<size_t>(stats.line) <= sourceLines.size()) {
+                text = sourceLines[stats.line - 1];
+                size_t first = text.find_first_not_of(" \t");
+                text = first == std::string_view::npos ? std::string_view() : text.substr(first);
+            }
+            out << std::setw(10) << stats.count;
+            if (timed) out << std::setw(12) << sampledMs(stats.samples);
+            out << std::setw(7) << stats.line << "  " << text << std::endl;
+        }
+        out.unsetf(std::ios::fixed);
+        out << std::setprecision(6);
+    }
+    
+    // One "frame;frame;frame microseconds" line per sampled call stack, as consumed by flamegraph.pl
+    void writeCollapsedStacks(std::ostream& out) const {
+        double perSampleUs = sampleNs() / 1000.0;
+        for (uint32_t node = 0; node < stackNodes.size(); node++) {
+            auto micros = static_cast<int64_t>(static_cast<double>(stackNodes[node].samples) * perSampleUs);
+            if (micros > 0) out << stackPath(node) << " " << micros << "\n";
+        }
+        out.flush();
+    }
+};
+
+// Interpreter class
+class Interpreter {
+private:
+    std::shared_ptr<Environment> globals;
+    std::shared_ptr<Environment> environment;
+    std::vector<bool> globalDefined;
+    std::unordered_map<std::string, Function> functions;
+    RuntimeValue returnValue;
+    Jit jit;
+    bool jitEnabled = Jit::available();
+    Function* activeFunction = nullptr; // Innermost running call, credited with loop iterations
+    
+    // Tiering state of a script-level loop (loops inside calls count toward the function)
+    struct ScriptLoop {
+        uint32_t hotness = 0;
+        uint32_t deoptimizations = 0;
+        const NativeFunction* native = nullptr;
+        bool jitDisabled = false;
+    };
+    std::unordered_map<const WhileStatementNode*, ScriptLoop> scriptLoops;
+    uint64_t definitionEpoch;           // Validates call-site inline caches
+    std::vector<std::shared_ptr<Environment>> frames;
+    size_t callDepth = 0;
+    Profiler* profiler = nullptr;
+    std::ostream* out = &std::cout;
+    std::ostream* err = &std::cerr;
+    
+    // Epochs are unique across interpreters, so a cache filled by another one never matches
+    static uint64_t nextEpoch() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+    
+public:
+    Interpreter() : definitionEpoch(nextEpoch()) {
+        globals = std::make_shared<Environment>();
+        environment = globals;
+    }
+    
+    void setJit(bool enabled) { jitEnabled = enabled && Jit::available(); }
+    void setProfiler(Profiler* p) { profiler = p; }
+    
+    void setOutput(std::ostream& output, std::ostream& errors) {
+        out = &output;
+        err = &errors;
+    }
+    const Jit::Stats& jitStats() const { return jit.getStats(); }
+    
+    void interpret(const std::unique_ptr<ProgramNode>& program) {
+        interpret(*program);
+    }
+    
+    // May be called repeatedly (REPL): globals and functions persist, and the globals
+    // frame grows to the program's slot count. Function bodies must outlive the Interpreter.
+    void interpret(ProgramNode& program) {
+        if (!program.resolved) {
+            Resolver resolver;
+            resolver.resolve(program);
+        }
+        
+        globals->resize(program.globalNames.size());
+        globalDefined.resize(program.globalNames.size(), false);
+        
+        if (profiler) profiler->begin();
+        try {
+            for (const auto& statement : program.statements) {
+                // A top-level return ends the program
+                if (execute(statement) == Completion::RETURN) break;
+            }
+        } catch (const std::exception& e) {
+            *err << "Runtime error: " << e.what() << std::endl;
+        }
+        if (profiler) profiler->end();
+    }
+    
+private:
+    Completion execute(ASTNode* node) {
+        if (!node) return Completion::NORMAL;
+        if (profiler && node->type != ASTNodeType::BLOCK) return executeProfiled(node);
+        return executeNode(node);
+    }
+    
+    Completion executeProfiled(ASTNode* node) {
+        uint32_t previous = profiler->enterStatement(node);
+        try {
+            Completion completion = executeNode(node);
+            profiler->leaveStatement(previous);
+            return completion;
+        } catch (...) {
+            profiler->leaveStatement(previous);
+            throw;
+        }
+    }
+    
+    // Dispatch on the node's type tag; static_cast is safe because each tag has one node class
+    Completion executeNode(ASTNode* node) {
+        switch (node->type) {
+            case ASTNodeType::VARIABLE_DECLARATION:
+                executeVariableDeclaration(static_cast<VariableDeclarationNode*>(node));
+                return Completion::NORMAL;
+            case ASTNodeType::FUNCTION_DECLARATION:
+                executeFunctionDeclaration(static_cast<FunctionDeclarationNode*>(node));
+                return Completion::NORMAL;
+            case ASTNodeType::IF_STATEMENT:
+                return executeIfStatement(static_cast<IfStatementNode*>(node));
+            case ASTNodeType::WHILE_STATEMENT:
+                return executeWhileStatement(static_cast<WhileStatementNode*>(node));
+            case ASTNodeType::PRINT_STATEMENT:
+                executePrintStatement(static_cast<PrintStatementNode*>(node));
+                return Completion::NORMAL;
+            case ASTNodeType::RETURN_STATEMENT:
+                return executeReturnStatement(static_cast<ReturnStatementNode*>(node));
+            case ASTNodeType::BLOCK:
+                return executeBlock(static_cast<BlockNode*>(node));
+            case ASTNodeType::ASSIGNMENT:
+                executeAssignment(static_cast<AssignmentNode*>(node));
+                return Completion::NORMAL;
+            default:
+                // Expression statement
+                evaluate(node);
+                return Completion::NORMAL;
+        }
+    }
+    
+    void executeVariableDeclaration(VariableDeclarationNode* node) {
+        RuntimeValue value = 0.0; // Default value
+        
+        if (node->initializer) {
+            value = evaluate(node->initializer);
+        }
+        
+        if (node->binding.depth == GLOBAL_DEPTH) {
+            globals->at(node->binding.slot) = std::move(value);
+            globalDefined[node->binding.slot] = true;
+        } else {
+            environment->at(node->binding.slot) = std::move(value);
+        }
+    }
+    
+    void executeFunctionDeclaration(FunctionDeclarationNode* node) {
+        Function function(node, environment);
+        if (node->pure) {
+            function.memo = std::make_shared<MemoTable>();
+        }
+        if (jitEnabled) {
+            // Rebinding a name retargets (or clears) the call cell native callers go through
+            function.native = jit.lookup(node);
+            jit.bind(node->name, node, function.native);
+        }
+        functions.insert_or_assign(node->name, std::move(function));
+        definitionEpoch = nextEpoch();
+    }
+    
+    Completion executeIfStatement(IfStatementNode* node) {
+        RuntimeValue condition = evaluate(node->condition);
+        
+        if (isTruthy(condition)) {
+            return execute(node->thenBranch);
+        } else if (node->elseBranch) {
+            return execute(node->elseBranch);
+        }
+        return Completion::NORMAL;
+    }
+    
+    Completion executeWhileStatement(WhileStatementNode* node) {
+        bool tryNative = jitEnabled;
+        ScriptLoop* scriptLoop = (jitEnabled && !activeFunction) ? &scriptLoops[node] : nullptr;
+        while (isTruthy(evaluate(node->condition))) {
+            Completion completion = execute(node->body);
+            if (completion == Completion::BREAK) break;
+            if (completion == Completion::RETURN) return completion;
+            
+            // Back-edge: a hot loop finishes in native code (inside a call, the whole call does).
+            // At most one attempt per loop execution.
+            if (!tryNative) continue;
+            if (scriptLoop) {
+                if (++scriptLoop->hotness < Jit::HOT_THRESHOLD) continue;
+                tryNative = false;
+                if (runCompiledLoop(node, *scriptLoop)) break;
+            } else if (++activeFunction->hotness >= Jit::HOT_THRESHOLD) {
+                tryNative = false;
+                if (enterCompiledLoop(node)) return Completion::RETURN;
+            }
+        }
+        return Completion::NORMAL;
+    }
+    
+    void executePrintStatement(PrintStatementNode* node) {
+        RuntimeValue value = evaluate(node->expression);
+        *out << value << std::endl;
+    }
+    
+    Completion executeReturnStatement(ReturnStatementNode* node) {
+        if (node->expression) {
+            returnValue = evaluate(node->expression);
+        } else {
+            returnValue = 0.0;
+        }
+        
+        return Completion::RETURN;
+    }
+    
+    Completion executeBlock(BlockNode* node) {
+        // Block locals live in the enclosing frame (see Resolver)
+        for (const auto& statement : node->statements) {
+            Completion completion = execute(statement);
+            if (completion != Completion::NORMAL) return completion;
+        }
+        return Completion::NORMAL;
+    }
+    
+    Completion executeBlock(BlockNode* node, std::shared_ptr<Environment> env) {
+        auto previous = environment;
+        Completion completion;
+        
+        try {
+            environment = std::move(env);
+            completion = executeBlock(node);
+        } catch (...) {
+            environment = previous;
+            throw;
+        }
+        
+        environment = previous;
+        return completion;
+    }
+    
+    void executeAssignment(AssignmentNode* node) {
+        RuntimeValue value = evaluate(node->value);
+        variable(node->binding, node->variable) = std::move(value);
+    }
+    
+    RuntimeValue& variable(const VariableSlot& binding, const std::string& name) {
+        if (binding.depth == GLOBAL_DEPTH) {
+            if (!globalDefined[binding.slot]) {
+                throw std::runtime_error("Undefined variable '" + name + "'");
+            }
+            return globals->at(binding.slot);
+        }
+        return environment->at(binding.depth, binding.slot);
+    }
+    
+    RuntimeValue evaluate(ASTNode* node) {
+        if (!node) return 0.0;
+        
+        switch (node->type) {
+            case ASTNodeType::LITERAL:
+                return evaluateLiteral(static_cast<LiteralNode*>(node));
+            case ASTNodeType::IDENTIFIER:
+                return evaluateIdentifier(static_cast<IdentifierNode*>(node));
+            case ASTNodeType::BINARY_OP:
+                return evaluateBinaryOp(static_cast<BinaryOpNode*>(node));
+            case ASTNodeType::UNARY_OP:
+                return evaluateUnaryOp(static_cast<UnaryOpNode*>(node));
+            case ASTNodeType::FUNCTION_CALL:
+                return evaluateFunctionCall(static_cast<FunctionCallNode*>(node));
+            case ASTNodeType::ARRAY_LITERAL:
+                return evaluateArrayLiteral(static_cast<ArrayLiteralNode*>(node));
+            case ASTNodeType::INDEX:
+                return evaluateIndex(static_cast<IndexNode*>(node));
+            case ASTNodeType::INDEX_ASSIGNMENT:
+                return evaluateIndexAssignment(static_cast<IndexAssignmentNode*>(node));
+            case ASTNodeType::ASSIGNMENT:
+            {
+                auto assignment = static_cast<AssignmentNode*>(node);
+                executeAssignment(assignment);
+                return variable(assignment->binding, assignment->variable);
+            }
+            default:
+                throw std::runtime_error("Unknown expression type");
+        }
+    }
+    
+    RuntimeValue evaluateLiteral(LiteralNode* node) {
+        return literalValue(node);
+    }
+    
+    RuntimeValue evaluateIdentifier(IdentifierNode* node) {
+        return variable(node->binding, node->name);
+    }
+    
+    RuntimeValue evaluateBinaryOp(BinaryOpNode* node) {
+        RuntimeValue left = evaluate(node->left);
+        RuntimeValue right = evaluate(node->right);
+        
+        return applyBinaryOperator(node->operator_, std::move(left), right);
+    }
+    
+    RuntimeValue evaluateUnaryOp(UnaryOpNode* node) {
+        RuntimeValue operand = evaluate(node->operand);
+        
+        return applyUnaryOperator(node->operator_, operand);
+    }
+    
+    // Resolves the callee through the call site's inline cache. Any function definition
+    // takes a new epoch, so redefinitions invalidate every cached call site at once.
+    // Null means the call site names a built-in that no user function shadows.
+    Function* callee(FunctionCallNode* node) {
+        if (node->cacheEpoch == definitionEpoch) {
+            return node->cachedFunction;
+        }
+        
+        auto it = functions.find(node->name);
+        if (it == functions.end()) {
+            if (node->builtin == Builtin::NONE) {
+                throw std::runtime_error("Undefined function '" + node->name + "'");
+            }
+            node->cachedFunction = nullptr;
+            node->cacheEpoch = definitionEpoch;
+            return nullptr;
+        }
+        
+        const FunctionDeclarationNode* declaration = it->second.declaration;
+        if (node->arguments.size() != declaration->parameters.size()) {
+            throw std::runtime_error("Expected " + std::to_string(declaration->parameters.size()) + 
+                                   " arguments but got " + std::to_string(node->arguments.size()));
+        }
+        
+        node->cachedFunction = &it->second;
+        node->cacheEpoch = definitionEpoch;
+        return &it->second;
+    }
+    
+    RuntimeValue evaluateFunctionCall(FunctionCallNode* node) {
+        Function* function = callee(node);
+        if (!function) return callBuiltin(node);
+        
+        // Arguments are evaluated straight into the parameter slots
+        return callFunction(node->name, *function, [&](Environment& frame) {
+            for (size_t i = 0; i < node->arguments.size(); i++) {
+                frame.at(static_cast<int>(i)) = evaluate(node->arguments[i]);
+            }
+        });
+    }
+    
+    template<typename SetArguments>
+    RuntimeValue callFunction(const std::string& name, Function& function, SetArguments&& setArguments) {
+        if (jitEnabled && !function.native && !function.jitDisabled && 
+            ++function.hotness >= Jit::HOT_THRESHOLD) {
+            tierUp(name, function);
+        }
+        
+        size_t depth = callDepth++;
+        if (profiler) profiler->enterFunction(function.declaration);
+        try {
+            Environment& frame = acquireFrame(depth, function.declaration->frameSize, function.closure);
+            setArguments(frame);
+            RuntimeValue result = invoke(name, function, depth);
+            callDepth = depth;
+            releaseFrame(depth);
+            if (profiler) profiler->leaveFunction();
+            return result;
+        } catch (...) {
+            callDepth = depth;
+            if (profiler) profiler->leaveFunction();
+            throw;
+        }
+    }
+    
+    // Runs `function` on the arguments already stored in frames[depth]
+    RuntimeValue invoke(const std::string& name, Function& function, size_t depth) {
+        const FunctionDeclarationNode* declaration = function.declaration;
+        const NativeFunction* native = function.native;
+        std::shared_ptr<MemoTable> memo = declaration->pure ? function.memo : nullptr;
+        RuntimeValue* arguments = frames[depth]->data();
+        size_t arity = declaration->parameters.size();
+        
+        std::vector<RuntimeValue> key;
+        if (memo) {
+            key.assign(arguments, arguments + arity);
+            // Arrays are mutable, so results computed from them are not memoized
+            if (std::any_of(key.begin(), key.end(), [](const RuntimeValue& v) { return v.isArray(); })) {
+                memo = nullptr;
+            } else {
+                auto hit = memo->find(key);
+                if (hit != memo->end()) return hit->second;
+            }
+        }
+        
+        RuntimeValue result = 0.0; // Default return value
+        double number;
+        if (native && native->entry(arguments, &number) == NativeFunction::OK) {
+            jit.recordNativeCall();
+            if (native->returnsBoolean) {
+                result = number != 0.0;
+            } else {
+                result = number;
+            }
+        } else {
+            // Native code has no side effects, so a deoptimized call simply reruns here
+            if (native) deoptimize(name, declaration);
+            
+            Function* caller = activeFunction;
+            activeFunction = &function;
+            Completion completion;
+            try {
+                completion = executeBlock(declaration->body, frames[depth]);
+            } catch (...) {
+                activeFunction = caller;
+                throw;
+            }
+            activeFunction = caller;
+            
+            if (completion == Completion::RETURN) {
+                result = std::move(returnValue);
+            }
+        }
+        
+        if (memo) {
+            memo->emplace(std::move(key), result);
+        }
+        return result;
+    }
+    
+    RuntimeValue evaluateArrayLiteral(ArrayLiteralNode* node) {
+        std::vector<double> elements;
+        elements.reserve(node->elements.size());
+        for (ASTNode* element : node->elements) {
+            elements.push_back(arrayElement(evaluate(element)));
+        }
+        return elements;
+    }
+    
+    RuntimeValue evaluateIndex(IndexNode* node) {
+        RuntimeValue array = evaluate(node->array);
+        RuntimeValue index = evaluate(node->index);
+        size_t position = arrayIndex(array, index); // Checks the type before asArray() reads the payload
+        return array.asArray()[position];
+    }
+    
+    RuntimeValue evaluateIndexAssignment(IndexAssignmentNode* node) {
+        RuntimeValue array = evaluate(node->array);
+        RuntimeValue index = evaluate(node->index);
+        double value = arrayElement(evaluate(node->value));
+        size_t position = arrayIndex(array, index);
+        array.asArray()[position] = value;
+        return value;
+    }
+    
+    void checkArity(FunctionCallNode* node, size_t min, size_t max) {
+        size_t count = node->arguments.size();
+        if (count < min || count > max) {
+            throw std::runtime_error("Expected " + std::to_string(count < min ? min : max) + 
+                                   " arguments but got " + std::to_string(count));
+        }
     }
     
-    void executeFunctionDeclaration(FunctionDeclarationNode* node) {
-        Function function(node->name, node->parameters, 
-                         std::unique_ptr<BlockNode>(dynamic_cast<BlockNode*>(node->body.release())), 
-                         environment);
-        functions[node->name] = std::move(function);
+    RuntimeValue arrayArgument(FunctionCallNode* node, size_t i) {
+        RuntimeValue value = evaluate(node->arguments[i]);
+        if (!value.isArray()) {
+            throw std::runtime_error(node->name + "() expects an array");
+        }
+        return value;
+    }
+    
+    // Built-ins work on the unboxed elements directly; only map() re-enters the interpreter
+    RuntimeValue callBuiltin(FunctionCallNode* node) {
+        switch (node->builtin) {
+            case Builtin::ARRAY: {
+                checkArity(node, 1, 2);
+                RuntimeValue size = evaluate(node->arguments[0]);
+                if (!size.isNumber() || !(size.asNumber() >= 0.0) || size.asNumber() != std::floor(size.asNumber())) {
+                    throw std::runtime_error("array() expects a non-negative integer size");
+                }
+                double fill = node->arguments.size() == 2 ? arrayElement(evaluate(node->arguments[1])) : 0.0;
+                return std::vector<double>(static_cast<size_t>(size.asNumber()), fill);
+            }
+            case Builtin::LEN: {
+                checkArity(node, 1, 1);
+                RuntimeValue value = evaluate(node->arguments[0]);
+                if (value.isArray()) return static_cast<double>(value.asArray().size());
+                if (value.isString()) return static_cast<double>(value.asString().size());
+                throw std::runtime_error("len() expects an array or a string");
+            }
+            case Builtin::PUSH: {
+                checkArity(node, 2, 2);
+                RuntimeValue array = arrayArgument(node, 0);
+                double value = arrayElement(evaluate(node->arguments[1]));
+                array.asArray().push_back(value);
+                return static_cast<double>(array.asArray().size());
+            }
+            case Builtin::SUM: {
+                checkArity(node, 1, 1);
+                RuntimeValue array = arrayArgument(node, 0);
+                const std::vector<double>& a = array.asArray();
+                // Independent partial sums keep several additions in flight
+                double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+                size_t i = 0;
+                for (; i + 4 <= a.size(); i += 4) {
+                    s0 += a[i];
+                    s1 += a[i + 1];
+                    s2 += a[i + 2];
+                    s3 += a[i + 3];
+                }
+                for (; i < a.size(); i++) s0 += a[i];
+                return (s0 + s1) + (s2 + s3);
+            }
+            case Builtin::DOT: {
+                checkArity(node, 2, 2);
+                RuntimeValue left = arrayArgument(node, 0);
+                RuntimeValue right = arrayArgument(node, 1);
+                const std::vector<double>& a = left.asArray();
+                const std::vector<double>& b = right.asArray();
+                if (a.size() != b.size()) {
+                    throw std::runtime_error("dot() expects arrays of equal length");
+                }
+                double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+                size_t i = 0;
+                for (; i + 4 <= a.size(); i += 4) {
+                    s0 += a[i] * b[i];
+                    s1 += a[i + 1] * b[i + 1];
+                    s2 += a[i + 2] * b[i + 2];
+                    s3 += a[i + 3] * b[i + 3];
+                }
+                for (; i < a.size(); i++) s0 += a[i] * b[i];
+                return (s0 + s1) + (s2 + s3);
+            }
+            case Builtin::MAP:
+                checkArity(node, 2, 2);
+                return mapArray(node);
+            case Builtin::NONE:
+                break;
+        }
+        throw std::runtime_error("Undefined function '" + node->name + "'");
     }
     
-    void executeIfStatement(IfStatementNode* node) {
-        RuntimeValue condition = evaluate(node->condition.get());
+    // map(array, f): f is named, not evaluated; compiled functions run natively per element
+    RuntimeValue mapArray(FunctionCallNode* node) {
+        RuntimeValue source = arrayArgument(node, 0);
+        if (node->arguments[1]->type != ASTNodeType::IDENTIFIER) {
+            throw std::runtime_error("map() expects a function name");
+        }
+        const std::string& name = static_cast<IdentifierNode*>(node->arguments[1])->name;
+        auto it = functions.find(name);
+        if (it == functions.end()) {
+            throw std::runtime_error("Undefined function '" + name + "'");
+        }
+        Function& function = it->second;
+        if (function.declaration->parameters.size() != 1) {
+            throw std::runtime_error("map() expects a function of one parameter");
+        }
         
-        if (isTruthy(condition)) {
-            execute(node->thenBranch.get());
-        } else if (node->elseBranch) {
-            execute(node->elseBranch.get());
+        // The function may push to the source array; only the original elements are mapped
+        size_t count = source.asArray().size();
+        std::vector<double> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count && i < source.asArray().size(); i++) {
+            double element = source.asArray()[i];
+            RuntimeValue mapped = callFunction(name, function, [element](Environment& frame) {
+                frame.at(0) = element;
+            });
+            result.push_back(arrayElement(mapped));
         }
+        return result;
     }
     
-    void executeWhileStatement(WhileStatementNode* node) {
-        while (isTruthy(evaluate(node->condition.get()))) {
-            execute(node->body.get());
+    // Call frames are reused per call depth unless a closure captured them
+    Environment& acquireFrame(size_t depth, int frameSize, const std::shared_ptr<Environment>& closure) {
+        if (depth == frames.size()) frames.emplace_back();
+        
+        std::shared_ptr<Environment>& frame = frames[depth];
+        if (frame && frame.use_count() == 1) {
+            frame->reset(frameSize, closure);
+        } else {
+            frame = std::make_shared<Environment>(frameSize, closure);
         }
+        return *frame;
     }
     
-    void executePrintStatement(PrintStatementNode* node) {
-        RuntimeValue value = evaluate(node->expression.get());
-        std::cout << valueToString(value) << std::endl;
+    void releaseFrame(size_t depth) {
+        std::shared_ptr<Environment>& frame = frames[depth];
+        if (frame.use_count() == 1) {
+            frame->clear(); // Drop argument and local values now rather than at the next reuse
+        } else {
+            frame.reset();
+        }
     }
     
-    void executeReturnStatement(ReturnStatementNode* node) {
-        RuntimeValue value = 0.0;
-        
-        if (node->expression) {
-            value = evaluate(node->expression.get());
+    // Declarations that native call sites may bind to
+    Jit::Resolve compilableCallees() {
+        return [this](const std::string& callee) {
+            auto it = functions.find(callee);
+            if (it == functions.end() || it->second.jitDisabled) return static_cast<const FunctionDeclarationNode*>(nullptr);
+            return it->second.declaration;
+        };
+    }
+    
+    void tierUp(const std::string& name, Function& function) {
+        function.native = jit.compile(function.declaration, compilableCallees());
+        if (!function.native) function.jitDisabled = true;
+        jit.bind(name, function.declaration, function.native);
+    }
+    
+    // On-stack replacement at the back-edge of `loop` in the running call; on success the
+    // call's result is in returnValue
+    bool enterCompiledLoop(const WhileStatementNode* loop) {
+        Function& function = *activeFunction;
+        if (!function.native) {
+            if (function.jitDisabled) return false;
+            tierUp(function.declaration->name, function);
+            if (!function.native) return false;
         }
         
-        throw ReturnException(value);
+        // Misses when the name was rebound to another declaration during this call
+        auto entry = function.native->loopEntries.find(loop);
+        if (entry == function.native->loopEntries.end()) return false;
+        
+        double number;
+        if (entry->second(environment->data(), &number) != NativeFunction::OK) {
+            deoptimize(function.declaration->name, function.declaration);
+            return false;
+        }
+        jit.recordNativeCall();
+        if (function.native->returnsBoolean) {
+            returnValue = number != 0.0;
+        } else {
+            returnValue = number;
+        }
+        return true;
     }
     
-    void executeBlock(BlockNode* node) {
-        executeBlock(node, std::make_shared<Environment>(environment));
+    // Runs the rest of a hot script-level loop natively on copies of its variables; they are
+    // written back only if the native code finishes the loop
+    bool runCompiledLoop(WhileStatementNode* loop, ScriptLoop& state) {
+        if (state.jitDisabled) return false;
+        if (!state.native) {
+            state.native = jit.compileLoop(loop, compilableCallees());
+            if (!state.native) {
+                state.jitDisabled = true;
+                return false;
+            }
+        }
+        
+        const auto& variables = state.native->loopVariables;
+        std::vector<double> values(variables.size() + 1);
+        for (size_t i = 0; i < variables.size(); i++) {
+            const RuntimeValue& value = globals->at(variables[i].slot);
+            if ((variables[i].named && !globalDefined[variables[i].slot]) || !value.isNumber()) return false;
+            values[i + 1] = value.asNumber();
+        }
+        
+        if (state.native->loopEntry(values.data()) != NativeFunction::OK) {
+            jit.recordDeoptimization();
+            if (++state.deoptimizations >= Jit::MAX_DEOPTIMIZATIONS) state.jitDisabled = true;
+            return false;
+        }
+        jit.recordNativeCall();
+        for (size_t i = 0; i < variables.size(); i++) {
+            globals->at(variables[i].slot) = values[i + 1];
+        }
+        return true;
     }
     
-    void executeBlock(BlockNode* node, std::shared_ptr<Environment> env) {
-        auto previous = environment;
+    // A guard failed; functions that keep failing go back to the interpreter for good
+    void deoptimize(const std::string& name, const FunctionDeclarationNode* declaration) {
+        jit.recordDeoptimization();
+        auto it = functions.find(name);
+        if (it == functions.end() || it->second.declaration != declaration) return;
         
-        try {
-            environment = env;
+        Function& function = it->second;
+        if (++function.deoptimizations >= Jit::MAX_DEOPTIMIZATIONS) {
+            function.native = nullptr;
+            function.jitDisabled = true;
+            jit.bind(name, declaration, nullptr);
+        }
+    }
+};
+
+// Bytecode instruction set (X-macro keeps the enum, names and dispatch table in sync)
+#define MINILANG_OPCODES(X) \
+    X(CONSTANT)         /* u16 constant index */ \
+    X(POP)                                        \
+    X(GET_LOCAL)        /* u16 slot */           \
+    X(SET_LOCAL)        /* u16 slot, keeps value */ \
+    X(STORE_LOCAL)      /* u16 slot, pops value */ \
+    X(DEFINE_GLOBAL)    /* u16 global index */   \
+    X(GET_GLOBAL)       /* u16 global index */   \
+    X(SET_GLOBAL)       /* u16 global index, keeps value */ \
+    X(STORE_GLOBAL)     /* u16 global index, pops value */ \
+    X(ADD)                                        \
+    X(SUBTRACT)                                   \
+    X(MULTIPLY)                                   \
+    X(DIVIDE)                                     \
+    X(MODULO)                                     \
+    X(GREATER)                                    \
+    X(GREATER_EQUAL)                              \
+    X(LESS)                                       \
+    X(LESS_EQUAL)                                 \
+    X(EQUAL)                                      \
+    X(NOT_EQUAL)                                  \
+    X(AND)                                        \
+    X(OR)                                         \
+    X(NEGATE)                                     \
+    X(NOT)                                        \
+    X(PRINT)                                      \
+    X(JUMP)             /* u16 forward offset */ \
+    X(JUMP_IF_FALSE)    /* u16 forward offset, pops condition */ \
+    X(LOOP)             /* u16 backward offset */ \
+    X(DEFINE_FUNCTION)  /* u16 function name index, u16 function index */ \
+    X(CALL)             /* u16 function name index, u8 argument count */ \
+    X(RETURN)
+
+enum class OpCode : uint8_t {
+#define MINILANG_OPCODE_ENUM(name) name,
+    MINILANG_OPCODES(MINILANG_OPCODE_ENUM)
+#undef MINILANG_OPCODE_ENUM
+};
+
+inline const char* opCodeName(OpCode op) {
+    static const char* names[] = {
+#define MINILANG_OPCODE_NAME(name) #name,
+        MINILANG_OPCODES(MINILANG_OPCODE_NAME)
+#undef MINILANG_OPCODE_NAME
+    };
+    return names[static_cast<uint8_t>(op)];
+}
+
+// Compiled code and constant pool of a single function
+class Chunk {
+public:
+    std::vector<uint8_t> code;
+    std::vector<RuntimeValue> constants;
+    
+    void write(uint8_t byte) { code.push_back(byte); }
+    void write(OpCode op) { code.push_back(static_cast<uint8_t>(op)); }
+    
+    void writeShort(uint16_t value) {
+        code.push_back(static_cast<uint8_t>(value >> 8));
+        code.push_back(static_cast<uint8_t>(value & 0xff));
+    }
+    
+    uint16_t readShort(size_t offset) const {
+        return static_cast<uint16_t>((code[offset] << 8) | code[offset + 1]);
+    }
+};
+
+class CompiledFunction {
+public:
+    std::string name;
+    int arity;
+    int localCount;
+    bool pure = false;
+    Chunk chunk;
+    
+    CompiledFunction(const std::string& n, int a) : name(n), arity(a), localCount(a) {}
+};
+
+// Output of the code generator; functions[0] is the top-level script
+class BytecodeProgram {
+public:
+    std::vector<CompiledFunction> functions;
+    std::vector<std::string> globalNames;
+    std::vector<std::string> functionNames;
+    
+    void disassemble(std::ostream& out) const {
+        for (const auto& function : functions) {
+            out << "== " << function.name << " (arity " << function.arity 
+                << ", locals " << function.localCount << ") ==" << std::endl;
             
-            for (const auto& statement : node->statements) {
-                execute(statement.get());
+            const Chunk& chunk = function.chunk;
+            size_t offset = 0;
+            while (offset < chunk.code.size()) {
+                OpCode op = static_cast<OpCode>(chunk.code[offset]);
+                out << std::setw(4) << std::setfill('0') << offset << std::setfill(' ') 
+                    << "  " << std::left << std::setw(16) << opCodeName(op) << std::right;
+                
+                switch (op) {
+                    case OpCode::CONSTANT: {
+                        uint16_t index = chunk.readShort(offset + 1);
+                        out << index << " '" << valueToString(chunk.constants[index]) << "'";
+                        offset += 3;
+                        break;
+                    }
+                    case OpCode::GET_LOCAL:
+                    case OpCode::SET_LOCAL:
+                    case OpCode::STORE_LOCAL:
+                        out << "slot " << chunk.readShort(offset + 1);
+                        offset += 3;
+                        break;
+                    case OpCode::DEFINE_GLOBAL:
+                    case OpCode::GET_GLOBAL:
+                    case OpCode::SET_GLOBAL:
+                    case OpCode::STORE_GLOBAL:
+                        out << globalNames[chunk.readShort(offset + 1)];
+                        offset += 3;
+                        break;
+                    case OpCode::JUMP:
+                    case OpCode::JUMP_IF_FALSE:
+                        out << "-> " << offset + 3 + chunk.readShort(offset + 1);
+                        offset += 3;
+                        break;
+                    case OpCode::LOOP:
+                        out << "-> " << offset + 3 - chunk.readShort(offset + 1);
+                        offset += 3;
+                        break;
+                    case OpCode::DEFINE_FUNCTION:
+                        out << functionNames[chunk.readShort(offset + 1)] 
+                            << " #" << chunk.readShort(offset + 3);
+                        offset += 5;
+                        break;
+                    case OpCode::CALL:
+                        out << functionNames[chunk.readShort(offset + 1)] 
+                            << " (" << static_cast<int>(chunk.code[offset + 3]) << " args)";
+                        offset += 4;
+                        break;
+                    default:
+                        offset += 1;
+                        break;
+                }
+                out << std::endl;
             }
-        } catch (...) {
-            environment = previous;
-            throw;
         }
-        
-        environment = previous;
     }
+};
+
+// Compile exception (unsupported construct or limits exceeded)
+class CompileException : public std::exception {
+private:
+    std::string message;
     
-    void executeAssignment(AssignmentNode* node) {
-        RuntimeValue value = evaluate(node->value.get());
-        environment->assign(node->variable, value);
+public:
+    CompileException(const std::string& msg) : message(msg) {}
+    
+    const char* what() const noexcept override {
+        return message.c_str();
     }
+};
+
+// Code generator: compiles the AST into stack-machine bytecode with resolved local slots
+class CodeGenerator {
+private:
+    struct Local {
+        std::string name;
+        int depth;
+        uint16_t slot;
+    };
+    
+    struct FunctionState {
+        size_t functionIndex;
+        std::vector<Local> locals;
+        int scopeDepth;
+    };
+    
+    std::shared_ptr<BytecodeProgram> program;
+    std::vector<FunctionState> states;
+    std::unordered_map<std::string, uint16_t> globalIndices;
+    std::unordered_map<std::string, uint16_t> functionIndices;
+    std::vector<std::map<RuntimeValue, uint16_t>> constantIndices;
+    std::unordered_set<std::string> declaredFunctions; // Names that shadow built-ins
     
-    RuntimeValue evaluate(ASTNode* node) {
-        if (!node) return 0.0;
+public:
+    std::shared_ptr<BytecodeProgram> generate(const ProgramNode& root) {
+        program = std::make_shared<BytecodeProgram>();
+        states.clear();
+        globalIndices.clear();
+        functionIndices.clear();
+        constantIndices.clear();
+        declaredFunctions.clear();
+        for (const auto& statement : root.statements) {
+            collectFunctions(statement);
+        }
+        
+        beginFunction("<script>", {}, 0);
+        for (const auto& statement : root.statements) {
+            compileStatement(statement);
+        }
+        endFunction();
+        
+        return program;
+    }
+    
+private:
+    void collectFunctions(const ASTNode* node) {
+        if (!node) return;
         
         switch (node->type) {
-            case ASTNodeType::LITERAL:
-                return evaluateLiteral(dynamic_cast<LiteralNode*>(node));
-            case ASTNodeType::IDENTIFIER:
-                return evaluateIdentifier(dynamic_cast<IdentifierNode*>(node));
-            case ASTNodeType::BINARY_OP:
-                return evaluateBinaryOp(dynamic_cast<BinaryOpNode*>(node));
-            case ASTNodeType::UNARY_OP:
-                return evaluateUnaryOp(dynamic_cast<UnaryOpNode*>(node));
-            case ASTNodeType::FUNCTION_CALL:
-                return evaluateFunctionCall(dynamic_cast<FunctionCallNode*>(node));
-            case ASTNodeType::ASSIGNMENT:
-                executeAssignment(dynamic_cast<AssignmentNode*>(node));
-                return environment->get(dynamic_cast<AssignmentNode*>(node)->variable);
+            case ASTNodeType::FUNCTION_DECLARATION: {
+                auto decl = static_cast<const FunctionDeclarationNode*>(node);
+                declaredFunctions.insert(decl->name);
+                collectFunctions(decl->body);
+                break;
+            }
+            case ASTNodeType::BLOCK:
+                for (const auto& statement : static_cast<const BlockNode*>(node)->statements) {
+                    collectFunctions(statement);
+                }
+                break;
+            case ASTNodeType::IF_STATEMENT:
+                collectFunctions(static_cast<const IfStatementNode*>(node)->thenBranch);
+                collectFunctions(static_cast<const IfStatementNode*>(node)->elseBranch);
+                break;
+            case ASTNodeType::WHILE_STATEMENT:
+                collectFunctions(static_cast<const WhileStatementNode*>(node)->body);
+                break;
             default:
-                throw std::runtime_error("Unknown expression type");
+                break;
         }
     }
     
-    RuntimeValue evaluateLiteral(LiteralNode* node) {
-        return node->value;
+    Chunk& chunk() {
+        return program->functions[states.back().functionIndex].chunk;
     }
     
-    RuntimeValue evaluateIdentifier(IdentifierNode* node) {
-        return environment->get(node->name);
+    FunctionState& state() {
+        return states.back();
     }
     
-    RuntimeValue evaluateBinaryOp(BinaryOpNode* node) {
-        RuntimeValue left = evaluate(node->left.get());
-        RuntimeValue right = evaluate(node->right.get());
+    void beginFunction(const std::string& name, ArenaArray<const std::string*> parameters, int scopeDepth) {
+        program->functions.emplace_back(name, static_cast<int>(parameters.size()));
+        constantIndices.emplace_back();
+        states.push_back({program->functions.size() - 1, {}, scopeDepth});
         
-        switch (node->operator_) {
-            case TokenType::PLUS:
-                if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-                    return std::get<double>(left) + std::get<double>(right);
+        for (const std::string* parameter : parameters) {
+            declareLocal(*parameter);
+        }
+    }
+    
+    void endFunction() {
+        emitConstant(0.0);
+        emit(OpCode::RETURN);
+        states.pop_back();
+    }
+    
+    void beginScope() {
+        state().scopeDepth++;
+    }
+    
+    void endScope() {
+        FunctionState& current = state();
+        current.scopeDepth--;
+        while (!current.locals.empty() && current.locals.back().depth > current.scopeDepth) {
+            current.locals.pop_back();
+        }
+    }
+    
+    bool isGlobalScope() {
+        return states.size() == 1 && state().scopeDepth == 0;
+    }
+    
+    uint16_t declareLocal(const std::string& name) {
+        FunctionState& current = state();
+        
+        // Redeclaring a name in the same scope reuses its slot
+        for (auto it = current.locals.rbegin(); it != current.locals.rend() && it->depth == current.scopeDepth; ++it) {
+            if (it->name == name) return it->slot;
+        }
+        
+        uint16_t slot = current.locals.empty() ? 0 : current.locals.back().slot + 1;
+        if (slot == UINT16_MAX) {
+            throw CompileException("Too many local variables in function");
+        }
+        current.locals.push_back({name, current.scopeDepth, slot});
+        
+        CompiledFunction& function = program->functions[current.functionIndex];
+        function.localCount = std::max(function.localCount, static_cast<int>(slot) + 1);
+        return slot;
+    }
+    
+    int resolveLocal(const std::string& name) {
+        const FunctionState& current = state();
+        for (auto it = current.locals.rbegin(); it != current.locals.rend(); ++it) {
+            if (it->name == name) return it->slot;
+        }
+        
+        // Locals of enclosing functions would need closures
+        for (size_t i = states.size() - 1; i-- > 0;) {
+            for (const auto& local : states[i].locals) {
+                if (local.name == name) {
+                    throw CompileException("Function captures local variable '" + name + 
+                                           "' of an enclosing scope (closures are not supported)");
+                }
+            }
+        }
+        
+        return -1;
+    }
+    
+    uint16_t globalIndex(const std::string& name) {
+        return internName(name, globalIndices, program->globalNames);
+    }
+    
+    uint16_t functionIndex(const std::string& name) {
+        return internName(name, functionIndices, program->functionNames);
+    }
+    
+    uint16_t internName(const std::string& name, std::unordered_map<std::string, uint16_t>& indices,
+                        std::vector<std::string>& names) {
+        auto it = indices.find(name);
+        if (it != indices.end()) return it->second;
+        
+        if (names.size() >= UINT16_MAX) {
+            throw CompileException("Too many names in program");
+        }
+        uint16_t index = static_cast<uint16_t>(names.size());
+        names.push_back(name);
+        indices[name] = index;
+        return index;
+    }
+    
+    void emit(OpCode op) {
+        chunk().write(op);
+    }
+    
+    void emit(OpCode op, uint16_t operand) {
+        chunk().write(op);
+        chunk().writeShort(operand);
+    }
+    
+    void emitConstant(const RuntimeValue& value) {
+        auto& indices = constantIndices[state().functionIndex];
+        auto it = indices.find(value);
+        if (it != indices.end()) {
+            emit(OpCode::CONSTANT, it->second);
+            return;
+        }
+        
+        Chunk& current = chunk();
+        if (current.constants.size() >= UINT16_MAX) {
+            throw CompileException("Too many constants in one function");
+        }
+        uint16_t index = static_cast<uint16_t>(current.constants.size());
+        current.constants.push_back(value);
+        indices[value] = index;
+        emit(OpCode::CONSTANT, index);
+    }
+    
+    size_t emitJump(OpCode op) {
+        emit(op, 0xffff);
+        return chunk().code.size() - 2;
+    }
+    
+    void patchJump(size_t operandOffset) {
+        size_t jump = chunk().code.size() - operandOffset - 2;
+        if (jump > UINT16_MAX) {
+            throw CompileException("Too much code to jump over");
+        }
+        chunk().code[operandOffset] = static_cast<uint8_t>(jump >> 8);
+        chunk().code[operandOffset + 1] = static_cast<uint8_t>(jump & 0xff);
+    }
+    
+    void emitLoop(size_t loopStart) {
+        size_t offset = chunk().code.size() + 3 - loopStart;
+        if (offset > UINT16_MAX) {
+            throw CompileException("Loop body too large");
+        }
+        emit(OpCode::LOOP, static_cast<uint16_t>(offset));
+    }
+    
+    void emitStore(const std::string& name, bool keepValue) {
+        int slot = resolveLocal(name);
+        if (slot >= 0) {
+            emit(keepValue ? OpCode::SET_LOCAL : OpCode::STORE_LOCAL, static_cast<uint16_t>(slot));
+        } else {
+            emit(keepValue ? OpCode::SET_GLOBAL : OpCode::STORE_GLOBAL, globalIndex(name));
+        }
+    }
+    
+    void compileStatement(ASTNode* node) {
+        if (!node) return;
+        
+        switch (node->type) {
+            case ASTNodeType::VARIABLE_DECLARATION: {
+                auto decl = static_cast<VariableDeclarationNode*>(node);
+                if (decl->initializer) {
+                    compileExpression(decl->initializer);
+                } else {
+                    emitConstant(0.0);
                 }
-                if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                    return valueToString(left) + valueToString(right);
+                
+                if (isGlobalScope()) {
+                    emit(OpCode::DEFINE_GLOBAL, globalIndex(decl->name));
+                } else {
+                    emit(OpCode::STORE_LOCAL, declareLocal(decl->name));
                 }
                 break;
-            case TokenType::MINUS:
-                checkNumberOperands(left, right);
-                return std::get<double>(left) - std::get<double>(right);
-            case TokenType::MULTIPLY:
-                checkNumberOperands(left, right);
-                return std::get<double>(left) * std::get<double>(right);
-            case TokenType::DIVIDE:
-                checkNumberOperands(left, right);
-                if (std::get<double>(right) == 0) {
-                    throw std::runtime_error("Division by zero");
+            }
+            case ASTNodeType::FUNCTION_DECLARATION: {
+                auto decl = static_cast<FunctionDeclarationNode*>(node);
+                uint16_t nameIndex = functionIndex(decl->name);
+                
+                beginFunction(decl->name, decl->parameters, 1);
+                program->functions[states.back().functionIndex].pure = decl->pure;
+                // The body shares the parameter scope, like Interpreter::evaluateFunctionCall
+                for (const auto& statement : decl->body->statements) {
+                    compileStatement(statement);
                 }
-                return std::get<double>(left) / std::get<double>(right);
-            case TokenType::MODULO:
-                checkNumberOperands(left, right);
-                return fmod(std::get<double>(left), std::get<double>(right));
-            case TokenType::GREATER:
-                checkNumberOperands(left, right);
-                return std::get<double>(left) > std::get<double>(right);
-            case TokenType::GREATER_EQUAL:
-                checkNumberOperands(left, right);
-                return std::get<double>(left) >= std::get<double>(right);
-            case TokenType::LESS:
-                checkNumberOperands(left, right);
-                return std::get<double>(left) < std::get<double>(right);
-            case TokenType::LESS_EQUAL:
-                checkNumberOperands(left, right);
-                return std::get<double>(left) <= std::get<double>(right);
-            case TokenType::EQUAL:
-                return isEqual(left, right);
-            case TokenType::NOT_EQUAL:
-                return !isEqual(left, right);
-            case TokenType::AND:
-                if (!isTruthy(left)) return left;
-                return right;
-            case TokenType::OR:
-                if (isTruthy(left)) return left;
-                return right;
+                size_t index = states.back().functionIndex;
+                endFunction();
+                
+                emit(OpCode::DEFINE_FUNCTION, nameIndex);
+                chunk().writeShort(static_cast<uint16_t>(index));
+                break;
+            }
+            case ASTNodeType::IF_STATEMENT: {
+                auto ifNode = static_cast<IfStatementNode*>(node);
+                compileExpression(ifNode->condition);
+                size_t elseJump = emitJump(OpCode::JUMP_IF_FALSE);
+                compileStatement(ifNode->thenBranch);
+                
+                if (ifNode->elseBranch) {
+                    size_t endJump = emitJump(OpCode::JUMP);
+                    patchJump(elseJump);
+                    compileStatement(ifNode->elseBranch);
+                    patchJump(endJump);
+                } else {
+                    patchJump(elseJump);
+                }
+                break;
+            }
+            case ASTNodeType::WHILE_STATEMENT: {
+                auto whileNode = static_cast<WhileStatementNode*>(node);
+                size_t loopStart = chunk().code.size();
+                compileExpression(whileNode->condition);
+                size_t exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+                compileStatement(whileNode->body);
+                emitLoop(loopStart);
+                patchJump(exitJump);
+                break;
+            }
+            case ASTNodeType::PRINT_STATEMENT:
+                compileExpression(static_cast<PrintStatementNode*>(node)->expression);
+                emit(OpCode::PRINT);
+                break;
+            case ASTNodeType::RETURN_STATEMENT: {
+                auto returnNode = static_cast<ReturnStatementNode*>(node);
+                if (returnNode->expression) {
+                    compileExpression(returnNode->expression);
+                } else {
+                    emitConstant(0.0);
+                }
+                emit(OpCode::RETURN);
+                break;
+            }
+            case ASTNodeType::BLOCK:
+                beginScope();
+                for (const auto& statement : static_cast<BlockNode*>(node)->statements) {
+                    compileStatement(statement);
+                }
+                endScope();
+                break;
+            case ASTNodeType::ASSIGNMENT: {
+                auto assignment = static_cast<AssignmentNode*>(node);
+                compileExpression(assignment->value);
+                emitStore(assignment->variable, false);
+                break;
+            }
             default:
+                // Expression statement
+                compileExpression(node);
+                emit(OpCode::POP);
                 break;
         }
+    }
+    
+    void compileExpression(ASTNode* node) {
+        if (!node) {
+            emitConstant(0.0);
+            return;
+        }
         
-        throw std::runtime_error("Unknown binary operator");
+        switch (node->type) {
+            case ASTNodeType::LITERAL:
+                emitConstant(literalValue(static_cast<LiteralNode*>(node)));
+                break;
+            case ASTNodeType::IDENTIFIER: {
+                const std::string& name = static_cast<IdentifierNode*>(node)->name;
+                int slot = resolveLocal(name);
+                if (slot >= 0) {
+                    emit(OpCode::GET_LOCAL, static_cast<uint16_t>(slot));
+                } else {
+                    emit(OpCode::GET_GLOBAL, globalIndex(name));
+                }
+                break;
+            }
+            case ASTNodeType::BINARY_OP: {
+                auto binary = static_cast<BinaryOpNode*>(node);
+                compileExpression(binary->left);
+                compileExpression(binary->right);
+                emit(binaryOpCode(binary->operator_));
+                break;
+            }
+            case ASTNodeType::UNARY_OP: {
+                auto unary = static_cast<UnaryOpNode*>(node);
+                compileExpression(unary->operand);
+                if (unary->operator_ == TokenType::MINUS) {
+                    emit(OpCode::NEGATE);
+                } else if (unary->operator_ == TokenType::NOT) {
+                    emit(OpCode::NOT);
+                } else {
+                    throw CompileException("Unknown unary operator");
+                }
+                break;
+            }
+            case ASTNodeType::FUNCTION_CALL: {
+                auto call = static_cast<FunctionCallNode*>(node);
+                if (call->builtin != Builtin::NONE && !declaredFunctions.count(call->name)) {
+                    throw CompileException("Built-in '" + call->name + "' is not supported by the bytecode VM");
+                }
+                if (call->arguments.size() > UINT8_MAX) {
+                    throw CompileException("Too many arguments in call to '" + call->name + "'");
+                }
+                for (const auto& argument : call->arguments) {
+                    compileExpression(argument);
+                }
+                emit(OpCode::CALL, functionIndex(call->name));
+                chunk().write(static_cast<uint8_t>(call->arguments.size()));
+                break;
+            }
+            case ASTNodeType::ASSIGNMENT: {
+                auto assignment = static_cast<AssignmentNode*>(node);
+                compileExpression(assignment->value);
+                emitStore(assignment->variable, true);
+                break;
+            }
+            case ASTNodeType::ARRAY_LITERAL:
+            case ASTNodeType::INDEX:
+            case ASTNodeType::INDEX_ASSIGNMENT:
+                throw CompileException("Arrays are not supported by the bytecode VM");
+            default:
+                throw CompileException("Unknown expression type");
+        }
+    }
+    
+    static OpCode binaryOpCode(TokenType op) {
+        switch (op) {
+            case TokenType::PLUS: return OpCode::ADD;
+            case TokenType::MINUS: return OpCode::SUBTRACT;
+            case TokenType::MULTIPLY: return OpCode::MULTIPLY;
+            case TokenType::DIVIDE: return OpCode::DIVIDE;
+            case TokenType::MODULO: return OpCode::MODULO;
+            case TokenType::GREATER: return OpCode::GREATER;
+            case TokenType::GREATER_EQUAL: return OpCode::GREATER_EQUAL;
+            case TokenType::LESS: return OpCode::LESS;
+            case TokenType::LESS_EQUAL: return OpCode::LESS_EQUAL;
+            case TokenType::EQUAL: return OpCode::EQUAL;
+            case TokenType::NOT_EQUAL: return OpCode::NOT_EQUAL;
+            case TokenType::AND: return OpCode::AND;
+            case TokenType::OR: return OpCode::OR;
+            default:
+                throw CompileException("Unknown binary operator");
+        }
+    }
+};
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MINILANG_COMPUTED_GOTO 1
+#endif
+
+// Stack-based virtual machine executing BytecodeProgram
+class VirtualMachine {
+private:
+    struct CallFrame {
+        const CompiledFunction* function;
+        const uint8_t* ip;
+        size_t base;
+        bool memoize = false; // Pure call whose key is on memoKeys
+    };
+    
+    static constexpr size_t STACK_MAX = 1 << 16;
+    static constexpr size_t FRAMES_MAX = 4096;
+    
+    std::vector<RuntimeValue> stack;
+    std::vector<CallFrame> frames;
+    std::vector<RuntimeValue> globals;
+    std::vector<bool> globalDefined;
+    std::vector<int> functionTable;
+    std::vector<MemoTable> memoTables;               // Per compiled function, used when pure
+    std::vector<std::vector<RuntimeValue>> memoKeys; // Arguments of pure calls in progress
+    std::ostream* out = &std::cout;
+    std::ostream* err = &std::cerr;
+    
+public:
+    void setOutput(std::ostream& output, std::ostream& errors) {
+        out = &output;
+        err = &errors;
     }
     
-    RuntimeValue evaluateUnaryOp(UnaryOpNode* node) {
-        RuntimeValue operand = evaluate(node->operand.get());
-        
-        switch (node->operator_) {
-            case TokenType::MINUS:
-                checkNumberOperand(operand);
-                return -std::get<double>(operand);
-            case TokenType::NOT:
-                return !isTruthy(operand);
-            default:
-                break;
+    void interpret(const BytecodeProgram& program) {
+        try {
+            execute(program);
+        } catch (const std::exception& e) {
+            *err << "Runtime error: " << e.what() << std::endl;
         }
-        
-        throw std::runtime_error("Unknown unary operator");
     }
     
-    RuntimeValue evaluateFunctionCall(FunctionCallNode* node) {
-        auto it = functions.find(node->name);
-        if (it == functions.end()) {
-            throw std::runtime_error("Undefined function '" + node->name + "'");
+private:
+    // Pure call: replaces the arguments with a cached result, or remembers them for RETURN.
+    // Kept out of execute() because computed-goto dispatch skips local destructors.
+    bool memoized(size_t index, RuntimeValue*& sp, int argCount) {
+        std::vector<RuntimeValue> key(sp - argCount, sp);
+        auto hit = memoTables[index].find(key);
+        if (hit != memoTables[index].end()) {
+            sp -= argCount;
+            *sp++ = hit->second;
+            return true;
         }
+        memoKeys.push_back(std::move(key));
+        return false;
+    }
+    
+    void execute(const BytecodeProgram& program) {
+        stack.assign(STACK_MAX, RuntimeValue(0.0));
+        frames.clear();
+        frames.reserve(64);
+        globals.assign(program.globalNames.size(), RuntimeValue(0.0));
+        globalDefined.assign(program.globalNames.size(), false);
+        functionTable.assign(program.functionNames.size(), -1);
+        memoTables.assign(program.functions.size(), MemoTable());
+        memoKeys.clear();
         
-        Function& function = it->second;
+        const CompiledFunction* function = &program.functions[0];
+        const uint8_t* ip = function->chunk.code.data();
+        const RuntimeValue* constants = function->chunk.constants.data();
+        size_t base = 0;
+        RuntimeValue* sp = stack.data() + function->localCount;
+        RuntimeValue* locals = stack.data();
+        frames.push_back({function, ip, base});
         
-        if (node->arguments.size() != function.parameters.size()) {
-            throw std::runtime_error("Expected " + std::to_string(function.parameters.size()) + 
-                                   " arguments but got " + std::to_string(node->arguments.size()));
+#define VM_READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+#define VM_NUMERIC_BINARY(resultExpr, tokenType)                                   \
+        {                                                                         \
+            if (sp[-2].isNumber() && sp[-1].isNumber()) {                         \
+                double a = sp[-2].asNumber(), b = sp[-1].asNumber();              \
+                sp[-2] = (resultExpr);                                            \
+            } else {                                                              \
+                sp[-2] = applyBinaryOperator(tokenType, std::move(sp[-2]), sp[-1]); \
+            }                                                                     \
+            sp--;                                                                 \
         }
-        
-        // Create new environment for function execution
-        auto funcEnv = std::make_shared<Environment>(function.closure);
-        
-        // Bind parameters
-        for (size_t i = 0; i < function.parameters.size(); i++) {
-            RuntimeValue arg = evaluate(node->arguments[i].get());
-            funcEnv->define(function.parameters[i], arg);
+
+#ifdef MINILANG_COMPUTED_GOTO
+        static void* dispatchTable[] = {
+#define MINILANG_OPCODE_LABEL(name) &&op_##name,
+            MINILANG_OPCODES(MINILANG_OPCODE_LABEL)
+#undef MINILANG_OPCODE_LABEL
+        };
+#define VM_CASE(name) op_##name
+#define VM_DISPATCH() goto *dispatchTable[*ip++]
+        VM_DISPATCH();
+#else
+#define VM_CASE(name) case OpCode::name
+#define VM_DISPATCH() continue
+        for (;;) {
+            switch (static_cast<OpCode>(*ip++)) {
+#endif
+        VM_CASE(CONSTANT): {
+            *sp++ = constants[VM_READ_SHORT()];
+            VM_DISPATCH();
         }
-        
-        try {
-            executeBlock(function.body.get(), funcEnv);
-        } catch (const ReturnException& returnValue) {
-            return returnValue.value;
+        VM_CASE(POP): {
+            sp--;
+            VM_DISPATCH();
         }
-        
-        return 0.0; // Default return value
-    }
-    
-    bool isTruthy(const RuntimeValue& value) {
-        if (std::holds_alternative<bool>(value)) {
-            return std::get<bool>(value);
+        VM_CASE(GET_LOCAL): {
+            *sp++ = locals[VM_READ_SHORT()];
+            VM_DISPATCH();
         }
-        if (std::holds_alternative<double>(value)) {
-            return std::get<double>(value) != 0.0;
+        VM_CASE(SET_LOCAL): {
+            locals[VM_READ_SHORT()] = sp[-1];
+            VM_DISPATCH();
         }
-        if (std::holds_alternative<std::string>(value)) {
-            return !std::get<std::string>(value).empty();
+        VM_CASE(STORE_LOCAL): {
+            locals[VM_READ_SHORT()] = std::move(*--sp);
+            VM_DISPATCH();
         }
-        return false;
-    }
-    
-    bool isEqual(const RuntimeValue& a, const RuntimeValue& b) {
-        if (a.index() != b.index()) return false;
-        
-        if (std::holds_alternative<double>(a)) {
-            return std::get<double>(a) == std::get<double>(b);
+        VM_CASE(DEFINE_GLOBAL): {
+            uint16_t index = VM_READ_SHORT();
+            globals[index] = std::move(*--sp);
+            globalDefined[index] = true;
+            VM_DISPATCH();
         }
-        if (std::holds_alternative<std::string>(a)) {
-            return std::get<std::string>(a) == std::get<std::string>(b);
+        VM_CASE(GET_GLOBAL): {
+            uint16_t index = VM_READ_SHORT();
+            if (!globalDefined[index]) {
+                throw std::runtime_error("Undefined variable '" + program.globalNames[index] + "'");
+            }
+            *sp++ = globals[index];
+            VM_DISPATCH();
         }
-        if (std::holds_alternative<bool>(a)) {
-            return std::get<bool>(a) == std::get<bool>(b);
+        VM_CASE(SET_GLOBAL): {
+            uint16_t index = VM_READ_SHORT();
+            if (!globalDefined[index]) {
+                throw std::runtime_error("Undefined variable '" + program.globalNames[index] + "'");
+            }
+            globals[index] = sp[-1];
+            VM_DISPATCH();
         }
-        
-        return false;
+        VM_CASE(STORE_GLOBAL): {
+            uint16_t index = VM_READ_SHORT();
+            if (!globalDefined[index]) {
+                throw std::runtime_error("Undefined variable '" + program.globalNames[index] + "'");
+            }
+            globals[index] = std::move(*--sp);
+            VM_DISPATCH();
+        }
+        VM_CASE(ADD): {
+            VM_NUMERIC_BINARY(a + b, TokenType::PLUS)
+            VM_DISPATCH();
+        }
+        VM_CASE(SUBTRACT): {
+            VM_NUMERIC_BINARY(a - b, TokenType::MINUS)
+            VM_DISPATCH();
+        }
+        VM_CASE(MULTIPLY): {
+            VM_NUMERIC_BINARY(a * b, TokenType::MULTIPLY)
+            VM_DISPATCH();
+        }
+        VM_CASE(DIVIDE): {
+            sp[-2] = applyBinaryOperator(TokenType::DIVIDE, std::move(sp[-2]), sp[-1]);
+            sp--;
+            VM_DISPATCH();
+        }
+        VM_CASE(MODULO): {
+            VM_NUMERIC_BINARY(fmod(a, b), TokenType::MODULO)
+            VM_DISPATCH();
+        }
+        VM_CASE(GREATER): {
+            VM_NUMERIC_BINARY(a > b, TokenType::GREATER)
+            VM_DISPATCH();
+        }
+        VM_CASE(GREATER_EQUAL): {
+            VM_NUMERIC_BINARY(a >= b, TokenType::GREATER_EQUAL)
+            VM_DISPATCH();
+        }
+        VM_CASE(LESS): {
+            VM_NUMERIC_BINARY(a < b, TokenType::LESS)
+            VM_DISPATCH();
+        }
+        VM_CASE(LESS_EQUAL): {
+            VM_NUMERIC_BINARY(a <= b, TokenType::LESS_EQUAL)
+            VM_DISPATCH();
+        }
+        VM_CASE(EQUAL): {
+            sp[-2] = isEqual(sp[-2], sp[-1]);
+            sp--;
+            VM_DISPATCH();
+        }
+        VM_CASE(NOT_EQUAL): {
+            sp[-2] = !isEqual(sp[-2], sp[-1]);
+            sp--;
+            VM_DISPATCH();
+        }
+        VM_CASE(AND): {
+            if (isTruthy(sp[-2])) sp[-2] = std::move(sp[-1]);
+            sp--;
+            VM_DISPATCH();
+        }
+        VM_CASE(OR): {
+            if (!isTruthy(sp[-2])) sp[-2] = std::move(sp[-1]);
+            sp--;
+            VM_DISPATCH();
+        }
+        VM_CASE(NEGATE): {
+            sp[-1] = applyUnaryOperator(TokenType::MINUS, sp[-1]);
+            VM_DISPATCH();
+        }
+        VM_CASE(NOT): {
+            sp[-1] = !isTruthy(sp[-1]);
+            VM_DISPATCH();
+        }
+        VM_CASE(PRINT): {
+            *out << *--sp << std::endl;
+            VM_DISPATCH();
+        }
+        VM_CASE(JUMP): {
+            uint16_t offset = VM_READ_SHORT();
+            ip += offset;
+            VM_DISPATCH();
+        }
+        VM_CASE(JUMP_IF_FALSE): {
+            uint16_t offset = VM_READ_SHORT();
+            if (!isTruthy(*--sp)) ip += offset;
+            VM_DISPATCH();
+        }
+        VM_CASE(LOOP): {
+            uint16_t offset = VM_READ_SHORT();
+            ip -= offset;
+            VM_DISPATCH();
+        }
+        VM_CASE(DEFINE_FUNCTION): {
+            uint16_t nameIndex = VM_READ_SHORT();
+            uint16_t index = VM_READ_SHORT();
+            functionTable[nameIndex] = index;
+            VM_DISPATCH();
+        }
+        VM_CASE(CALL): {
+            uint16_t nameIndex = VM_READ_SHORT();
+            int argCount = *ip++;
+            
+            int index = functionTable[nameIndex];
+            if (index < 0) {
+                throw std::runtime_error("Undefined function '" + program.functionNames[nameIndex] + "'");
+            }
+            const CompiledFunction* callee = &program.functions[index];
+            if (argCount != callee->arity) {
+                throw std::runtime_error("Expected " + std::to_string(callee->arity) + 
+                                         " arguments but got " + std::to_string(argCount));
+            }
+            if (frames.size() >= FRAMES_MAX || 
+                static_cast<size_t>(sp - stack.data()) + callee->localCount + 256 >= STACK_MAX) {
+                throw std::runtime_error("Stack overflow");
+            }
+            
+            if (callee->pure && memoized(static_cast<size_t>(index), sp, argCount)) {
+                VM_DISPATCH();
+            }
+            
+            frames.back().ip = ip;
+            base = static_cast<size_t>(sp - stack.data()) - argCount;
+            frames.push_back({callee, nullptr, base, callee->pure});
+            
+            // Parameters are already in place; clear the remaining local slots
+            locals = stack.data() + base;
+            for (int slot = argCount; slot < callee->localCount; slot++) {
+                locals[slot] = 0.0;
+            }
+            sp = locals + callee->localCount;
+            function = callee;
+            ip = function->chunk.code.data();
+            constants = function->chunk.constants.data();
+            VM_DISPATCH();
+        }
+        VM_CASE(RETURN): {
+            RuntimeValue result = std::move(*--sp);
+            if (frames.back().memoize) {
+                size_t index = static_cast<size_t>(frames.back().function - program.functions.data());
+                memoTables[index].emplace(std::move(memoKeys.back()), result);
+                memoKeys.pop_back();
+            }
+            sp = stack.data() + frames.back().base;
+            frames.pop_back();
+            if (frames.empty()) return;
+            
+            *sp++ = std::move(result);
+            const CallFrame& caller = frames.back();
+            function = caller.function;
+            ip = caller.ip;
+            constants = function->chunk.constants.data();
+            base = caller.base;
+            locals = stack.data() + base;
+            VM_DISPATCH();
+        }
+#ifndef MINILANG_COMPUTED_GOTO
+            }
+        }
+#endif
+
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_NUMERIC_BINARY
+#undef VM_READ_SHORT
     }
+};
+
+// Execution back-ends selectable from MiniLanguage::run
+enum class ExecutionMode {
+    TREE_WALKING,
+    BYTECODE
+};
+
+// A parsed, optimized program plus its bytecode once generated
+struct CachedProgram {
+    std::unique_ptr<ProgramNode> ast;
+    std::shared_ptr<BytecodeProgram> bytecode;
+    std::string bytecodeError; // Set when the code generator rejected the program
+};
+
+// Programs keyed by a content hash of their source (verified against the full text),
+// so running the same script again in this process (REPL inputs, :load, repeated run()
+// calls) skips lexing, parsing, optimization and code generation. The cache lives in
+// memory only. Entries are shared: a REPL session keeps the ones it executed alive.
+class ProgramCache {
+public:
+    // How the AST was prepared; each variant is cached separately
+    enum class Variant : uint8_t {
+        UNOPTIMIZED,
+        OPTIMIZED,
+        SESSION    // Optimized without constant propagation, re-resolved on every use
+    };
     
-    void checkNumberOperand(const RuntimeValue& operand) {
-        if (!std::holds_alternative<double>(operand)) {
-            throw std::runtime_error("Operand must be a number");
+    static constexpr size_t MAX_ENTRIES = 64;
+    
+private:
+    struct Entry {
+        std::string source;
+        Variant variant;
+        std::shared_ptr<CachedProgram> program;
+    };
+    
+    std::unordered_map<uint64_t, Entry> entries;
+    std::queue<uint64_t> insertionOrder; // Oldest entries are evicted first
+    
+    static uint64_t key(std::string_view source, Variant variant) {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (char c : source) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
         }
+        return hash ^ static_cast<uint64_t>(variant);
     }
     
-    void checkNumberOperands(const RuntimeValue& left, const RuntimeValue& right) {
-        if (!std::holds_alternative<double>(left) || !std::holds_alternative<double>(right)) {
-            throw std::runtime_error("Operands must be numbers");
+public:
+    std::shared_ptr<CachedProgram> find(const std::string& source, Variant variant) const {
+        auto it = entries.find(key(source, variant));
+        if (it == entries.end() || it->second.variant != variant || it->second.source != source) {
+            return nullptr;
         }
+        return it->second.program;
     }
     
-    std::string valueToString(const RuntimeValue& value) {
-        if (std::holds_alternative<double>(value)) {
-            double d = std::get<double>(value);
-            if (d == (int)d) {
-                return std::to_string((int)d);
+    void insert(const std::string& source, Variant variant, std::shared_ptr<CachedProgram> program) {
+        uint64_t k = key(source, variant);
+        if (entries.find(k) == entries.end()) {
+            if (entries.size() >= MAX_ENTRIES) {
+                entries.erase(insertionOrder.front());
+                insertionOrder.pop();
             }
-            return std::to_string(d);
+            insertionOrder.push(k);
         }
-        if (std::holds_alternative<std::string>(value)) {
-            return std::get<std::string>(value);
-        }
-        if (std::holds_alternative<bool>(value)) {
-            return std::get<bool>(value) ? "true" : "false";
-        }
-        return "nil";
+        entries[k] = Entry{source, variant, std::move(program)};
     }
+    
+    size_t size() const { return entries.size(); }
 };
 
 // Main compiler/interpreter class
 class MiniLanguage {
 private:
-    Lexer lexer;
-    Parser parser;
-    Interpreter interpreter;
+    ExecutionMode mode;
+    bool optimize;
+    bool reportOptimizations;
+    bool jit;
+    bool dumpTokens;
+    bool dumpAst;
+    bool dumpBytecode;
+    bool profiling;
+    unsigned profileSampleHz = 0;   // 0: counters only
+    std::string collapsedStackFile; // Empty: print collapsed stacks after the flat profile
+    ProgramCache cache;
+    std::ostream* out = &std::cout; // Program output and run() reports
+    std::ostream* err = &std::cerr; // Syntax, compile and runtime errors
+    bool sectionHeaders = true;
+    
+    // REPL state: one Interpreter whose globals and functions persist across inputs
+    struct Session {
+        std::vector<std::shared_ptr<CachedProgram>> programs; // Keep function bodies alive
+        std::vector<std::string> globalNames; // Global slot layout shared by every input
+        Interpreter interpreter;
+    };
+    std::unique_ptr<Session> session;
+    
+    void optimizeProgram(ProgramNode& ast, bool propagateConstants = true) {
+        if (!optimize) return;
+        
+        Optimizer optimizer;
+        optimizer.setConstantPropagation(propagateConstants);
+        Optimizer::Stats stats = optimizer.optimize(ast);
+        if (reportOptimizations) {
+            *out << "\n=== OPTIMIZER ===" << std::endl;
+            *out << stats.summary() << std::endl;
+        }
+    }
     
 public:
-    MiniLanguage() : lexer(""), parser({}) {}
+    MiniLanguage() : mode(ExecutionMode::TREE_WALKING), optimize(true), reportOptimizations(false), 
+                     jit(Jit::available()), dumpTokens(false), dumpAst(false), dumpBytecode(false), 
+                     profiling(false) {}
+    
+    void setExecutionMode(ExecutionMode m) { mode = m; }
+    ExecutionMode getExecutionMode() const { return mode; }
+    void setOptimization(bool enabled) { optimize = enabled; }
+    void setOptimizationReport(bool enabled) { reportOptimizations = enabled; }
+    void setJit(bool enabled) { jit = enabled && Jit::available(); }
+    void setTokenDump(bool enabled) { dumpTokens = enabled; }
+    void setAstDump(bool enabled) { dumpAst = enabled; }
+    void setBytecodeDump(bool enabled) { dumpBytecode = enabled; }
+    
+    // Profiling runs on the tree-walking interpreter with the JIT off, so every statement is seen
+    void setProfiling(bool enabled) { profiling = enabled; }
+    
+    // Adds SIGPROF timing samples at `hz` to the counters; 0 turns sampling off
+    void setProfileSampling(unsigned hz) {
+        profiling = profiling || hz > 0;
+        profileSampleHz = hz;
+    }
+    
+    // Collapsed stacks come from timing samples, so this also enables sampling
+    void setCollapsedStackFile(const std::string& path) {
+        collapsedStackFile = path;
+        if (profileSampleHz == 0) setProfileSampling(DEFAULT_SAMPLE_HZ);
+    }
+    
+    static constexpr unsigned DEFAULT_SAMPLE_HZ = 1000;
+    
+    // Redirects everything run() writes, e.g. to per-script buffers in BatchRunner
+    void setOutput(std::ostream& output, std::ostream& errors) {
+        out = &output;
+        err = &errors;
+    }
+    
+    void setSectionHeaders(bool enabled) { sectionHeaders = enabled; }
     
     void runFile(const std::string& filename) {
         std::ifstream file(filename);
         if (!file.is_open()) {
-            std::cerr << "Could not open file: " << filename << std::endl;
+            *err << "Could not open file: " << filename << std::endl;
             return;
         }
         
@@ -1544,52 +5267,423 @@ public:
     }
     
     void runREPL() {
-        std::cout << "Mini Language REPL v1.0" << std::endl;
+        std::cout << "Mini Language REPL v1.1" << std::endl;
+        std::cout << "Definitions persist between inputs; ':load <file>' runs a script in this session" << std::endl;
         std::cout << "Type 'exit' to quit" << std::endl;
         
+        std::string input;
         std::string line;
         while (true) {
-            std::cout << "> ";
-            std::getline(std::cin, line);
+            std::cout << (input.empty() ? "> " : "... ");
+            if (!std::getline(std::cin, line)) break;
+            
+            if (input.empty()) {
+                if (line == "exit") break;
+                if (line.empty()) continue;
+                if (line.rfind(":load ", 0) == 0) {
+                    loadIntoSession(line.substr(6));
+                    continue;
+                }
+            }
             
-            if (line == "exit") break;
-            if (line.empty()) continue;
+            // Keep reading while braces are open, so functions can span lines
+            input += line + "\n";
+            if (openBraces(input) > 0) continue;
             
-            run(line);
+            runInSession(input);
+            input.clear();
+        }
+        
+        if (!input.empty()) {
+            runInSession(input); // Reports the unterminated input
         }
     }
     
-    void run(const std::string& source) {
+    // Runs `source` against the persistent session; only the new input is lexed and parsed
+    void runInSession(const std::string& source) {
+        if (!session) {
+            session = std::make_unique<Session>();
+            session->interpreter.setJit(jit);
+            session->interpreter.setOutput(*out, *err);
+        }
+        
         try {
-            // Lexical analysis
-            Lexer lexer(source);
-            std::vector<Token> tokens = lexer.scanTokens();
+            std::shared_ptr<CachedProgram> program = prepare(source, ProgramCache::Variant::SESSION);
+            ProgramNode& ast = *program->ast;
             
-            std::cout << "=== TOKENS ===" << std::endl;
-            for (const auto& token : tokens) {
+            // Resolve against the session's globals; existing names keep their slots
+            ast.globalNames = session->globalNames;
+            Resolver resolver;
+            resolver.resolve(ast);
+            session->globalNames = ast.globalNames;
+            
+            if (std::find(session->programs.begin(), session->programs.end(), program) == session->programs.end()) {
+                session->programs.push_back(program);
+            }
+            session->interpreter.interpret(ast);
+        } catch (const std::exception& e) {
+            *err << "Error: " << e.what() << std::endl;
+        }
+    }
+    
+    void loadIntoSession(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            *err << "Could not open file: " << filename << std::endl;
+            return;
+        }
+        
+        std::string source((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+        runInSession(source);
+    }
+    
+    void resetSession() {
+        session.reset();
+    }
+    
+private:
+    // Unbalanced '{' count, ignoring strings and // comments
+    static int openBraces(const std::string& source) {
+        int depth = 0;
+        bool inString = false;
+        for (size_t i = 0; i < source.size(); i++) {
+            char c = source[i];
+            if (inString) {
+                if (c == '"') inString = false;
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '/' && i + 1 < source.size() && source[i + 1] == '/') {
+                i = source.find('\n', i);
+                if (i == std::string::npos) break;
+            } else if (c == '{') {
+                depth++;
+            } else if (c == '}') {
+                depth--;
+            }
+        }
+        return depth;
+    }
+    
+public:
+    
+    void run(const std::string& source) {
+        run(source, mode);
+    }
+    
+    // Lexes, parses and optimizes `source`, or returns the cached result for the same text
+    std::shared_ptr<CachedProgram> prepare(const std::string& source, ProgramCache::Variant variant) {
+        if (dumpTokens) {
+            TokenList tokens = Lexer(source).scanTokens();
+            *out << "=== TOKENS ===" << std::endl;
+            for (const auto& token : tokens.tokens) {
                 if (token.type != TokenType::EOF_TOKEN && token.type != TokenType::NEWLINE) {
-                    std::cout << token.toString() << std::endl;
+                    *out << tokens.describe(token) << std::endl;
                 }
             }
+        }
+        
+        std::shared_ptr<CachedProgram> program = cache.find(source, variant);
+        if (!program) {
+            Lexer lexer(source);
+            lexer.setErrorStream(*err);
+            Parser parser(lexer.scanTokens());
+            parser.setErrorStream(*err);
+            program = std::make_shared<CachedProgram>();
+            program->ast = parser.parse();
+            optimizeProgram(*program->ast, variant != ProgramCache::Variant::SESSION);
+            
+            // Programs with syntax errors are not cached, so the errors are reported again
+            if (parser.errorCount() == 0) {
+                cache.insert(source, variant, program);
+            }
+        }
+        
+        if (dumpAst) {
+            *out << "\n=== AST ===" << std::endl;
+            *out << program->ast->toString() << std::endl;
+        }
+        return program;
+    }
+    
+    void run(const std::string& source, ExecutionMode executionMode) {
+        try {
+            std::shared_ptr<CachedProgram> cached = prepare(source, optimize ? ProgramCache::Variant::OPTIMIZED 
+                                                                             : ProgramCache::Variant::UNOPTIMIZED);
+            ProgramNode& ast = *cached->ast;
             
-            // Parsing
-            Parser parser(tokens);
-            auto ast = parser.parse();
+            if (executionMode == ExecutionMode::BYTECODE && !profiling) {
+                if (!cached->bytecode && cached->bytecodeError.empty()) {
+                    try {
+                        CodeGenerator generator;
+                        cached->bytecode = generator.generate(ast);
+                    } catch (const CompileException& e) {
+                        cached->bytecodeError = e.what();
+                    }
+                }
+                if (!cached->bytecodeError.empty()) {
+                    *err << "Bytecode compiler: " << cached->bytecodeError 
+                         << "; falling back to the tree-walking interpreter" << std::endl;
+                }
+                
+                std::shared_ptr<BytecodeProgram> program = cached->bytecode;
+                if (program) {
+                    if (dumpBytecode) {
+                        *out << "\n=== BYTECODE ===" << std::endl;
+                        program->disassemble(*out);
+                    }
+                    
+                    if (sectionHeaders) *out << "\n=== EXECUTION (VM) ===" << std::endl;
+                    VirtualMachine vm;
+                    vm.setOutput(*out, *err);
+                    vm.interpret(*program);
+                    return;
+                }
+            }
             
-            std::cout << "\n=== AST ===" << std::endl;
-            std::cout << ast->toString() << std::endl;
+            // Static resolution of variable slots (once per cached program)
+            if (!ast.resolved) {
+                Resolver resolver;
+                resolver.resolve(ast);
+            }
             
             // Interpretation
-            std::cout << "\n=== EXECUTION ===" << std::endl;
+            if (sectionHeaders) *out << "\n=== EXECUTION ===" << std::endl;
             Interpreter interpreter;
+            interpreter.setOutput(*out, *err);
+            interpreter.setJit(jit && !profiling);
+            std::unique_ptr<Profiler> profiler;
+            if (profiling) {
+                if (profileSampleHz > 0 && !Profiler::samplingSupported()) {
+                    *err << "Sampling profiler unavailable on this platform; reporting counts only" << std::endl;
+                }
+                profiler = std::make_unique<Profiler>(ast, profileSampleHz);
+                interpreter.setProfiler(profiler.get());
+            }
             interpreter.interpret(ast);
             
+            if (profiler) {
+                reportProfile(*profiler, source);
+            }
+            
+            if (reportOptimizations && jit && !profiling) {
+                const Jit::Stats& stats = interpreter.jitStats();
+                *out << "\n=== JIT ===" << std::endl;
+                *out << stats.compiled << " compiled, " << stats.rejected << " rejected, " 
+                          << stats.nativeCalls << " native calls, " << stats.deoptimizations 
+                          << " deoptimizations" << std::endl;
+            }
+            
         } catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
+            *err << "Error: " << e.what() << std::endl;
+        }
+    }
+    
+    void reportProfile(const Profiler& profiler, const std::string& source) {
+        *out << "\n=== PROFILE ===" << std::endl;
+        profiler.report(*out, source);
+        if (!profiler.isSampling()) return;
+        
+        if (collapsedStackFile.empty()) {
+            *out << "\n=== COLLAPSED STACKS ===" << std::endl;
+            profiler.writeCollapsedStacks(*out);
+            return;
+        }
+        
+        std::ofstream file(collapsedStackFile);
+        if (!file.is_open()) {
+            *err << "Could not write collapsed stacks to " << collapsedStackFile << std::endl;
+            return;
+        }
+        profiler.writeCollapsedStacks(file);
+        *out << "\nCollapsed stacks written to " << collapsedStackFile << std::endl;
+    }
+    
+    // Times execution only (lexing, parsing and compilation excluded); best of `iterations`
+    double timeExecution(const std::string& source, ExecutionMode executionMode, bool useJit, int iterations = 3) {
+        Lexer lexer(source);
+        Parser parser(lexer.scanTokens());
+        auto ast = parser.parse();
+        if (optimize) {
+            Optimizer().optimize(*ast);
+        }
+        
+        std::shared_ptr<BytecodeProgram> program;
+        if (executionMode == ExecutionMode::BYTECODE) {
+            CodeGenerator generator;
+            program = generator.generate(*ast);
+        } else {
+            Resolver resolver;
+            resolver.resolve(*ast);
+        }
+        
+        double best = std::numeric_limits<double>::max();
+        for (int i = 0; i < iterations; i++) {
+            // Script output is discarded so printing stays out of the table and the timing
+            std::ostringstream discarded;
+            auto start = std::chrono::steady_clock::now();
+            if (program) {
+                VirtualMachine vm;
+                vm.setOutput(discarded, *err);
+                vm.interpret(*program);
+            } else {
+                Interpreter interpreter;
+                interpreter.setOutput(discarded, *err);
+                interpreter.setJit(useJit);
+                interpreter.interpret(ast);
+            }
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return best;
+    }
+    
+    void runBenchmark() {
+        std::cout << "=== MINI LANGUAGE MICRO-BENCHMARK ===" << std::endl;
+        
+        std::vector<std::pair<std::string, std::string>> scripts = {
+            {"fib(25)", R"(
+                function fib(n) {
+                    if (n < 2) {
+                        return n;
+                    }
+                    return fib(n - 1) + fib(n - 2);
+                }
+                print fib(25);
+            )"},
+            {"pure fib(25)", R"(
+                pure function fib(n) {
+                    if (n < 2) {
+                        return n;
+                    }
+                    return fib(n - 1) + fib(n - 2);
+                }
+                print fib(25);
+            )"},
+            {"nested while 500x500", R"(
+                var total = 0;
+                var i = 0;
+                while (i < 500) {
+                    var j = 0;
+                    while (j < 500) {
+                        total = total + (i * j) % 7;
+                        j = j + 1;
+                    }
+                    i = i + 1;
+                }
+                print total;
+            )"},
+            {"row sums 500x500", R"(
+                function rowSum(i) {
+                    var total = 0;
+                    var j = 0;
+                    while (j < 500) {
+                        total = total + (i * j) % 7;
+                        j = j + 1;
+                    }
+                    return total;
+                }
+                var total = 0;
+                var i = 0;
+                while (i < 500) {
+                    total = total + rowSum(i);
+                    i = i + 1;
+                }
+                print total;
+            )"}
+        };
+        
+        for (const auto& script : scripts) {
+            double treeMs = timeExecution(script.second, ExecutionMode::TREE_WALKING, false);
+            double vmMs = timeExecution(script.second, ExecutionMode::BYTECODE, false);
+            double jitMs = jit ? timeExecution(script.second, ExecutionMode::TREE_WALKING, true) : 0.0;
+            
+            std::cout << std::left << std::setw(24) << script.first << std::right << std::fixed 
+                      << std::setprecision(2) << "tree-walking: " << std::setw(9) << treeMs << " ms   "
+                      << "bytecode VM: " << std::setw(8) << vmMs << " ms";
+            if (jit) {
+                std::cout << "   tree + JIT: " << std::setw(8) << jitMs << " ms";
+            }
+            std::cout << std::endl;
+        }
+    }
+    
+    // Optimizer regression checks: each script must print the same with and without the
+    // optimizer, on both back ends. Returns the number of mismatches.
+    static int checkOptimizer(std::ostream& report) {
+        std::vector<std::pair<std::string, std::string>> scripts = {
+            {"const redeclared by var", R"(
+                const x = 5;
+                function f() {
+                    return x;
+                }
+                var x = 6;
+                print f();
+            )"},
+            {"const assigned later", R"(
+                const y = 1;
+                function g() {
+                    return y;
+                }
+                y = 2;
+                print g();
+            )"},
+            {"const in a branch", R"(
+                const z = 3;
+                if (z > 1) {
+                    const z = 4;
+                    print z;
+                }
+                print z;
+            )"},
+            {"folding and dead branches", R"(
+                const limit = 2 * 3 + 4;
+                var i = 0;
+                while (false) {
+                    print "never";
+                }
+                while (i < limit) {
+                    i = i + 1;
+                }
+                if (1 < 2) {
+                    print "taken " + i;
+                } else {
+                    print "not taken";
+                }
+            )"}
+        };
+        
+        auto runWith = [](const std::string& source, bool optimized, ExecutionMode executionMode) {
+            std::ostringstream output;
+            MiniLanguage language;
+            language.setOptimization(optimized);
+            language.setSectionHeaders(false);
+            language.setOutput(output, output);
+            language.run(source, executionMode);
+            return output.str();
+        };
+        
+        int mismatches = 0;
+        for (const auto& script : scripts) {
+            for (ExecutionMode executionMode : {ExecutionMode::TREE_WALKING, ExecutionMode::BYTECODE}) {
+                std::string expected = runWith(script.second, false, executionMode);
+                std::string actual = runWith(script.second, true, executionMode);
+                if (actual == expected) continue;
+                mismatches++;
+                report << "MISMATCH " << script.first
+                       << (executionMode == ExecutionMode::BYTECODE ? " (bytecode VM)" : " (tree-walking)") << "\n"
+                       << "  unoptimized: " << expected << "  optimized:   " << actual;
+            }
         }
+        report << "Optimizer checks: " << scripts.size() << " scripts, " << mismatches << " mismatch(es)" << std::endl;
+        return mismatches;
     }
     
     void runDemo() {
+        runDemo(mode);
+    }
+    
+    void runDemo(ExecutionMode executionMode) {
         std::cout << "=== MINI LANGUAGE COMPILER/INTERPRETER DEMO ===" << std::endl;
         
         // Demo program
@@ -1640,15 +5734,146 @@ public:
         std::cout << program << std::endl;
         std::cout << "\n" << std::string(50, '=') << std::endl;
         
-        run(program);
+        run(program, executionMode);
+    }
+};
+
+// Runs many scripts concurrently; every worker owns its MiniLanguage, so interpreters share no state
+class BatchRunner {
+public:
+    struct ScriptResult {
+        std::string path;
+        std::string output; // Everything the script printed
+        std::string errors; // Syntax and runtime errors
+        double milliseconds = 0.0;
+    };
+    
+private:
+    unsigned threadCount;
+    std::function<void(MiniLanguage&)> configure;
+    
+    static std::string readFile(const std::string& path, bool& ok) {
+        std::ifstream file(path);
+        ok = file.is_open();
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+    
+public:
+    BatchRunner(unsigned threads, std::function<void(MiniLanguage&)> configureLanguage)
+        : threadCount(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+          configure(std::move(configureLanguage)) {}
+    
+    // A directory yields its *.ml files in name order; any other file is a manifest with one
+    // script path per line (relative to the manifest, '#' starts a comment)
+    static std::vector<std::string> collectScripts(const std::string& path) {
+        namespace fs = std::filesystem;
+        std::vector<std::string> scripts;
+        
+        if (fs::is_directory(path)) {
+            for (const auto& entry : fs::directory_iterator(path)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".ml") {
+                    scripts.push_back(entry.path().string());
+                }
+            }
+            std::sort(scripts.begin(), scripts.end());
+            return scripts;
+        }
+        
+        std::ifstream manifest(path);
+        if (!manifest.is_open()) {
+            throw std::runtime_error("Could not open batch manifest: " + path);
+        }
+        fs::path base = fs::path(path).parent_path();
+        std::string line;
+        while (std::getline(manifest, line)) {
+            line = line.substr(0, line.find('#'));
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos) continue;
+            line = line.substr(begin, line.find_last_not_of(" \t\r") - begin + 1);
+            fs::path script(line);
+            scripts.push_back(script.is_absolute() ? script.string() : (base / script).string());
+        }
+        return scripts;
+    }
+    
+    std::vector<ScriptResult> run(const std::vector<std::string>& scripts) {
+        std::vector<ScriptResult> results(scripts.size());
+        std::atomic<size_t> nextScript(0);
+        
+        std::vector<std::thread> threads;
+        unsigned workers = std::min<size_t>(threadCount, std::max<size_t>(1, scripts.size()));
+        for (unsigned t = 0; t < workers; t++) {
+            threads.emplace_back([&]() {
+                size_t index;
+                while ((index = nextScript++) < scripts.size()) {
+                    ScriptResult& result = results[index];
+                    result.path = scripts[index];
+                    
+                    std::ostringstream output, errors;
+                    auto start = std::chrono::steady_clock::now();
+                    bool ok;
+                    std::string source = readFile(result.path, ok);
+                    if (ok) {
+                        MiniLanguage language;
+                        if (configure) configure(language);
+                        language.setOutput(output, errors);
+                        language.setSectionHeaders(false);
+                        language.run(source);
+                    } else {
+                        errors << "Could not open file: " << result.path << std::endl;
+                    }
+                    auto end = std::chrono::steady_clock::now();
+                    
+                    result.output = output.str();
+                    result.errors = errors.str();
+                    result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+                }
+            });
+        }
+        
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return results;
+    }
+    
+    // Prints results in input order, then the summary; returns the number of scripts with errors
+    size_t runAndReport(const std::vector<std::string>& scripts, std::ostream& out) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<ScriptResult> results = run(scripts);
+        auto end = std::chrono::steady_clock::now();
+        double wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+        
+        double totalMs = 0.0;
+        size_t failed = 0;
+        for (const auto& result : results) {
+            out << "=== " << result.path << " (" << std::fixed << std::setprecision(2) 
+                << result.milliseconds << " ms) ===" << std::endl;
+            out << result.output;
+            if (!result.errors.empty()) {
+                out << result.errors;
+                failed++;
+            }
+            totalMs += result.milliseconds;
+        }
+        
+        out << "\n=== BATCH ===" << std::endl;
+        out << results.size() << " scripts, " << failed << " with errors, " 
+            << std::min<size_t>(threadCount, std::max<size_t>(1, results.size())) << " threads" << std::endl;
+        out << std::fixed << std::setprecision(2) << "wall: " << wallMs << " ms   sum of scripts: " 
+            << totalMs << " ms   speedup: " << (wallMs > 0.0 ? totalMs / wallMs : 0.0) << "x" << std::endl;
+        return failed;
     }
 };
 
 // Demo function
-void runCompilerDemo() {
-    MiniLanguage language;
+void runCompilerDemo(MiniLanguage& language) {
     language.runDemo();
     
+    std::cout << "\n" << std::string(50, '=') << std::endl;
+    std::cout << "Running the same program on the bytecode VM:" << std::endl;
+    language.runDemo(ExecutionMode::BYTECODE);
+    
     std::cout << "\n" << std::string(50, '=') << std::endl;
     std::cout << "Starting REPL (type 'exit' to quit):" << std::endl;
     
@@ -1656,9 +5881,88 @@ void runCompilerDemo() {
     // language.runREPL();
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
-        runCompilerDemo();
+        // Usage: compiler_interpreter [script.ml] [--benchmark] [--no-optimize] [--report-optimizations]
+        //        [--no-jit] [--dump-tokens] [--dump-ast] [--dump-bytecode] [--profile]
+        //        [--profile-sample[=HZ]] [--profile-collapsed=FILE] [--repl] [--batch DIR|MANIFEST] [--threads N]
+        //        [--check-optimizer]
+        MiniLanguage language;
+        bool benchmark = false;
+        bool checkOptimizer = false;
+        bool repl = false;
+        bool optimize = true;
+        bool jit = true;
+        std::string script;
+        std::string batch;
+        unsigned threads = 0; // 0: one per hardware thread
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--benchmark") {
+                benchmark = true;
+            } else if (arg == "--check-optimizer") {
+                checkOptimizer = true;
+            } else if (arg == "--no-optimize") {
+                language.setOptimization(false);
+                optimize = false;
+            } else if (arg == "--report-optimizations") {
+                language.setOptimizationReport(true);
+            } else if (arg == "--no-jit") {
+                language.setJit(false);
+                jit = false;
+            } else if (arg == "--dump-tokens") {
+                language.setTokenDump(true);
+            } else if (arg == "--dump-ast") {
+                language.setAstDump(true);
+            } else if (arg == "--dump-bytecode") {
+                language.setBytecodeDump(true);
+            } else if (arg == "--repl") {
+                repl = true;
+            } else if (arg == "--profile") {
+                language.setProfiling(true);
+            } else if (arg == "--profile-sample") {
+                language.setProfileSampling(MiniLanguage::DEFAULT_SAMPLE_HZ);
+            } else if (arg.rfind("--profile-sample=", 0) == 0) {
+                language.setProfileSampling(static_cast<unsigned>(std::stoul(arg.substr(std::string("--profile-sample=").size()))));
+            } else if (arg.rfind("--profile-collapsed=", 0) == 0) {
+                language.setCollapsedStackFile(arg.substr(std::string("--profile-collapsed=").size()));
+            } else if (arg == "--batch" && i + 1 < argc) {
+                batch = argv[++i];
+            } else if (arg == "--threads" && i + 1 < argc) {
+                threads = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg.rfind("--", 0) != 0) {
+                script = arg;
+            }
+        }
+        
+        if (benchmark) {
+            language.runBenchmark();
+            return 0;
+        }
+        
+        if (checkOptimizer) {
+            return MiniLanguage::checkOptimizer(std::cout) == 0 ? 0 : 1;
+        }
+        
+        if (!batch.empty()) {
+            BatchRunner runner(threads, [&](MiniLanguage& worker) {
+                worker.setOptimization(optimize);
+                worker.setJit(jit);
+            });
+            return runner.runAndReport(BatchRunner::collectScripts(batch), std::cout) == 0 ? 0 : 1;
+        }
+        
+        if (!script.empty()) {
+            language.runFile(script);
+            return 0;
+        }
+        
+        if (repl) {
+            language.runREPL();
+            return 0;
+        }
+        
+        runCompilerDemo(language);
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
@@ -11,6 +11,9 @@
 #include <atomic>
 #include <chrono>
 #include <iomanip>
+#include <functional>
+#include <sstream>
+#include <cstdint>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -28,6 +31,43 @@ class Camera;
 class Scene;
 class RayTracer;
 
+// Thread-local random number generation; reseeding per tile keeps renders reproducible
+class Random {
+public:
+    static std::mt19937& generator() {
+        thread_local std::mt19937 gen(std::random_device{}());
+        return gen;
+    }
+    
+    static void seed(uint32_t s) { generator().seed(s); }
+    
+    static double uniform(double min = 0.0, double max = 1.0) {
+        std::uniform_real_distribution<> dis(min, max);
+        return dis(generator());
+    }
+};
+
+// Per-thread render counters used by benchmark instrumentation
+struct RenderCounters {
+    uint64_t primaryRays = 0;
+    uint64_t secondaryRays = 0;
+    uint64_t intersectionTests = 0;
+    
+    static RenderCounters& local() {
+        thread_local RenderCounters counters;
+        return counters;
+    }
+    
+    void reset() { primaryRays = secondaryRays = intersectionTests = 0; }
+    
+    RenderCounters& operator+=(const RenderCounters& other) {
+        primaryRays += other.primaryRays;
+        secondaryRays += other.secondaryRays;
+        intersectionTests += other.intersectionTests;
+        return *this;
+    }
+};
+
 // 3D Vector class with comprehensive operations
 class Vector3 {
 public:
@@ -77,10 +117,10 @@ public:
     
     // Utility functions
     static Vector3 random(double min = 0.0, double max = 1.0) {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(min, max);
-        return Vector3(dis(gen), dis(gen), dis(gen));
+        double rx = Random::uniform(min, max);
+        double ry = Random::uniform(min, max);
+        double rz = Random::uniform(min, max);
+        return Vector3(rx, ry, rz);
     }
     
     static Vector3 randomInUnitSphere() {
@@ -224,11 +264,7 @@ public:
         bool cannotRefract = refractionRatio * sinTheta > 1.0;
         Vector3 direction;
         
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(0.0, 1.0);
-        
-        if (cannotRefract || reflectance(cosTheta, refractionRatio) > dis(gen)) {
+        if (cannotRefract || reflectance(cosTheta, refractionRatio) > Random::uniform()) {
             direction = unitDirection.reflect(rec.normal);
         } else {
             direction = unitDirection.refract(rec.normal, refractionRatio);
@@ -480,6 +516,7 @@ public:
         bool hitAnything = false;
         double closestSoFar = tMax;
         
+        RenderCounters::local().intersectionTests += objects.size();
         for (const auto& object : objects) {
             if (object->hit(ray, tMin, closestSoFar, tempRec)) {
                 hitAnything = true;
@@ -504,6 +541,37 @@ public:
     }
 };
 
+// Timing for a single rendered tile
+struct TileTiming {
+    int x0, y0, width, height;
+    int threadId;
+    double milliseconds;
+};
+
+// Per-thread work summary for a render
+struct ThreadStats {
+    int threadId = 0;
+    int tilesRendered = 0;
+    double busySeconds = 0.0;
+    RenderCounters counters;
+};
+
+// Aggregated statistics of the last render
+struct RenderStats {
+    double wallSeconds = 0.0;
+    int numThreads = 0;
+    int tileSize = 0;
+    RenderCounters totals;
+    std::vector<ThreadStats> threads;
+    std::vector<TileTiming> tiles;
+    
+    uint64_t totalRays() const { return totals.primaryRays + totals.secondaryRays; }
+    
+    double intersectionTestsPerRay() const {
+        return totalRays() > 0 ? static_cast<double>(totals.intersectionTests) / totalRays() : 0.0;
+    }
+};
+
 // Ray tracer class
 class RayTracer {
 private:
@@ -511,17 +579,27 @@ private:
     int imageHeight;
     int samplesPerPixel;
     int maxDepth;
+    int tileSize;
+    uint32_t seed;
+    bool verbose;
     std::vector<std::vector<Color>> image;
     std::atomic<int> pixelsCompleted;
     std::mutex progressMutex;
+    RenderStats lastStats;
     
 public:
     RayTracer(int width, int height, int samples = 100, int depth = 50)
         : imageWidth(width), imageHeight(height), samplesPerPixel(samples), maxDepth(depth),
-          pixelsCompleted(0) {
+          tileSize(16), seed(std::random_device{}()), verbose(true), pixelsCompleted(0) {
         image.resize(imageHeight, std::vector<Color>(imageWidth));
     }
     
+    void setSeed(uint32_t s) { seed = s; }
+    void setTileSize(int size) { tileSize = std::max(1, size); }
+    void setVerbose(bool v) { verbose = v; }
+    
+    const RenderStats& getLastRenderStats() const { return lastStats; }
+    
     Color rayColor(const Ray& ray, const Scene& scene, int depth) const {
         if (depth <= 0) return Color(0, 0, 0);
         
@@ -533,6 +611,7 @@ public:
             Color attenuation;
             Ray scattered;
             if (rec.material->scatter(ray, rec, attenuation, scattered)) {
+                if (depth > 1) RenderCounters::local().secondaryRays++;
                 return emitted + attenuation.multiply(rayColor(scattered, scene, depth - 1));
             } else {
                 return emitted;
@@ -546,14 +625,11 @@ public:
         Color pixelColor(0, 0, 0);
         
         for (int s = 0; s < samplesPerPixel; s++) {
-            static std::random_device rd;
-            static thread_local std::mt19937 gen(rd());
-            std::uniform_real_distribution<> dis(0.0, 1.0);
-            
-            double u = (i + dis(gen)) / (imageWidth - 1);
-            double v = (j + dis(gen)) / (imageHeight - 1);
+            double u = (i + Random::uniform()) / (imageWidth - 1);
+            double v = (j + Random::uniform()) / (imageHeight - 1);
             
             Ray ray = camera.getRay(u, v);
+            RenderCounters::local().primaryRays++;
             pixelColor += rayColor(ray, scene, maxDepth);
         }
         
@@ -564,39 +640,78 @@ public:
         pixelColor = Color(sqrt(pixelColor.x), sqrt(pixelColor.y), sqrt(pixelColor.z));
         
         image[imageHeight - 1 - j][i] = pixelColor;
+    }
+    
+    void renderTile(int x0, int y0, int x1, int y1, const Camera& camera, const Scene& scene) {
+        for (int j = y0; j < y1; j++) {
+            for (int i = x0; i < x1; i++) {
+                renderPixel(i, j, camera, scene);
+            }
+        }
         
-        // Update progress
-        int completed = ++pixelsCompleted;
-        if (completed % (imageWidth * imageHeight / 100) == 0) {
+        // Update progress once per tile
+        int totalPixels = imageWidth * imageHeight;
+        int tilePixels = (x1 - x0) * (y1 - y0);
+        int before = pixelsCompleted.fetch_add(tilePixels);
+        int after = before + tilePixels;
+        if (verbose && (100LL * before / totalPixels) != (100LL * after / totalPixels)) {
             std::lock_guard<std::mutex> lock(progressMutex);
-            double progress = 100.0 * completed / (imageWidth * imageHeight);
+            double progress = 100.0 * after / totalPixels;
             std::cout << "Progress: " << std::fixed << std::setprecision(1) 
                       << progress << "%\r" << std::flush;
         }
     }
     
     void render(const Camera& camera, const Scene& scene, int numThreads = 4) {
-        std::cout << "Starting ray tracing..." << std::endl;
-        std::cout << "Image size: " << imageWidth << "x" << imageHeight << std::endl;
-        std::cout << "Samples per pixel: " << samplesPerPixel << std::endl;
-        std::cout << "Max depth: " << maxDepth << std::endl;
-        std::cout << "Threads: " << numThreads << std::endl;
+        numThreads = std::max(1, numThreads);
+        
+        if (verbose) {
+            std::cout << "Starting ray tracing..." << std::endl;
+            std::cout << "Image size: " << imageWidth << "x" << imageHeight << std::endl;
+            std::cout << "Samples per pixel: " << samplesPerPixel << std::endl;
+            std::cout << "Max depth: " << maxDepth << std::endl;
+            std::cout << "Threads: " << numThreads << std::endl;
+        }
         
         auto startTime = std::chrono::high_resolution_clock::now();
         pixelsCompleted = 0;
         
+        int tilesX = (imageWidth + tileSize - 1) / tileSize;
+        int tilesY = (imageHeight + tileSize - 1) / tileSize;
+        int totalTiles = tilesX * tilesY;
+        
         std::vector<std::thread> threads;
-        std::atomic<int> nextPixel(0);
-        int totalPixels = imageWidth * imageHeight;
+        std::vector<ThreadStats> threadStats(numThreads);
+        std::vector<TileTiming> tileTimings(totalTiles);
+        std::atomic<int> nextTile(0);
         
         for (int t = 0; t < numThreads; t++) {
-            threads.emplace_back([&]() {
-                int pixel;
-                while ((pixel = nextPixel++) < totalPixels) {
-                    int i = pixel % imageWidth;
-                    int j = pixel / imageWidth;
-                    renderPixel(i, j, camera, scene);
+            threads.emplace_back([&, t]() {
+                ThreadStats& stats = threadStats[t];
+                stats.threadId = t;
+                RenderCounters::local().reset();
+                
+                int tile;
+                while ((tile = nextTile++) < totalTiles) {
+                    int x0 = (tile % tilesX) * tileSize;
+                    int y0 = (tile / tilesX) * tileSize;
+                    int x1 = std::min(x0 + tileSize, imageWidth);
+                    int y1 = std::min(y0 + tileSize, imageHeight);
+                    
+                    // Seed per tile so the image does not depend on thread scheduling
+                    Random::seed(seed + static_cast<uint32_t>(tile) * 2654435761u);
+                    
+                    auto tileStart = std::chrono::high_resolution_clock::now();
+                    renderTile(x0, y0, x1, y1, camera, scene);
+                    auto tileEnd = std::chrono::high_resolution_clock::now();
+                    
+                    double ms = std::chrono::duration<double, std::milli>(tileEnd - tileStart).count();
+                    tileTimings[tile] = {x0, y0, x1 - x0, y1 - y0, t, ms};
+                    stats.busySeconds += ms / 1000.0;
+                    stats.tilesRendered++;
                 }
+                
+                stats.counters = RenderCounters::local();
             });
         }
         
@@ -605,9 +720,21 @@ public:
         }
         
         auto endTime = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::seconds>(endTime - startTime);
         
-        std::cout << "\nRendering completed in " << duration.count() << " seconds" << std::endl;
+        lastStats = RenderStats();
+        lastStats.wallSeconds = std::chrono::duration<double>(endTime - startTime).count();
+        lastStats.numThreads = numThreads;
+        lastStats.tileSize = tileSize;
+        lastStats.threads = std::move(threadStats);
+        lastStats.tiles = std::move(tileTimings);
+        for (const auto& stats : lastStats.threads) {
+            lastStats.totals += stats.counters;
+        }
+        
+        if (verbose) {
+            std::cout << "\nRendering completed in " << std::fixed << std::setprecision(2)
+                      << lastStats.wallSeconds << " seconds" << std::endl;
+        }
     }
     
     void saveImage(const std::string& filename) const {
@@ -695,7 +822,7 @@ public:
         return scene;
     }
     
-    static std::unique_ptr<Scene> createRandomScene() {
+    static std::unique_ptr<Scene> createRandomScene(uint32_t seed = std::random_device{}()) {
         auto scene = std::make_unique<Scene>();
         
         // Ground
@@ -703,26 +830,26 @@ public:
         scene->addObject(std::make_shared<Sphere>(Vector3(0, -1000, 0), 1000, ground));
         
         // Random spheres
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(0.0, 1.0);
+        Random::seed(seed);
         
         for (int a = -11; a < 11; a++) {
             for (int b = -11; b < 11; b++) {
-                double chooseMat = dis(gen);
-                Vector3 center(a + 0.9 * dis(gen), 0.2, b + 0.9 * dis(gen));
+                double chooseMat = Random::uniform();
+                double offsetX = Random::uniform();
+                double offsetZ = Random::uniform();
+                Vector3 center(a + 0.9 * offsetX, 0.2, b + 0.9 * offsetZ);
                 
                 if ((center - Vector3(4, 0.2, 0)).length() > 0.9) {
                     std::shared_ptr<Material> sphereMaterial;
                     
                     if (chooseMat < 0.8) {
                         // Diffuse
-                        Color albedo = Color::random() * Color::random();
+                        Color albedo = Color::random().multiply(Color::random());
                         sphereMaterial = std::make_shared<Lambertian>(albedo);
                     } else if (chooseMat < 0.95) {
                         // Metal
                         Color albedo = Color::random(0.5, 1);
-                        double fuzz = dis(gen) * 0.5;
+                        double fuzz = Random::uniform() * 0.5;
                         sphereMaterial = std::make_shared<Metal>(albedo, fuzz);
                     } else {
                         // Glass
@@ -772,6 +899,167 @@ public:
     }
 };
 
+// Benchmark suite: fixed scenes, seeds and resolutions with JSON output
+class RayTracerBenchmark {
+public:
+    struct BenchmarkCase {
+        std::string name;
+        std::function<std::unique_ptr<Scene>()> createScene;
+        Camera camera;
+        int width;
+        int height;
+        int samplesPerPixel;
+        int maxDepth;
+        uint32_t seed;
+    };
+    
+    struct BenchmarkResult {
+        BenchmarkCase config;
+        size_t objectCount;
+        RenderStats stats;
+    };
+    
+    static std::vector<BenchmarkCase> defaultCases() {
+        const uint32_t sceneSeed = 42;
+        return {
+            {"cornell_box", []() { return SceneBuilder::createCornellBox(); },
+             Camera(Vector3(0, 0, 1), Vector3(0, 0, -1), Vector3(0, 1, 0), 45, 1.0),
+             160, 160, 16, 10, 1001},
+            {"random_scene", [sceneSeed]() { return SceneBuilder::createRandomScene(sceneSeed); },
+             Camera(Vector3(13, 2, 3), Vector3(0, 0, 0), Vector3(0, 1, 0), 20, 16.0/9.0, 0.1, 10.0),
+             192, 108, 8, 10, 1002},
+            {"reflection_scene", []() { return SceneBuilder::createReflectionScene(); },
+             Camera(Vector3(-2, 2, 1), Vector3(0, 0, -1), Vector3(0, 1, 0), 20, 16.0/9.0),
+             192, 108, 16, 10, 1003}
+        };
+    }
+    
+    static BenchmarkResult runCase(const BenchmarkCase& benchCase, int numThreads, int tileSize) {
+        auto scene = benchCase.createScene();
+        
+        RayTracer rayTracer(benchCase.width, benchCase.height, benchCase.samplesPerPixel, benchCase.maxDepth);
+        rayTracer.setSeed(benchCase.seed);
+        rayTracer.setTileSize(tileSize);
+        rayTracer.setVerbose(false);
+        rayTracer.render(benchCase.camera, *scene, numThreads);
+        
+        return {benchCase, scene->objects.size(), rayTracer.getLastRenderStats()};
+    }
+    
+    static void printResult(const BenchmarkResult& result) {
+        const RenderStats& stats = result.stats;
+        double wall = std::max(stats.wallSeconds, 1e-9);
+        
+        std::cout << std::left << std::setw(18) << result.config.name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(8) << stats.wallSeconds << " s"
+                  << std::setprecision(0)
+                  << std::setw(12) << stats.totals.primaryRays / wall << " prim/s"
+                  << std::setw(12) << stats.totals.secondaryRays / wall << " sec/s"
+                  << std::setprecision(2)
+                  << std::setw(8) << stats.intersectionTestsPerRay() << " isect/ray" << std::endl;
+    }
+    
+    static std::string toJson(const std::vector<BenchmarkResult>& results) {
+        std::ostringstream json;
+        json << std::setprecision(6) << std::fixed;
+        json << "{\n";
+        json << "  \"benchmark\": \"ray_tracer\",\n";
+        json << "  \"timestamp\": " << std::chrono::duration_cast<std::chrono::seconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count() << ",\n";
+        json << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n";
+        json << "  \"results\": [\n";
+        
+        for (size_t r = 0; r < results.size(); r++) {
+            const BenchmarkResult& result = results[r];
+            const RenderStats& stats = result.stats;
+            double wall = std::max(stats.wallSeconds, 1e-9);
+            
+            std::vector<double> tileMs;
+            for (const auto& tile : stats.tiles) tileMs.push_back(tile.milliseconds);
+            std::sort(tileMs.begin(), tileMs.end());
+            double tileTotal = 0.0;
+            for (double ms : tileMs) tileTotal += ms;
+            auto percentile = [&tileMs](double p) {
+                if (tileMs.empty()) return 0.0;
+                size_t index = static_cast<size_t>(p * (tileMs.size() - 1) + 0.5);
+                return tileMs[index];
+            };
+            
+            json << "    {\n";
+            json << "      \"scene\": \"" << result.config.name << "\",\n";
+            json << "      \"objects\": " << result.objectCount << ",\n";
+            json << "      \"width\": " << result.config.width << ",\n";
+            json << "      \"height\": " << result.config.height << ",\n";
+            json << "      \"samples_per_pixel\": " << result.config.samplesPerPixel << ",\n";
+            json << "      \"max_depth\": " << result.config.maxDepth << ",\n";
+            json << "      \"seed\": " << result.config.seed << ",\n";
+            json << "      \"threads\": " << stats.numThreads << ",\n";
+            json << "      \"tile_size\": " << stats.tileSize << ",\n";
+            json << "      \"wall_seconds\": " << stats.wallSeconds << ",\n";
+            json << "      \"primary_rays\": " << stats.totals.primaryRays << ",\n";
+            json << "      \"secondary_rays\": " << stats.totals.secondaryRays << ",\n";
+            json << "      \"primary_rays_per_sec\": " << stats.totals.primaryRays / wall << ",\n";
+            json << "      \"secondary_rays_per_sec\": " << stats.totals.secondaryRays / wall << ",\n";
+            json << "      \"total_rays_per_sec\": " << stats.totalRays() / wall << ",\n";
+            json << "      \"intersection_tests\": " << stats.totals.intersectionTests << ",\n";
+            json << "      \"intersection_tests_per_ray\": " << stats.intersectionTestsPerRay() << ",\n";
+            
+            json << "      \"thread_stats\": [\n";
+            for (size_t t = 0; t < stats.threads.size(); t++) {
+                const ThreadStats& thread = stats.threads[t];
+                json << "        {\"id\": " << thread.threadId
+                     << ", \"tiles\": " << thread.tilesRendered
+                     << ", \"busy_seconds\": " << thread.busySeconds
+                     << ", \"utilization\": " << thread.busySeconds / wall
+                     << ", \"rays\": " << thread.counters.primaryRays + thread.counters.secondaryRays
+                     << "}" << (t + 1 < stats.threads.size() ? "," : "") << "\n";
+            }
+            json << "      ],\n";
+            
+            json << "      \"tile_ms\": {\"count\": " << tileMs.size()
+                 << ", \"min\": " << (tileMs.empty() ? 0.0 : tileMs.front())
+                 << ", \"mean\": " << (tileMs.empty() ? 0.0 : tileTotal / tileMs.size())
+                 << ", \"p50\": " << percentile(0.5)
+                 << ", \"p95\": " << percentile(0.95)
+                 << ", \"max\": " << (tileMs.empty() ? 0.0 : tileMs.back()) << "},\n";
+            
+            json << "      \"tiles\": [";
+            for (size_t t = 0; t < stats.tiles.size(); t++) {
+                const TileTiming& tile = stats.tiles[t];
+                json << (t % 4 == 0 ? "\n        " : " ")
+                     << "{\"x\": " << tile.x0 << ", \"y\": " << tile.y0
+                     << ", \"thread\": " << tile.threadId << ", \"ms\": " << tile.milliseconds << "}"
+                     << (t + 1 < stats.tiles.size() ? "," : "");
+            }
+            json << "\n      ]\n";
+            json << "    }" << (r + 1 < results.size() ? "," : "") << "\n";
+        }
+        
+        json << "  ]\n";
+        json << "}\n";
+        return json.str();
+    }
+    
+    static void run(const std::string& outputFile, int numThreads, int tileSize = 16) {
+        std::cout << "=== RAY TRACER BENCHMARK ===" << std::endl;
+        std::cout << "Threads: " << numThreads << ", tile size: " << tileSize << std::endl;
+        
+        std::vector<BenchmarkResult> results;
+        for (const auto& benchCase : defaultCases()) {
+            results.push_back(runCase(benchCase, numThreads, tileSize));
+            printResult(results.back());
+        }
+        
+        std::ofstream file(outputFile);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file " << outputFile << std::endl;
+            return;
+        }
+        file << toJson(results);
+        std::cout << "Benchmark results saved to " << outputFile << std::endl;
+    }
+};
+
 // Demo function
 void runRayTracerDemo() {
     std::cout << "=== ADVANCED RAY TRACER DEMO ===" << std::endl;
@@ -836,9 +1124,31 @@ void runRayTracerDemo() {
     std::cout << "or converted to other formats using tools like ImageMagick." << std::endl;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
-        runRayTracerDemo();
+        // Usage: ray_tracer [--benchmark [output.json] [--threads N] [--tile-size N]]
+        bool benchmark = false;
+        std::string outputFile = "raytracer_benchmark.json";
+        int numThreads = std::max(1u, std::thread::hardware_concurrency());
+        int tileSize = 16;
+        
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--benchmark") {
+                benchmark = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-') outputFile = argv[++i];
+            } else if (arg == "--threads" && i + 1 < argc) {
+                numThreads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--tile-size" && i + 1 < argc) {
+                tileSize = std::max(1, std::stoi(argv[++i]));
+            }
+        }
+        
+        if (benchmark) {
+            RayTracerBenchmark::run(outputFile, numThreads, tileSize);
+        } else {
+            runRayTracerDemo();
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;